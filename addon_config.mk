@@ -24,3 +24,32 @@ meta:
 vs:
 	# avoid errors when building triangle in Visual Studio
 	ADDON_CFLAGS += -DNO_TIMER
+
+# keep the compiler from fusing multiply/adds (FMA) so that results are
+# bit-identical across machines; required by ofxBox2d::init(..., deterministic)
+linux64:
+	ADDON_CFLAGS += -ffp-contract=off
+
+linux:
+	ADDON_CFLAGS += -ffp-contract=off
+
+linuxarmv6l:
+	ADDON_CFLAGS += -ffp-contract=off
+
+linuxarmv7l:
+	ADDON_CFLAGS += -ffp-contract=off
+
+msys2:
+	ADDON_CFLAGS += -ffp-contract=off
+
+osx:
+	ADDON_CFLAGS += -ffp-contract=off
+
+ios:
+	ADDON_CFLAGS += -ffp-contract=off
+
+android/armeabi-v7a:
+	ADDON_CFLAGS += -ffp-contract=off
+
+android/x86:
+	ADDON_CFLAGS += -ffp-contract=off
@@ -62,14 +62,18 @@ void ofApp::update() {
 //--------------------------------------------------------------
 void ofApp::draw() {
 	
+	// skip shapes that fell off screen
+	ofRectangle viewport(0, 0, ofGetWidth(), ofGetHeight());
 	
     for(auto &circle : circles) {
+		if(!circle->isInViewport(viewport)) continue;
 		ofFill();
 		ofSetHexColor(0x90d4e3);
 		circle->draw();
 	}
 	
     for(auto &box : boxes) {
+		if(!box->isInViewport(viewport)) continue;
 		ofFill();
 		ofSetHexColor(0xe63b8b);
 		box->draw();
@@ -0,0 +1,21 @@
+// Headless check that the wide contact solver agrees with the scalar one,
+// exits with 1 when they drift apart. Needs only Box2D, run it with and
+// without SIMD from the addon folder:
+//
+//   for flags in "" -DB2_SIMD_DISABLE; do
+//     g++ -O2 $flags -Ilibs example-WideSolver/check/checkWideSolver.cpp \
+//         example-WideSolver/src/compareSolvers.cpp libs/Box2D/*/*.cpp \
+//         libs/Box2D/*/*/*.cpp -lpthread -o checkWideSolver &&
+//     ./checkWideSolver || break
+//   done
+
+#include "../src/compareSolvers.h"
+#include <cstdio>
+
+int main() {
+	float distance, angle;
+	bool passed = compareSolvers(distance, angle);
+	printf("%s: max distance %g m (limit %g), max angle %g rad (limit %g)\n",
+		   passed ? "agree" : "DIFFER", distance, k_maxDistance, angle, k_maxAngle);
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+#include "compareSolvers.h"
+
+//--------------------------------------------------------------
+static void addPyramid(b2World * world) {
+	b2BodyDef gd;
+	b2Body * ground = world->CreateBody(&gd);
+	b2EdgeShape edge;
+	edge.Set(b2Vec2(-40, 0), b2Vec2(40, 0));
+	ground->CreateFixture(&edge, 0);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+	for (int r=0; r<k_rows; r++) {
+		for (int i=0; i<k_rows-r; i++) {
+			b2BodyDef bd;
+			bd.type = b2_dynamicBody;
+			bd.position.Set((i - (k_rows-r)*0.5f) * 1.05f + 0.5f, 0.5f + r);
+			world->CreateBody(&bd)->CreateFixture(&box, 1);
+		}
+	}
+}
+
+//--------------------------------------------------------------
+bool compareSolvers(float & maxDistance, float & maxAngle) {
+	b2World scalar(b2Vec2(0, -10));
+	b2World wide(b2Vec2(0, -10));
+	wide.SetWideContactSolver(true);
+	addPyramid(&scalar);
+	addPyramid(&wide);
+
+	maxDistance = 0;
+	maxAngle    = 0;
+	for (int i=0; i<k_headlessSteps; i++) {
+		scalar.Step(1.0f / 60.0f, 8, 3);
+		wide.Step(1.0f / 60.0f, 8, 3);
+
+		// bodies are created in the same order in both worlds
+		for (b2Body * a = scalar.GetBodyList(), * b = wide.GetBodyList(); a && b; a = a->GetNext(), b = b->GetNext()) {
+			maxDistance = b2Max(maxDistance, (a->GetPosition() - b->GetPosition()).Length());
+			maxAngle    = b2Max(maxAngle, b2Abs(a->GetAngle() - b->GetAngle()));
+		}
+	}
+	return maxDistance <= k_maxDistance && maxAngle <= k_maxAngle;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <Box2D/Box2D.h>
+
+// -------------------------------------------------
+// Headless comparison of the scalar and wide contact solvers, shared by
+// the example and by check/checkWideSolver.cpp. Only needs Box2D.
+
+// the wide solver skips the 2x2 block solve, so the worlds drift apart
+// slightly but must settle to the same pile.
+static const int   k_rows          = 20;
+static const int   k_headlessSteps = 600;
+static const float k_maxDistance   = 0.05f;   // meters
+static const float k_maxAngle      = 0.05f;   // radians
+
+// step a box pyramid of k_rows rows with both solvers for
+// k_headlessSteps steps and compare every body after each step.
+// returns true if they stay within k_maxDistance / k_maxAngle.
+bool compareSolvers(float & maxDistance, float & maxAngle);
@@ -0,0 +1,102 @@
+#include "ofApp.h"
+
+//--------------------------------------------------------------
+void ofApp::setup() {
+	ofSetVerticalSync(true);
+	ofBackgroundHex(0xfdefc2);
+	
+	float distance, angle;
+	headlessPassed = compareSolvers(distance, angle);
+	if (headlessPassed) {
+		ofLogNotice("WideSolver") << "scalar and wide solvers agree, max distance " << distance << " m, max angle " << angle << " rad";
+	}
+	else {
+		ofLogError("WideSolver") << "scalar and wide solvers differ, max distance " << distance << " m, max angle " << angle << " rad";
+	}
+	
+	scalarWorld.init();
+	scalarWorld.setFPS(60.0);
+	scalarWorld.setGravity(0, 10);
+	
+	wideWorld.init();
+	wideWorld.setFPS(60.0);
+	wideWorld.setGravity(0, 10);
+	wideWorld.setWideContactSolver(true);
+	
+	// both pyramids are built in the same place, the wide one is drawn
+	// shifted to the right
+	buildPyramid(scalarWorld, scalarBoxes);
+	buildPyramid(wideWorld, wideBoxes);
+	
+	maxDistance = 0;
+	maxAngle    = 0;
+}
+
+//--------------------------------------------------------------
+void ofApp::buildPyramid(ofxBox2d & box2d, vector <shared_ptr<ofxBox2dRect> > & boxes) {
+	float x = ofGetWidth() * 0.25;
+	float size = 20;
+	float floor = ofGetHeight() - 20;
+	box2d.createGround(x - 240, floor, x + 240, floor);
+	
+	boxes.clear();
+	for (int r=0; r<k_rows; r++) {
+		for (int i=0; i<k_rows-r; i++) {
+			auto rect = make_shared<ofxBox2dRect>();
+			rect->setPhysics(1.0, 0.0, 0.6);
+			rect->setup(box2d.getWorld(), x + (i - (k_rows-r)*0.5f) * size * 1.05f + size * 0.5f, floor - size * (r + 0.5f), size, size);
+			boxes.push_back(rect);
+		}
+	}
+}
+
+//--------------------------------------------------------------
+void ofApp::update() {
+	scalarWorld.update();
+	wideWorld.update();
+	
+	for (size_t i=0; i<scalarBoxes.size(); i++) {
+		b2Body * a = scalarBoxes[i]->body;
+		b2Body * b = wideBoxes[i]->body;
+		maxDistance = MAX(maxDistance, (a->GetPosition() - b->GetPosition()).Length());
+		maxAngle    = MAX(maxAngle, b2Abs(a->GetAngle() - b->GetAngle()));
+	}
+}
+
+//--------------------------------------------------------------
+void ofApp::draw() {
+	for (auto & rect : scalarBoxes) {
+		ofFill();
+		ofSetHexColor(rect->isSleeping() ? 0x90a0b0 : 0x2F9BA1);
+		rect->draw();
+	}
+	ofPushMatrix();
+	ofTranslate(ofGetWidth() * 0.5, 0);
+	for (auto & rect : wideBoxes) {
+		ofFill();
+		ofSetHexColor(rect->isSleeping() ? 0x90a0b0 : 0xE83AAB);
+		rect->draw();
+	}
+	ofPopMatrix();
+	
+	bool agree = maxDistance <= k_maxDistance && maxAngle <= k_maxAngle;
+	string info = "";
+	info += "scalar solver (left) vs wide solver (right)\n";
+	info += "headless check: " + string(headlessPassed ? "agree" : "DIFFER") + "\n";
+	info += "max distance: " + ofToString(maxDistance, 4) + " m\n";
+	info += "max angle: " + ofToString(maxAngle, 4) + " rad\n";
+	info += string(agree ? "within" : "OUTSIDE") + " tolerance\n";
+	info += "press r to restart\n";
+	ofSetHexColor(0x444342);
+	ofDrawBitmapString(info, 30, 30);
+}
+
+//--------------------------------------------------------------
+void ofApp::keyPressed(int key) {
+	if (key == 'r') {
+		buildPyramid(scalarWorld, scalarBoxes);
+		buildPyramid(wideWorld, wideBoxes);
+		maxDistance = 0;
+		maxAngle    = 0;
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "ofMain.h"
+#include "ofxBox2d.h"
+#include "compareSolvers.h"
+
+// -------------------------------------------------
+// Steps the same box pyramid with the scalar contact solver (left) and
+// the wide SIMD solver (right) and checks that they agree.
+class ofApp : public ofBaseApp {
+	
+public:
+	
+	void setup();
+	void update();
+	void draw();
+	
+	void keyPressed(int key);
+	
+	void buildPyramid(ofxBox2d & box2d, vector <shared_ptr<ofxBox2dRect> > & boxes);
+	
+	ofxBox2d                                scalarWorld;
+	ofxBox2d                                wideWorld;
+	vector		<shared_ptr<ofxBox2dRect> >		scalarBoxes;
+	vector		<shared_ptr<ofxBox2dRect> >		wideBoxes;
+	
+	// largest difference seen between the two worlds, in meters / radians
+	float                                   maxDistance;
+	float                                   maxAngle;
+	bool                                    headlessPassed;
+};
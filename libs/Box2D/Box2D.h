@@ -28,6 +28,7 @@
 // These include files constitute the main Box2D API
 
 #include <Box2D/Common/b2Settings.h>
+#include <Box2D/Common/b2BatchMath.h>
 #include <Box2D/Common/b2Draw.h>
 #include <Box2D/Common/b2Stat.h>
 #include <Box2D/Common/b2Timer.h>
@@ -40,6 +41,7 @@
 #include <Box2D/Collision/b2BroadPhase.h>
 #include <Box2D/Collision/b2Distance.h>
 #include <Box2D/Collision/b2DynamicTree.h>
+#include <Box2D/Collision/b2SpatialHash.h>
 #include <Box2D/Collision/b2TimeOfImpact.h>
 
 #include <Box2D/Dynamics/b2Body.h>
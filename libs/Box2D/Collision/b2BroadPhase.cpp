@@ -20,6 +20,7 @@
 
 b2BroadPhase::b2BroadPhase()
 {
+	m_type = e_dynamicTree;
 	m_proxyCount = 0;
 
 	m_pairCapacity = 16;
@@ -37,9 +38,21 @@ b2BroadPhase::~b2BroadPhase()
 	b2Free(m_pairBuffer);
 }
 
+void b2BroadPhase::SetType(Type type, float32 cellSize)
+{
+	b2Assert(m_proxyCount == 0);
+	if (m_proxyCount != 0)
+	{
+		return;
+	}
+	m_type = type;
+	m_grid.SetCellSize(cellSize);
+}
+
 int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData)
 {
-	int32 proxyId = m_tree.CreateProxy(aabb, userData);
+	int32 proxyId = m_type == e_spatialHash ?
+		m_grid.CreateProxy(aabb, userData) : m_tree.CreateProxy(aabb, userData);
 	++m_proxyCount;
 	BufferMove(proxyId);
 	return proxyId;
@@ -49,12 +62,21 @@ void b2BroadPhase::DestroyProxy(int32 proxyId)
 {
 	UnBufferMove(proxyId);
 	--m_proxyCount;
-	m_tree.DestroyProxy(proxyId);
+	if (m_type == e_spatialHash)
+	{
+		m_grid.DestroyProxy(proxyId);
+	}
+	else
+	{
+		m_tree.DestroyProxy(proxyId);
+	}
 }
 
 void b2BroadPhase::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
 {
-	bool buffer = m_tree.MoveProxy(proxyId, aabb, displacement);
+	bool buffer = m_type == e_spatialHash ?
+		m_grid.MoveProxy(proxyId, aabb, displacement) :
+		m_tree.MoveProxy(proxyId, aabb, displacement);
 	if (buffer)
 	{
 		BufferMove(proxyId);
@@ -22,6 +22,7 @@
 #include <Box2D/Common/b2Settings.h>
 #include <Box2D/Collision/b2Collision.h>
 #include <Box2D/Collision/b2DynamicTree.h>
+#include <Box2D/Collision/b2SpatialHash.h>
 #include <algorithm>
 
 struct b2Pair
@@ -33,6 +34,8 @@ struct b2Pair
 /// The broad-phase is used for computing pairs and performing volume queries and ray casts.
 /// This broad-phase does not persist pairs. Instead, this reports potentially new pairs.
 /// It is up to the client to consume the new pairs and to track subsequent overlap.
+/// Proxies are stored either in a b2DynamicTree (the default) or in a
+/// b2SpatialHash, see SetType.
 class b2BroadPhase
 {
 public:
@@ -42,9 +45,24 @@ public:
 		e_nullProxy = -1
 	};
 
+	/// Broad-phase backends.
+	enum Type
+	{
+		e_dynamicTree,
+		e_spatialHash
+	};
+
 	b2BroadPhase();
 	~b2BroadPhase();
 
+	/// Select the backend. The spatial hash suits swarms of similarly sized
+	/// proxies, cellSize should be close to their size. This can only be
+	/// changed while there are no proxies.
+	void SetType(Type type, float32 cellSize = 1.0f);
+
+	/// Get the backend in use.
+	Type GetType() const;
+
 	/// Create a proxy with an initial AABB. Pairs are not reported until
 	/// UpdatePairs is called.
 	int32 CreateProxy(const b2AABB& aabb, void* userData);
@@ -107,13 +125,16 @@ public:
 private:
 
 	friend class b2DynamicTree;
+	friend class b2SpatialHash;
 
 	void BufferMove(int32 proxyId);
 	void UnBufferMove(int32 proxyId);
 
 	bool QueryCallback(int32 proxyId);
 
+	Type m_type;
 	b2DynamicTree m_tree;
+	b2SpatialHash m_grid;
 
 	int32 m_proxyCount;
 
@@ -144,20 +165,33 @@ inline bool b2PairLessThan(const b2Pair& pair1, const b2Pair& pair2)
 	return false;
 }
 
+inline b2BroadPhase::Type b2BroadPhase::GetType() const
+{
+	return m_type;
+}
+
 inline void* b2BroadPhase::GetUserData(int32 proxyId) const
 {
+	if (m_type == e_spatialHash)
+	{
+		return m_grid.GetUserData(proxyId);
+	}
 	return m_tree.GetUserData(proxyId);
 }
 
 inline bool b2BroadPhase::TestOverlap(int32 proxyIdA, int32 proxyIdB) const
 {
-	const b2AABB& aabbA = m_tree.GetFatAABB(proxyIdA);
-	const b2AABB& aabbB = m_tree.GetFatAABB(proxyIdB);
+	const b2AABB& aabbA = GetFatAABB(proxyIdA);
+	const b2AABB& aabbB = GetFatAABB(proxyIdB);
 	return b2TestOverlap(aabbA, aabbB);
 }
 
 inline const b2AABB& b2BroadPhase::GetFatAABB(int32 proxyId) const
 {
+	if (m_type == e_spatialHash)
+	{
+		return m_grid.GetFatAABB(proxyId);
+	}
 	return m_tree.GetFatAABB(proxyId);
 }
 
@@ -198,10 +232,17 @@ void b2BroadPhase::UpdatePairs(T* callback)
 
 		// We have to query the tree with the fat AABB so that
 		// we don't fail to create a pair that may touch later.
-		const b2AABB& fatAABB = m_tree.GetFatAABB(m_queryProxyId);
+		const b2AABB& fatAABB = GetFatAABB(m_queryProxyId);
 
 		// Query tree, create pairs and add them pair buffer.
-		m_tree.Query(this, fatAABB);
+		if (m_type == e_spatialHash)
+		{
+			m_grid.Query(this, fatAABB);
+		}
+		else
+		{
+			m_tree.Query(this, fatAABB);
+		}
 	}
 
 	// Reset move buffer
@@ -215,8 +256,8 @@ void b2BroadPhase::UpdatePairs(T* callback)
 	while (i < m_pairCount)
 	{
 		b2Pair* primaryPair = m_pairBuffer + i;
-		void* userDataA = m_tree.GetUserData(primaryPair->proxyIdA);
-		void* userDataB = m_tree.GetUserData(primaryPair->proxyIdB);
+		void* userDataA = GetUserData(primaryPair->proxyIdA);
+		void* userDataB = GetUserData(primaryPair->proxyIdB);
 
 		callback->AddPair(userDataA, userDataB);
 		++i;
@@ -240,18 +281,39 @@ void b2BroadPhase::UpdatePairs(T* callback)
 template <typename T>
 inline void b2BroadPhase::Query(T* callback, const b2AABB& aabb) const
 {
-	m_tree.Query(callback, aabb);
+	if (m_type == e_spatialHash)
+	{
+		m_grid.Query(callback, aabb);
+	}
+	else
+	{
+		m_tree.Query(callback, aabb);
+	}
 }
 
 template <typename T>
 inline void b2BroadPhase::RayCast(T* callback, const b2RayCastInput& input) const
 {
-	m_tree.RayCast(callback, input);
+	if (m_type == e_spatialHash)
+	{
+		m_grid.RayCast(callback, input);
+	}
+	else
+	{
+		m_tree.RayCast(callback, input);
+	}
 }
 
 inline void b2BroadPhase::ShiftOrigin(const b2Vec2& newOrigin)
 {
-	m_tree.ShiftOrigin(newOrigin);
+	if (m_type == e_spatialHash)
+	{
+		m_grid.ShiftOrigin(newOrigin);
+	}
+	else
+	{
+		m_tree.ShiftOrigin(newOrigin);
+	}
 }
 
 #endif
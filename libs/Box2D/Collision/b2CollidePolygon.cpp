@@ -18,6 +18,76 @@
 
 #include <Box2D/Collision/b2Collision.h>
 #include <Box2D/Collision/Shapes/b2PolygonShape.h>
+#include <Box2D/Common/b2Simd.h>
+
+// Points per register, as x, y pairs.
+static const int32 b2_pointsPerW = B2_SIMD_WIDTH / 2;
+
+// The vertices of a polygon loaded as x, y pairs. A partial last register
+// is padded with the first vertex, which leaves the minimum unchanged.
+struct b2PolygonW
+{
+	explicit b2PolygonW(const b2PolygonShape* poly)
+	{
+		int32 count = poly->m_count;
+		const b2Vec2* vs = poly->m_vertices;
+		int32 fullCount = count - count % b2_pointsPerW;
+
+		m_count = 0;
+		for (int32 i = 0; i < fullCount; i += b2_pointsPerW)
+		{
+			m_vertices[m_count++] = b2LoadW(&vs[i].x);
+		}
+
+		if (fullCount < count)
+		{
+			b2Vec2 tail[b2_pointsPerW];
+			for (int32 i = 0; i < b2_pointsPerW; ++i)
+			{
+				tail[i] = fullCount + i < count ? vs[fullCount + i] : vs[0];
+			}
+			m_vertices[m_count++] = b2LoadW(&tail[0].x);
+		}
+	}
+
+	// The smallest b2Dot(n, v - v1) over the vertices v. The even lanes of
+	// n.x * dx + n.y * dy and the odd lanes of n.y * dy + n.x * dx are the
+	// same sum, so this matches the scalar loop exactly.
+	float32 Separation(const b2Vec2& n, const b2Vec2& v1) const
+	{
+		b2FloatW nW = b2SplatPairW(n.x, n.y);
+		b2FloatW v1W = b2SplatPairW(v1.x, v1.y);
+
+		b2FloatW s = b2SplatW(b2_maxFloat);
+		for (int32 i = 0; i < m_count; ++i)
+		{
+			b2FloatW m = b2MulW(nW, b2SubW(m_vertices[i], v1W));
+			s = b2MinW(s, b2AddW(m, b2SwapPairsW(m)));
+		}
+
+		float32 lanes[B2_SIMD_WIDTH];
+		b2StoreW(lanes, s);
+		float32 si = lanes[0];
+		for (int32 i = 2; i < B2_SIMD_WIDTH; i += 2)
+		{
+			si = b2Min(si, lanes[i]);
+		}
+		return si;
+	}
+
+	b2FloatW m_vertices[(2 * b2_maxPolygonVertices + B2_SIMD_WIDTH - 1) / B2_SIMD_WIDTH];
+	int32 m_count;
+};
+
+// The separation of poly2 along edge normal i of poly1.
+static float32 b2EdgeSeparation(const b2PolygonShape* poly1, const b2Transform& xf1, int32 i,
+								const b2PolygonShape* poly2, const b2Transform& xf2)
+{
+	b2Transform xf = b2MulT(xf2, xf1);
+	b2Vec2 n = b2Mul(xf.q, poly1->m_normals[i]);
+	b2Vec2 v1 = b2Mul(xf, poly1->m_vertices[i]);
+	return b2PolygonW(poly2).Separation(n, v1);
+}
 
 // Find the max separation between poly1 and poly2 using edge normals from poly1.
 static float32 b2FindMaxSeparation(int32* edgeIndex,
@@ -25,10 +95,9 @@ static float32 b2FindMaxSeparation(int32* edgeIndex,
 								 const b2PolygonShape* poly2, const b2Transform& xf2)
 {
 	int32 count1 = poly1->m_count;
-	int32 count2 = poly2->m_count;
 	const b2Vec2* n1s = poly1->m_normals;
 	const b2Vec2* v1s = poly1->m_vertices;
-	const b2Vec2* v2s = poly2->m_vertices;
+	b2PolygonW poly2W(poly2);
 	b2Transform xf = b2MulT(xf2, xf1);
 
 	int32 bestIndex = 0;
@@ -40,15 +109,7 @@ static float32 b2FindMaxSeparation(int32* edgeIndex,
 		b2Vec2 v1 = b2Mul(xf, v1s[i]);
 
 		// Find deepest point for normal i.
-		float32 si = b2_maxFloat;
-		for (int32 j = 0; j < count2; ++j)
-		{
-			float32 sij = b2Dot(n, v2s[j] - v1);
-			if (sij < si)
-			{
-				si = sij;
-			}
-		}
+		float32 si = poly2W.Separation(n, v1);
 
 		if (si > maxSeparation)
 		{
@@ -106,8 +167,10 @@ static void b2FindIncidentEdge(b2ClipVertex c[2],
 	c[1].id.cf.typeB = b2ContactFeature::e_vertex;
 }
 
+// Test the cached separating axis - return if it still separates
 // Find edge normal of max separation on A - return if separating axis is found
 // Find edge normal of max separation on B - return if separation axis is found
+// Cache the separating axis, if any
 // Choose reference edge as min(minA, minB)
 // Find incident edge
 // Clip
@@ -115,20 +178,55 @@ static void b2FindIncidentEdge(b2ClipVertex c[2],
 // The normal points from 1 to 2
 void b2CollidePolygons(b2Manifold* manifold,
 					  const b2PolygonShape* polyA, const b2Transform& xfA,
-					  const b2PolygonShape* polyB, const b2Transform& xfB)
+					  const b2PolygonShape* polyB, const b2Transform& xfB,
+					  float32 margin, b2SATCache* cache)
 {
 	manifold->pointCount = 0;
 	float32 totalRadius = polyA->m_radius + polyB->m_radius;
+	float32 maxSeparation = totalRadius + margin;
+
+	// Any separating axis gives the same empty manifold as the full search.
+	if (cache && cache->type != b2SATCache::e_none)
+	{
+		float32 separation = -b2_maxFloat;
+		if (cache->type == b2SATCache::e_faceA && cache->index < polyA->m_count)
+		{
+			separation = b2EdgeSeparation(polyA, xfA, cache->index, polyB, xfB);
+		}
+		else if (cache->type == b2SATCache::e_faceB && cache->index < polyB->m_count)
+		{
+			separation = b2EdgeSeparation(polyB, xfB, cache->index, polyA, xfA);
+		}
+
+		if (separation > maxSeparation)
+			return;
+
+		cache->type = b2SATCache::e_none;
+	}
 
 	int32 edgeA = 0;
 	float32 separationA = b2FindMaxSeparation(&edgeA, polyA, xfA, polyB, xfB);
-	if (separationA > totalRadius)
+	if (separationA > maxSeparation)
+	{
+		if (cache)
+		{
+			cache->type = b2SATCache::e_faceA;
+			cache->index = (uint8)edgeA;
+		}
 		return;
+	}
 
 	int32 edgeB = 0;
 	float32 separationB = b2FindMaxSeparation(&edgeB, polyB, xfB, polyA, xfA);
-	if (separationB > totalRadius)
+	if (separationB > maxSeparation)
+	{
+		if (cache)
+		{
+			cache->type = b2SATCache::e_faceB;
+			cache->index = (uint8)edgeB;
+		}
 		return;
+	}
 
 	const b2PolygonShape* poly1;	// reference polygon
 	const b2PolygonShape* poly2;	// incident polygon
@@ -217,7 +315,7 @@ void b2CollidePolygons(b2Manifold* manifold,
 	{
 		float32 separation = b2Dot(normal, clipPoints2[i].v) - frontOffset;
 
-		if (separation <= totalRadius)
+		if (separation <= maxSeparation)
 		{
 			b2ManifoldPoint* cp = manifold->points + pointCount;
 			cp->localPoint = b2MulT(xf2, clipPoints2[i].v);
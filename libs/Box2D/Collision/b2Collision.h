@@ -215,30 +215,55 @@ struct b2AABB
 	b2Vec2 upperBound;	///< the upper vertex
 };
 
+/// The last separating axis found by b2CollidePolygons. Bodies that
+/// were apart last step are usually apart along the same axis, so it
+/// is tested before the full search.
+struct b2SATCache
+{
+	enum Type
+	{
+		e_none,
+		e_faceA,
+		e_faceB
+	};
+
+	uint8 type;
+	uint8 index;
+};
+
+/// The collide functions below keep points that are up to margin apart
+/// as speculative points with a positive separation.
+
 /// Compute the collision manifold between two circles.
 void b2CollideCircles(b2Manifold* manifold,
 					  const b2CircleShape* circleA, const b2Transform& xfA,
-					  const b2CircleShape* circleB, const b2Transform& xfB);
+					  const b2CircleShape* circleB, const b2Transform& xfB,
+					  float32 margin = 0.0f);
 
 /// Compute the collision manifold between a polygon and a circle.
 void b2CollidePolygonAndCircle(b2Manifold* manifold,
 							   const b2PolygonShape* polygonA, const b2Transform& xfA,
-							   const b2CircleShape* circleB, const b2Transform& xfB);
+							   const b2CircleShape* circleB, const b2Transform& xfB,
+							   float32 margin = 0.0f);
 
-/// Compute the collision manifold between two polygons.
+/// Compute the collision manifold between two polygons. The optional
+/// cache is read and updated in place.
 void b2CollidePolygons(b2Manifold* manifold,
 					   const b2PolygonShape* polygonA, const b2Transform& xfA,
-					   const b2PolygonShape* polygonB, const b2Transform& xfB);
+					   const b2PolygonShape* polygonB, const b2Transform& xfB,
+					   float32 margin = 0.0f, b2SATCache* cache = NULL);
 
 /// Compute the collision manifold between an edge and a circle.
 void b2CollideEdgeAndCircle(b2Manifold* manifold,
 							   const b2EdgeShape* polygonA, const b2Transform& xfA,
-							   const b2CircleShape* circleB, const b2Transform& xfB);
+							   const b2CircleShape* circleB, const b2Transform& xfB,
+							   float32 margin = 0.0f);
 
 /// Compute the collision manifold between an edge and a circle.
 void b2CollideEdgeAndPolygon(b2Manifold* manifold,
 							   const b2EdgeShape* edgeA, const b2Transform& xfA,
-							   const b2PolygonShape* circleB, const b2Transform& xfB);
+							   const b2PolygonShape* circleB, const b2Transform& xfB,
+							   float32 margin = 0.0f);
 
 /// Clipping for contact manifolds.
 int32 b2ClipSegmentToLine(b2ClipVertex vOut[2], const b2ClipVertex vIn[2],
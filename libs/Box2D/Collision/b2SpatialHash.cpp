@@ -0,0 +1,341 @@
+/*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Collision/b2SpatialHash.h>
+#include <algorithm>
+#include <string.h>
+
+// Cell coordinates are clamped so huge AABBs can't overflow the conversion.
+static const float32 b2_maxCellCoordinate = 1 << 20;
+
+b2SpatialHash::b2SpatialHash()
+{
+	m_proxyCapacity = 16;
+	m_proxyCount = 0;
+	m_proxies = (b2SpatialHashProxy*)b2Alloc(m_proxyCapacity * sizeof(b2SpatialHashProxy));
+	memset(m_proxies, 0, m_proxyCapacity * sizeof(b2SpatialHashProxy));
+
+	// Build a linked list for the free list.
+	for (int32 i = 0; i < m_proxyCapacity - 1; ++i)
+	{
+		m_proxies[i].next = i + 1;
+	}
+	m_proxies[m_proxyCapacity-1].next = b2_nullSpatialHashProxy;
+	m_freeList = 0;
+
+	m_entryCapacity = 16;
+	m_entryCount = 0;
+	m_entries = (b2SpatialHashEntry*)b2Alloc(m_entryCapacity * sizeof(b2SpatialHashEntry));
+
+	m_oversizedCapacity = 16;
+	m_oversizedCount = 0;
+	m_oversized = (int32*)b2Alloc(m_oversizedCapacity * sizeof(int32));
+
+	m_queryStamp = 0;
+	m_dirty = false;
+
+	SetCellSize(1.0f);
+}
+
+b2SpatialHash::~b2SpatialHash()
+{
+	b2Free(m_oversized);
+	b2Free(m_entries);
+	b2Free(m_proxies);
+}
+
+void b2SpatialHash::SetCellSize(float32 cellSize)
+{
+	b2Assert(cellSize > 0.0f);
+	m_cellSize = cellSize;
+	m_inverseCellSize = 1.0f / cellSize;
+	m_dirty = true;
+}
+
+int32 b2SpatialHash::AllocateProxy()
+{
+	// Expand the proxy pool if needed.
+	if (m_freeList == b2_nullSpatialHashProxy)
+	{
+		b2Assert(m_proxyCount == m_proxyCapacity);
+
+		b2SpatialHashProxy* oldProxies = m_proxies;
+		m_proxyCapacity *= 2;
+		m_proxies = (b2SpatialHashProxy*)b2Alloc(m_proxyCapacity * sizeof(b2SpatialHashProxy));
+		memcpy(m_proxies, oldProxies, m_proxyCount * sizeof(b2SpatialHashProxy));
+		memset(m_proxies + m_proxyCount, 0, (m_proxyCapacity - m_proxyCount) * sizeof(b2SpatialHashProxy));
+		b2Free(oldProxies);
+
+		for (int32 i = m_proxyCount; i < m_proxyCapacity - 1; ++i)
+		{
+			m_proxies[i].next = i + 1;
+		}
+		m_proxies[m_proxyCapacity-1].next = b2_nullSpatialHashProxy;
+		m_freeList = m_proxyCount;
+	}
+
+	int32 proxyId = m_freeList;
+	m_freeList = m_proxies[proxyId].next;
+	m_proxies[proxyId].next = b2_nullSpatialHashProxy;
+	m_proxies[proxyId].allocated = true;
+	m_proxies[proxyId].queryStamp = m_queryStamp;
+	m_proxies[proxyId].oversized = false;
+	++m_proxyCount;
+	return proxyId;
+}
+
+void b2SpatialHash::FreeProxy(int32 proxyId)
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	b2Assert(0 < m_proxyCount);
+	m_proxies[proxyId].next = m_freeList;
+	m_proxies[proxyId].allocated = false;
+	m_freeList = proxyId;
+	--m_proxyCount;
+}
+
+int32 b2SpatialHash::CreateProxy(const b2AABB& aabb, void* userData)
+{
+	int32 proxyId = AllocateProxy();
+
+	// Fatten the aabb.
+	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
+	m_proxies[proxyId].aabb.lowerBound = aabb.lowerBound - r;
+	m_proxies[proxyId].aabb.upperBound = aabb.upperBound + r;
+	m_proxies[proxyId].userData = userData;
+
+	m_dirty = true;
+	return proxyId;
+}
+
+void b2SpatialHash::DestroyProxy(int32 proxyId)
+{
+	FreeProxy(proxyId);
+	m_dirty = true;
+}
+
+bool b2SpatialHash::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	b2Assert(m_proxies[proxyId].allocated);
+
+	if (m_proxies[proxyId].aabb.Contains(aabb))
+	{
+		return false;
+	}
+
+	// Extend AABB.
+	b2AABB b = aabb;
+	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
+	b.lowerBound = b.lowerBound - r;
+	b.upperBound = b.upperBound + r;
+
+	// Predict AABB displacement.
+	b2Vec2 d = b2_aabbMultiplier * displacement;
+
+	if (d.x < 0.0f)
+	{
+		b.lowerBound.x += d.x;
+	}
+	else
+	{
+		b.upperBound.x += d.x;
+	}
+
+	if (d.y < 0.0f)
+	{
+		b.lowerBound.y += d.y;
+	}
+	else
+	{
+		b.upperBound.y += d.y;
+	}
+
+	m_proxies[proxyId].aabb = b;
+
+	m_dirty = true;
+	return true;
+}
+
+void b2SpatialHash::ShiftOrigin(const b2Vec2& newOrigin)
+{
+	for (int32 i = 0; i < m_proxyCapacity; ++i)
+	{
+		m_proxies[i].aabb.lowerBound -= newOrigin;
+		m_proxies[i].aabb.upperBound -= newOrigin;
+	}
+	m_dirty = true;
+}
+
+inline int32 b2SpatialHash::CellCoordinate(float32 x) const
+{
+	float32 c = b2Clamp(x * m_inverseCellSize,
+						-b2_maxCellCoordinate, b2_maxCellCoordinate);
+	return (int32)floorf(c);
+}
+
+inline uint32 b2SpatialHash::HashCell(int32 x, int32 y)
+{
+	// Distinct cells may share a hash; that only adds candidates which
+	// are rejected by the AABB test.
+	return ((uint32)x * 73856093u) ^ ((uint32)y * 19349663u);
+}
+
+bool b2SpatialHash::EntryLessThan(const b2SpatialHashEntry& a,
+								  const b2SpatialHashEntry& b)
+{
+	if (a.cell != b.cell)
+	{
+		return a.cell < b.cell;
+	}
+	return a.proxyId < b.proxyId;
+}
+
+void b2SpatialHash::Rebuild() const
+{
+	m_entryCount = 0;
+	m_oversizedCount = 0;
+	for (int32 proxyId = 0; proxyId < m_proxyCapacity; ++proxyId)
+	{
+		b2SpatialHashProxy& proxy = m_proxies[proxyId];
+		if (!proxy.allocated)
+		{
+			continue;
+		}
+
+		int32 x0 = CellCoordinate(proxy.aabb.lowerBound.x);
+		int32 y0 = CellCoordinate(proxy.aabb.lowerBound.y);
+		int32 x1 = CellCoordinate(proxy.aabb.upperBound.x);
+		int32 y1 = CellCoordinate(proxy.aabb.upperBound.y);
+		// Coordinates reach 2^20, check each span before the product
+		// can overflow.
+		int32 width = x1 - x0 + 1;
+		int32 height = y1 - y0 + 1;
+		proxy.oversized = width > e_maxProxyCells || height > e_maxProxyCells ||
+			width * height > e_maxProxyCells;
+		if (proxy.oversized)
+		{
+			if (m_oversizedCount == m_oversizedCapacity)
+			{
+				int32* oldBuffer = m_oversized;
+				m_oversizedCapacity *= 2;
+				m_oversized = (int32*)b2Alloc(m_oversizedCapacity * sizeof(int32));
+				memcpy(m_oversized, oldBuffer, m_oversizedCount * sizeof(int32));
+				b2Free(oldBuffer);
+			}
+			m_oversized[m_oversizedCount++] = proxyId;
+			continue;
+		}
+
+		int32 cellCount = width * height;
+		if (m_entryCount + cellCount > m_entryCapacity)
+		{
+			b2SpatialHashEntry* oldBuffer = m_entries;
+			m_entryCapacity = b2Max(2 * m_entryCapacity, m_entryCount + cellCount);
+			m_entries = (b2SpatialHashEntry*)b2Alloc(m_entryCapacity * sizeof(b2SpatialHashEntry));
+			memcpy(m_entries, oldBuffer, m_entryCount * sizeof(b2SpatialHashEntry));
+			b2Free(oldBuffer);
+		}
+		for (int32 y = y0; y <= y1; ++y)
+		{
+			for (int32 x = x0; x <= x1; ++x)
+			{
+				b2SpatialHashEntry& entry = m_entries[m_entryCount++];
+				entry.cell = HashCell(x, y);
+				entry.proxyId = proxyId;
+			}
+		}
+	}
+
+	std::sort(m_entries, m_entries + m_entryCount, EntryLessThan);
+	m_dirty = false;
+}
+
+void b2SpatialHash::GatherCandidates(const b2AABB& aabb,
+									 b2GrowableStack<int32, 256>* candidates) const
+{
+	if (m_dirty)
+	{
+		Rebuild();
+	}
+
+	// Stamps only need to be unique per gather, reset them on wrap around.
+	if (++m_queryStamp == 0)
+	{
+		for (int32 i = 0; i < m_proxyCapacity; ++i)
+		{
+			m_proxies[i].queryStamp = 0;
+		}
+		m_queryStamp = 1;
+	}
+	const uint32 stamp = m_queryStamp;
+
+	int32 x0 = CellCoordinate(aabb.lowerBound.x);
+	int32 y0 = CellCoordinate(aabb.lowerBound.y);
+	int32 x1 = CellCoordinate(aabb.upperBound.x);
+	int32 y1 = CellCoordinate(aabb.upperBound.y);
+	float32 cellCount = (float32)(x1 - x0 + 1) * (float32)(y1 - y0 + 1);
+
+	if (cellCount > (float32)m_proxyCount)
+	{
+		// Visiting the cells would cost more than testing every proxy.
+		for (int32 proxyId = 0; proxyId < m_proxyCapacity; ++proxyId)
+		{
+			const b2SpatialHashProxy& proxy = m_proxies[proxyId];
+			if (proxy.allocated && b2TestOverlap(proxy.aabb, aabb))
+			{
+				candidates->Push(proxyId);
+			}
+		}
+		return;
+	}
+
+	const b2SpatialHashEntry* begin = m_entries;
+	const b2SpatialHashEntry* end = m_entries + m_entryCount;
+	for (int32 y = y0; y <= y1; ++y)
+	{
+		for (int32 x = x0; x <= x1; ++x)
+		{
+			b2SpatialHashEntry key;
+			key.cell = HashCell(x, y);
+			key.proxyId = -1;
+			for (const b2SpatialHashEntry* entry =
+					std::lower_bound(begin, end, key, EntryLessThan);
+				 entry < end && entry->cell == key.cell; ++entry)
+			{
+				b2SpatialHashProxy& proxy = m_proxies[entry->proxyId];
+				if (proxy.queryStamp == stamp)
+				{
+					continue;
+				}
+				proxy.queryStamp = stamp;
+				if (b2TestOverlap(proxy.aabb, aabb))
+				{
+					candidates->Push(entry->proxyId);
+				}
+			}
+		}
+	}
+
+	for (int32 i = 0; i < m_oversizedCount; ++i)
+	{
+		int32 proxyId = m_oversized[i];
+		if (b2TestOverlap(m_proxies[proxyId].aabb, aabb))
+		{
+			candidates->Push(proxyId);
+		}
+	}
+}
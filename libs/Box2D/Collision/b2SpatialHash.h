@@ -0,0 +1,254 @@
+/*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_SPATIAL_HASH_H
+#define B2_SPATIAL_HASH_H
+
+#include <Box2D/Collision/b2Collision.h>
+#include <Box2D/Common/b2GrowableStack.h>
+
+#define b2_nullSpatialHashProxy (-1)
+
+/// A proxy in the spatial hash. The client does not interact with this directly.
+struct b2SpatialHashProxy
+{
+	/// Enlarged AABB
+	b2AABB aabb;
+
+	void* userData;
+
+	/// Next proxy in the free list.
+	int32 next;
+
+	/// Is this proxy in use?
+	bool allocated;
+
+	/// Last query that visited this proxy, used to report it only once
+	/// when it overlaps several cells.
+	uint32 queryStamp;
+
+	/// Proxies that span too many cells are kept out of the grid and
+	/// tested by every query instead.
+	bool oversized;
+};
+
+/// A cell/proxy pair. Entries are sorted by cell so that the proxies of
+/// a cell are contiguous.
+struct b2SpatialHashEntry
+{
+	uint32 cell;
+	int32 proxyId;
+};
+
+/// A uniform grid broad-phase. Each fat AABB is inserted in every cell it
+/// overlaps, cells are hashed so the grid is unbounded. This beats the
+/// dynamic tree for swarms of similarly sized objects where the cell size
+/// can be picked close to the object size; large objects (such as ground
+/// edges) are handled by a brute force list.
+/// Proxy ids and the Query/RayCast callbacks match b2DynamicTree so the
+/// two can be used interchangeably by b2BroadPhase.
+class b2SpatialHash
+{
+public:
+	/// Proxies covering more cells than this bypass the grid.
+	enum { e_maxProxyCells = 16 };
+
+	b2SpatialHash();
+	~b2SpatialHash();
+
+	/// Set the size of a cell. Works best around the size of the typical
+	/// proxy (for example the diameter of a swarm of circles).
+	void SetCellSize(float32 cellSize);
+
+	/// Get the size of a cell.
+	float32 GetCellSize() const;
+
+	/// Create a proxy with a fattened copy of the AABB.
+	int32 CreateProxy(const b2AABB& aabb, void* userData);
+
+	/// Destroy a proxy.
+	void DestroyProxy(int32 proxyId);
+
+	/// Move a proxy with a swepted AABB. If the proxy has moved outside of
+	/// its fattened AABB, then the proxy is re-binned and true is returned.
+	bool MoveProxy(int32 proxyId, const b2AABB& aabb1, const b2Vec2& displacement);
+
+	/// Get proxy user data.
+	void* GetUserData(int32 proxyId) const;
+
+	/// Get the fat AABB for a proxy.
+	const b2AABB& GetFatAABB(int32 proxyId) const;
+
+	/// Query an AABB for overlapping proxies. The callback class
+	/// is called once for each proxy that overlaps the supplied AABB.
+	template <typename T>
+	void Query(T* callback, const b2AABB& aabb) const;
+
+	/// Ray-cast against the proxies in the grid. Same contract as
+	/// b2DynamicTree::RayCast.
+	template <typename T>
+	void RayCast(T* callback, const b2RayCastInput& input) const;
+
+	/// Shift the world origin. Useful for large worlds.
+	/// The shift formula is: position -= newOrigin
+	/// @param newOrigin the new origin with respect to the old origin
+	void ShiftOrigin(const b2Vec2& newOrigin);
+
+private:
+
+	int32 AllocateProxy();
+	void FreeProxy(int32 proxyId);
+
+	/// Re-bin every proxy and sort the entries by cell.
+	void Rebuild() const;
+
+	/// Collect the ids of the proxies whose fat AABB overlaps aabb, each
+	/// one at most once.
+	void GatherCandidates(const b2AABB& aabb,
+						  b2GrowableStack<int32, 256>* candidates) const;
+
+	int32 CellCoordinate(float32 x) const;
+	static uint32 HashCell(int32 x, int32 y);
+	static bool EntryLessThan(const b2SpatialHashEntry& a,
+							  const b2SpatialHashEntry& b);
+
+	b2SpatialHashProxy* m_proxies;
+	int32 m_proxyCount;
+	int32 m_proxyCapacity;
+	int32 m_freeList;
+
+	float32 m_cellSize;
+	float32 m_inverseCellSize;
+
+	// Binning is lazy: moves only mark the grid dirty and the next query
+	// rebuilds it once.
+	mutable b2SpatialHashEntry* m_entries;
+	mutable int32 m_entryCount;
+	mutable int32 m_entryCapacity;
+	mutable int32* m_oversized;
+	mutable int32 m_oversizedCount;
+	mutable int32 m_oversizedCapacity;
+	mutable uint32 m_queryStamp;
+	mutable bool m_dirty;
+};
+
+inline float32 b2SpatialHash::GetCellSize() const
+{
+	return m_cellSize;
+}
+
+inline void* b2SpatialHash::GetUserData(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	return m_proxies[proxyId].userData;
+}
+
+inline const b2AABB& b2SpatialHash::GetFatAABB(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	return m_proxies[proxyId].aabb;
+}
+
+template <typename T>
+inline void b2SpatialHash::Query(T* callback, const b2AABB& aabb) const
+{
+	// Gather first so that callbacks are free to run nested queries.
+	b2GrowableStack<int32, 256> candidates;
+	GatherCandidates(aabb, &candidates);
+
+	while (candidates.GetCount() > 0)
+	{
+		int32 proxyId = candidates.Pop();
+		bool proceed = callback->QueryCallback(proxyId);
+		if (proceed == false)
+		{
+			return;
+		}
+	}
+}
+
+template <typename T>
+inline void b2SpatialHash::RayCast(T* callback, const b2RayCastInput& input) const
+{
+	b2Vec2 p1 = input.p1;
+	b2Vec2 p2 = input.p2;
+	b2Vec2 r = p2 - p1;
+	b2Assert(r.LengthSquared() > 0.0f);
+	r.Normalize();
+
+	// v is perpendicular to the segment.
+	b2Vec2 v = b2Cross(1.0f, r);
+	b2Vec2 abs_v = b2Abs(v);
+
+	float32 maxFraction = input.maxFraction;
+
+	// Build a bounding box for the segment.
+	b2AABB segmentAABB;
+	{
+		b2Vec2 t = p1 + maxFraction * (p2 - p1);
+		segmentAABB.lowerBound = b2Min(p1, t);
+		segmentAABB.upperBound = b2Max(p1, t);
+	}
+
+	b2GrowableStack<int32, 256> candidates;
+	GatherCandidates(segmentAABB, &candidates);
+
+	while (candidates.GetCount() > 0)
+	{
+		int32 proxyId = candidates.Pop();
+		const b2AABB& aabb = m_proxies[proxyId].aabb;
+
+		// The segment may have been clipped by an earlier hit.
+		if (b2TestOverlap(aabb, segmentAABB) == false)
+		{
+			continue;
+		}
+
+		// Separating axis for segment (Gino, p80).
+		// |dot(v, p1 - c)| > dot(|v|, h)
+		b2Vec2 c = aabb.GetCenter();
+		b2Vec2 h = aabb.GetExtents();
+		float32 separation = b2Abs(b2Dot(v, p1 - c)) - b2Dot(abs_v, h);
+		if (separation > 0.0f)
+		{
+			continue;
+		}
+
+		b2RayCastInput subInput;
+		subInput.p1 = input.p1;
+		subInput.p2 = input.p2;
+		subInput.maxFraction = maxFraction;
+
+		float32 value = callback->RayCastCallback(subInput, proxyId);
+
+		if (value == 0.0f)
+		{
+			// The client has terminated the ray cast.
+			return;
+		}
+
+		if (value > 0.0f)
+		{
+			// Update segment bounding box.
+			maxFraction = value;
+			b2Vec2 t = p1 + maxFraction * (p2 - p1);
+			segmentAABB.lowerBound = b2Min(p1, t);
+			segmentAABB.upperBound = b2Max(p1, t);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,181 @@
+/*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Common/b2BatchMath.h>
+#include <Box2D/Common/b2Simd.h>
+#include <Box2D/Collision/b2Collision.h>
+#include <string.h>
+
+// Points per register, as x, y pairs.
+static const int32 b2_pointsPerW = B2_SIMD_WIDTH / 2;
+
+static const float32 b2_pairSigns[8] = {-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f};
+
+// The rotation and translation of a transform spread over x, y pairs.
+struct b2TransformW
+{
+	explicit b2TransformW(const b2Transform& xf)
+	{
+		c = b2SplatW(xf.q.c);
+		s = b2MulW(b2SplatW(xf.q.s), b2LoadW(b2_pairSigns));
+		p = b2SplatPairW(xf.p.x, xf.p.y);
+	}
+
+	// Same operations as b2Mul(xf, v): x' = (c * x - s * y) + px and
+	// y' = (s * x + c * y) + py.
+	b2FloatW Apply(b2FloatW v) const
+	{
+		return b2AddW(b2AddW(b2MulW(c, v), b2MulW(s, b2SwapPairsW(v))), p);
+	}
+
+	b2FloatW c, s, p;
+};
+
+void b2TransformPoints(b2Vec2* out, const b2Transform& xf, const b2Vec2* points, int32 count)
+{
+	b2TransformW xfW(xf);
+
+	int32 i = 0;
+	for (; i + b2_pointsPerW <= count; i += b2_pointsPerW)
+	{
+		b2StoreW(&out[i].x, xfW.Apply(b2LoadW(&points[i].x)));
+	}
+
+	if (i < count)
+	{
+		float32 buffer[B2_SIMD_WIDTH] = {0.0f};
+		int32 rest = count - i;
+		memcpy(buffer, points + i, rest * sizeof(b2Vec2));
+		b2StoreW(buffer, xfW.Apply(b2LoadW(buffer)));
+		memcpy(out + i, buffer, rest * sizeof(b2Vec2));
+	}
+}
+
+void b2ComputeAABBs(b2AABB* aabbs, const b2Transform* xfs, int32 count,
+					const b2Vec2* points, int32 pointCount, float32 radius)
+{
+	b2Assert(pointCount > 0);
+
+	// A partial last register is padded with the first point, which
+	// leaves the bounds unchanged.
+	int32 fullCount = pointCount - pointCount % b2_pointsPerW;
+	b2FloatW tailW = b2ZeroW();
+	bool hasTail = fullCount < pointCount;
+	if (hasTail)
+	{
+		b2Vec2 tail[b2_pointsPerW];
+		for (int32 i = 0; i < b2_pointsPerW; ++i)
+		{
+			tail[i] = fullCount + i < pointCount ? points[fullCount + i] : points[0];
+		}
+		tailW = b2LoadW(&tail[0].x);
+	}
+
+	for (int32 k = 0; k < count; ++k)
+	{
+		b2TransformW xfW(xfs[k]);
+
+		b2FloatW lower, upper;
+		int32 i = 0;
+		if (hasTail)
+		{
+			lower = xfW.Apply(tailW);
+		}
+		else
+		{
+			lower = xfW.Apply(b2LoadW(&points[0].x));
+			i = b2_pointsPerW;
+		}
+		upper = lower;
+
+		for (; i < fullCount; i += b2_pointsPerW)
+		{
+			b2FloatW v = xfW.Apply(b2LoadW(&points[i].x));
+			lower = b2MinW(lower, v);
+			upper = b2MaxW(upper, v);
+		}
+
+		float32 lowerLanes[B2_SIMD_WIDTH];
+		float32 upperLanes[B2_SIMD_WIDTH];
+		b2StoreW(lowerLanes, lower);
+		b2StoreW(upperLanes, upper);
+
+		b2Vec2 lowerBound(lowerLanes[0], lowerLanes[1]);
+		b2Vec2 upperBound(upperLanes[0], upperLanes[1]);
+		for (int32 j = 2; j < B2_SIMD_WIDTH; j += 2)
+		{
+			lowerBound = b2Min(lowerBound, b2Vec2(lowerLanes[j], lowerLanes[j + 1]));
+			upperBound = b2Max(upperBound, b2Vec2(upperLanes[j], upperLanes[j + 1]));
+		}
+
+		b2Vec2 r(radius, radius);
+		aabbs[k].lowerBound = lowerBound - r;
+		aabbs[k].upperBound = upperBound + r;
+	}
+}
+
+// Reduce to [-pi, pi] in two parts so k * 2pi stays exact, fold onto
+// [-pi/2, pi/2] with sin(x) = sin(pi - x), then use the Taylor series to
+// x^11, which is within 6e-8 of sin on that interval.
+static b2FloatW b2SinW(b2FloatW x)
+{
+	const float32 k_twoPiHigh = 6.28125f;
+	const float32 k_twoPiLow = 1.9353071795864769e-3f;
+	b2FloatW k = b2RoundW(b2MulW(x, b2SplatW(0.5f / b2_pi)));
+	x = b2SubW(b2SubW(x, b2MulW(k, b2SplatW(k_twoPiHigh))), b2MulW(k, b2SplatW(k_twoPiLow)));
+
+	x = b2MaxW(b2MinW(x, b2SubW(b2SplatW(b2_pi), x)), b2SubW(b2SplatW(-b2_pi), x));
+
+	b2FloatW x2 = b2MulW(x, x);
+	b2FloatW p = b2SplatW(-1.0f / 39916800.0f);
+	p = b2AddW(b2MulW(p, x2), b2SplatW(1.0f / 362880.0f));
+	p = b2AddW(b2MulW(p, x2), b2SplatW(-1.0f / 5040.0f));
+	p = b2AddW(b2MulW(p, x2), b2SplatW(1.0f / 120.0f));
+	p = b2AddW(b2MulW(p, x2), b2SplatW(-1.0f / 6.0f));
+	p = b2AddW(b2MulW(p, x2), b2SplatW(1.0f));
+	return b2MulW(x, p);
+}
+
+void b2ComputeRotations(b2Rot* out, const float32* angles, int32 count)
+{
+	b2FloatW halfPi = b2SplatW(0.5f * b2_pi);
+	float32 sines[B2_SIMD_WIDTH];
+	float32 cosines[B2_SIMD_WIDTH];
+
+	for (int32 i = 0; i < count; i += B2_SIMD_WIDTH)
+	{
+		int32 rest = b2Min(count - i, B2_SIMD_WIDTH);
+		b2FloatW a;
+		if (rest == B2_SIMD_WIDTH)
+		{
+			a = b2LoadW(angles + i);
+		}
+		else
+		{
+			float32 buffer[B2_SIMD_WIDTH] = {0.0f};
+			memcpy(buffer, angles + i, rest * sizeof(float32));
+			a = b2LoadW(buffer);
+		}
+
+		b2StoreW(sines, b2SinW(a));
+		b2StoreW(cosines, b2SinW(b2AddW(a, halfPi)));
+		for (int32 j = 0; j < rest; ++j)
+		{
+			out[i + j].s = sines[j];
+			out[i + j].c = cosines[j];
+		}
+	}
+}
@@ -0,0 +1,44 @@
+/*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_BATCH_MATH_H
+#define B2_BATCH_MATH_H
+
+#include <Box2D/Common/b2Math.h>
+
+struct b2AABB;
+
+/// Batch versions of the b2Math helpers, run B2_SIMD_WIDTH floats at a
+/// time. Points are processed as interleaved x, y pairs, so no layout
+/// change is needed. Transformed points and AABBs match the scalar
+/// b2Mul and b2Shape::ComputeAABB bit for bit.
+
+/// Transform count points by xf. out may be the same array as points.
+void b2TransformPoints(b2Vec2* out, const b2Transform& xf, const b2Vec2* points, int32 count);
+
+/// Compute the AABB of a point set under each of count transforms,
+/// grown by radius. This is b2PolygonShape::ComputeAABB for several
+/// poses of the same polygon.
+void b2ComputeAABBs(b2AABB* aabbs, const b2Transform* xfs, int32 count,
+					const b2Vec2* points, int32 pointCount, float32 radius);
+
+/// Compute count rotations from angles in radians. Uses a polynomial
+/// accurate to about 1e-6 for angles within a few turns of zero. It
+/// does not match sinf and cosf bit for bit, so keep it to drawing and
+/// other places where results need not be reproducible with b2Rot::Set.
+void b2ComputeRotations(b2Rot* out, const float32* angles, int32 count);
+
+#endif
@@ -122,6 +122,10 @@ typedef unsigned long long uint64;
 /// Maximum number of sub-steps per contact in continuous physics simulation.
 #define b2_maxSubSteps			8
 
+/// Number of steps the impulses of a contact destroyed with its body or fixture
+/// are kept for a re-created contact to warm start from.
+#define b2_contactCacheSteps	2
+
 
 // Dynamics
 
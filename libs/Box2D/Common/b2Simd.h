@@ -0,0 +1,162 @@
+/*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_SIMD_H
+#define B2_SIMD_H
+
+#include <Box2D/Common/b2Settings.h>
+
+/// A float vector of B2_SIMD_WIDTH lanes used by the wide solver paths.
+/// AVX builds get 8 lanes, SSE2 builds 4 lanes, and everything else a
+/// plain 4 float struct so the wide code compiles and runs everywhere.
+/// Define B2_SIMD_DISABLE to force the plain fallback.
+/// Loads and stores are unaligned, so lanes can live in any struct.
+/// b2RoundW rounds to the nearest integer, for values that fit in an
+/// int32. b2SwapPairsW swaps lanes 0 and 1, 2 and 3, and so on.
+/// b2SplatPairW repeats an x, y pair across the lanes.
+#if !defined(B2_SIMD_DISABLE) && defined(__AVX__)
+#define B2_SIMD_AVX
+#define B2_SIMD_WIDTH 8
+#include <immintrin.h>
+typedef __m256 b2FloatW;
+#elif !defined(B2_SIMD_DISABLE) && (defined(__SSE2__) || defined(_M_X64) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define B2_SIMD_SSE
+#define B2_SIMD_WIDTH 4
+#include <emmintrin.h>
+typedef __m128 b2FloatW;
+#else
+#define B2_SIMD_WIDTH 4
+struct b2FloatW
+{
+	float32 x[B2_SIMD_WIDTH];
+};
+#endif
+
+#if defined(B2_SIMD_AVX)
+
+inline b2FloatW b2ZeroW() { return _mm256_setzero_ps(); }
+inline b2FloatW b2SplatW(float32 s) { return _mm256_set1_ps(s); }
+inline b2FloatW b2SplatPairW(float32 x, float32 y) { return _mm256_setr_ps(x, y, x, y, x, y, x, y); }
+inline b2FloatW b2LoadW(const float32* p) { return _mm256_loadu_ps(p); }
+inline void b2StoreW(float32* p, b2FloatW a) { _mm256_storeu_ps(p, a); }
+inline b2FloatW b2AddW(b2FloatW a, b2FloatW b) { return _mm256_add_ps(a, b); }
+inline b2FloatW b2SubW(b2FloatW a, b2FloatW b) { return _mm256_sub_ps(a, b); }
+inline b2FloatW b2MulW(b2FloatW a, b2FloatW b) { return _mm256_mul_ps(a, b); }
+inline b2FloatW b2MinW(b2FloatW a, b2FloatW b) { return _mm256_min_ps(a, b); }
+inline b2FloatW b2MaxW(b2FloatW a, b2FloatW b) { return _mm256_max_ps(a, b); }
+inline b2FloatW b2RoundW(b2FloatW a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+inline b2FloatW b2SwapPairsW(b2FloatW a) { return _mm256_permute_ps(a, 0xB1); }
+
+#elif defined(B2_SIMD_SSE)
+
+inline b2FloatW b2ZeroW() { return _mm_setzero_ps(); }
+inline b2FloatW b2SplatW(float32 s) { return _mm_set1_ps(s); }
+inline b2FloatW b2SplatPairW(float32 x, float32 y) { return _mm_setr_ps(x, y, x, y); }
+inline b2FloatW b2LoadW(const float32* p) { return _mm_loadu_ps(p); }
+inline void b2StoreW(float32* p, b2FloatW a) { _mm_storeu_ps(p, a); }
+inline b2FloatW b2AddW(b2FloatW a, b2FloatW b) { return _mm_add_ps(a, b); }
+inline b2FloatW b2SubW(b2FloatW a, b2FloatW b) { return _mm_sub_ps(a, b); }
+inline b2FloatW b2MulW(b2FloatW a, b2FloatW b) { return _mm_mul_ps(a, b); }
+inline b2FloatW b2MinW(b2FloatW a, b2FloatW b) { return _mm_min_ps(a, b); }
+inline b2FloatW b2MaxW(b2FloatW a, b2FloatW b) { return _mm_max_ps(a, b); }
+inline b2FloatW b2RoundW(b2FloatW a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+inline b2FloatW b2SwapPairsW(b2FloatW a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)); }
+
+#else
+
+inline b2FloatW b2SplatW(float32 s)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < B2_SIMD_WIDTH; ++i) r.x[i] = s;
+	return r;
+}
+
+inline b2FloatW b2SplatPairW(float32 x, float32 y)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < B2_SIMD_WIDTH; i += 2)
+	{
+		r.x[i] = x;
+		r.x[i + 1] = y;
+	}
+	return r;
+}
+
+inline b2FloatW b2ZeroW() { return b2SplatW(0.0f); }
+
+inline b2FloatW b2LoadW(const float32* p)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < B2_SIMD_WIDTH; ++i) r.x[i] = p[i];
+	return r;
+}
+
+inline void b2StoreW(float32* p, b2FloatW a)
+{
+	for (int32 i = 0; i < B2_SIMD_WIDTH; ++i) p[i] = a.x[i];
+}
+
+inline b2FloatW b2AddW(b2FloatW a, b2FloatW b)
+{
+	for (int32 i = 0; i < B2_SIMD_WIDTH; ++i) a.x[i] += b.x[i];
+	return a;
+}
+
+inline b2FloatW b2SubW(b2FloatW a, b2FloatW b)
+{
+	for (int32 i = 0; i < B2_SIMD_WIDTH; ++i) a.x[i] -= b.x[i];
+	return a;
+}
+
+inline b2FloatW b2MulW(b2FloatW a, b2FloatW b)
+{
+	for (int32 i = 0; i < B2_SIMD_WIDTH; ++i) a.x[i] *= b.x[i];
+	return a;
+}
+
+inline b2FloatW b2MinW(b2FloatW a, b2FloatW b)
+{
+	for (int32 i = 0; i < B2_SIMD_WIDTH; ++i) a.x[i] = a.x[i] < b.x[i] ? a.x[i] : b.x[i];
+	return a;
+}
+
+inline b2FloatW b2MaxW(b2FloatW a, b2FloatW b)
+{
+	for (int32 i = 0; i < B2_SIMD_WIDTH; ++i) a.x[i] = a.x[i] > b.x[i] ? a.x[i] : b.x[i];
+	return a;
+}
+
+inline b2FloatW b2RoundW(b2FloatW a)
+{
+	for (int32 i = 0; i < B2_SIMD_WIDTH; ++i) a.x[i] = (float32)(int32)(a.x[i] + (a.x[i] < 0.0f ? -0.5f : 0.5f));
+	return a;
+}
+
+inline b2FloatW b2SwapPairsW(b2FloatW a)
+{
+	for (int32 i = 0; i < B2_SIMD_WIDTH; i += 2)
+	{
+		float32 t = a.x[i];
+		a.x[i] = a.x[i + 1];
+		a.x[i + 1] = t;
+	}
+	return a;
+}
+
+#endif
+
+#endif
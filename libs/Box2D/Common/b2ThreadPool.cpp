@@ -0,0 +1,124 @@
+/*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Common/b2ThreadPool.h>
+
+b2ThreadBarrier::b2ThreadBarrier(int32 threadCount)
+	: m_threadCount(threadCount), m_arrived(0), m_generation(0)
+{
+}
+
+void b2ThreadBarrier::Wait()
+{
+	int32 generation = m_generation.load(std::memory_order_acquire);
+	if (m_arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == m_threadCount)
+	{
+		m_arrived.store(0, std::memory_order_relaxed);
+		m_generation.fetch_add(1, std::memory_order_release);
+		return;
+	}
+
+	int32 spins = 0;
+	while (m_generation.load(std::memory_order_acquire) == generation)
+	{
+		if (++spins > 1000)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+b2ThreadPool::b2ThreadPool(int32 threadCount)
+{
+	b2Assert(threadCount >= 1);
+	m_threadCount = threadCount;
+	m_task = NULL;
+	m_generation = 0;
+	m_pending = 0;
+	m_exit = false;
+
+	m_workers.reserve(threadCount - 1);
+	for (int32 i = 1; i < threadCount; ++i)
+	{
+		m_workers.push_back(std::thread(&b2ThreadPool::WorkerMain, this, i));
+	}
+}
+
+b2ThreadPool::~b2ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_exit = true;
+	}
+	m_start.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); ++i)
+	{
+		m_workers[i].join();
+	}
+}
+
+void b2ThreadPool::Run(b2ThreadTask* task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task = task;
+		m_pending = m_threadCount - 1;
+		++m_generation;
+	}
+	m_start.notify_all();
+
+	task->Execute(0, m_threadCount);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_pending > 0)
+	{
+		m_done.wait(lock);
+	}
+	m_task = NULL;
+}
+
+void b2ThreadPool::WorkerMain(int32 threadIndex)
+{
+	int32 generation = 0;
+	for (;;)
+	{
+		b2ThreadTask* task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (m_exit == false && m_generation == generation)
+			{
+				m_start.wait(lock);
+			}
+
+			if (m_exit)
+			{
+				return;
+			}
+
+			generation = m_generation;
+			task = m_task;
+		}
+
+		task->Execute(threadIndex, m_threadCount);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (--m_pending == 0)
+		{
+			m_done.notify_one();
+		}
+	}
+}
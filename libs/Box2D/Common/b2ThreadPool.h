@@ -0,0 +1,83 @@
+/*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_THREAD_POOL_H
+#define B2_THREAD_POOL_H
+
+#include <Box2D/Common/b2Settings.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Work run on every thread of a b2ThreadPool.
+class b2ThreadTask
+{
+public:
+	virtual ~b2ThreadTask() {}
+
+	/// Called once per thread. threadIndex is in [0, threadCount).
+	virtual void Execute(int32 threadIndex, int32 threadCount) = 0;
+};
+
+/// A spinning barrier for the threads of one b2ThreadTask. Threads that
+/// wait for long yield so an oversubscribed machine still makes progress.
+class b2ThreadBarrier
+{
+public:
+	explicit b2ThreadBarrier(int32 threadCount);
+
+	/// Block until all threadCount threads have called Wait.
+	void Wait();
+
+private:
+	int32 m_threadCount;
+	std::atomic<int32> m_arrived;
+	std::atomic<int32> m_generation;
+};
+
+/// A fixed set of worker threads that run a task on all threads at once,
+/// so that the task may synchronize with b2ThreadBarrier. The calling
+/// thread takes part as thread 0.
+class b2ThreadPool
+{
+public:
+	/// threadCount includes the calling thread.
+	explicit b2ThreadPool(int32 threadCount);
+	~b2ThreadPool();
+
+	int32 GetThreadCount() const { return m_threadCount; }
+
+	/// Run task on every thread and return when all of them are done.
+	void Run(b2ThreadTask* task);
+
+private:
+	void WorkerMain(int32 threadIndex);
+
+	int32 m_threadCount;
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_start;
+	std::condition_variable m_done;
+	b2ThreadTask* m_task;
+	int32 m_generation;
+	int32 m_pending;
+	bool m_exit;
+};
+
+#endif
@@ -148,12 +148,39 @@ b2Contact::b2Contact(b2Fixture* fA, int32 indexA, b2Fixture* fB, int32 indexB)
 	m_nodeB.next = NULL;
 	m_nodeB.other = NULL;
 
+	m_persistentIsland = NULL;
+	m_islandPrev = NULL;
+	m_islandNext = NULL;
+
+	m_activeIndex = -1;
+
 	m_toiCount = 0;
 
 	m_friction = b2MixFriction(m_fixtureA->m_friction, m_fixtureB->m_friction);
 	m_restitution = b2MixRestitution(m_fixtureA->m_restitution, m_fixtureB->m_restitution);
 
 	m_tangentSpeed = 0.0f;
+	m_speculativeDistance = 0.0f;
+}
+
+// Bound how far a fixture child can move relative to the other within
+// the step, using the body's velocity and the extent of the child's AABB
+// around the center of mass.
+static float32 b2ComputeSpeculativeDistance(const b2Fixture* fixtureA, int32 indexA,
+											const b2Fixture* fixtureB, int32 indexB, float32 dt)
+{
+	const b2Body* bodyA = fixtureA->GetBody();
+	const b2Body* bodyB = fixtureB->GetBody();
+
+	const b2AABB& aabbA = fixtureA->GetAABB(indexA);
+	const b2AABB& aabbB = fixtureB->GetAABB(indexB);
+	float32 rA = (b2Abs(aabbA.GetCenter() - bodyA->GetWorldCenter()) + aabbA.GetExtents()).Length();
+	float32 rB = (b2Abs(aabbB.GetCenter() - bodyB->GetWorldCenter()) + aabbB.GetExtents()).Length();
+
+	b2Vec2 dv = bodyB->GetLinearVelocity() - bodyA->GetLinearVelocity();
+	float32 speed = dv.Length() +
+		b2Abs(bodyA->GetAngularVelocity()) * rA + b2Abs(bodyB->GetAngularVelocity()) * rB;
+	return dt * speed;
 }
 
 // Update the contact manifold and touching status.
@@ -189,6 +216,15 @@ void b2Contact::Update(b2ContactListener* listener)
 	}
 	else
 	{
+		// Speculative points count as touching so the contact is solved.
+		b2World* world = bodyA->m_world;
+		m_speculativeDistance = 0.0f;
+		if (world->m_speculativeContacts || bodyA->IsSpeculative() || bodyB->IsSpeculative())
+		{
+			m_speculativeDistance = b2ComputeSpeculativeDistance(
+				m_fixtureA, m_indexA, m_fixtureB, m_indexB, world->m_speculativeTimeStep);
+		}
+
 		Evaluate(&m_manifold, xfA, xfB);
 		touching = m_manifold.pointCount > 0;
 
@@ -230,6 +266,22 @@ void b2Contact::Update(b2ContactListener* listener)
 		m_flags &= ~e_touchingFlag;
 	}
 
+	// Touching contacts join the island of their bodies. This follows the
+	// state rather than the transition so fixtures that stop being sensors
+	// are picked up too.
+	bool linked = m_persistentIsland != NULL;
+	if (touching && sensor == false)
+	{
+		if (linked == false)
+		{
+			bodyA->m_world->m_islandManager.LinkContact(this);
+		}
+	}
+	else if (linked)
+	{
+		bodyA->m_world->m_islandManager.UnlinkContact(this);
+	}
+
 	if (wasTouching == false && touching == true && listener)
 	{
 		listener->BeginContact(this);
@@ -31,6 +31,7 @@ class b2World;
 class b2BlockAllocator;
 class b2StackAllocator;
 class b2ContactListener;
+struct b2PersistentIsland;
 
 /// Friction mixing law. The idea is to allow either fixture to drive the restitution to zero.
 /// For example, anything slides on ice.
@@ -150,6 +151,7 @@ protected:
 	friend class b2ContactSolver;
 	friend class b2Body;
 	friend class b2Fixture;
+	friend class b2IslandManager;
 
 	// Flags stored in m_flags
 	enum
@@ -202,6 +204,14 @@ protected:
 	b2ContactEdge m_nodeA;
 	b2ContactEdge m_nodeB;
 
+	// Persistent island of a touching contact.
+	b2PersistentIsland* m_persistentIsland;
+	b2Contact* m_islandPrev;
+	b2Contact* m_islandNext;
+
+	// Index in the contact manager's active set, -1 when not in it.
+	int32 m_activeIndex;
+
 	b2Fixture* m_fixtureA;
 	b2Fixture* m_fixtureB;
 
@@ -217,6 +227,10 @@ protected:
 	float32 m_restitution;
 
 	float32 m_tangentSpeed;
+
+	// How far apart points are kept as speculative points, 0 unless one
+	// of the bodies uses speculative contacts.
+	float32 m_speculativeDistance;
 };
 
 inline b2Manifold* b2Contact::GetManifold()
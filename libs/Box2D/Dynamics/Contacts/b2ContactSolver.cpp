@@ -24,6 +24,9 @@
 #include <Box2D/Dynamics/b2Fixture.h>
 #include <Box2D/Dynamics/b2World.h>
 #include <Box2D/Common/b2StackAllocator.h>
+#include <Box2D/Common/b2Simd.h>
+
+#include <string.h>
 
 #define B2_DEBUG_SOLVER 0
 
@@ -42,6 +45,33 @@ struct b2ContactPositionConstraint
 	int32 pointCount;
 };
 
+// One manifold point of B2_SIMD_WIDTH contacts, one lane per contact.
+struct b2WideContactPoint
+{
+	float32 rAx[B2_SIMD_WIDTH], rAy[B2_SIMD_WIDTH];
+	float32 rBx[B2_SIMD_WIDTH], rBy[B2_SIMD_WIDTH];
+	float32 normalMass[B2_SIMD_WIDTH];
+	float32 tangentMass[B2_SIMD_WIDTH];
+	float32 velocityBias[B2_SIMD_WIDTH];
+	float32 normalImpulse[B2_SIMD_WIDTH];
+	float32 tangentImpulse[B2_SIMD_WIDTH];
+};
+
+// A batch of velocity constraints in structure of arrays form. Unused
+// lanes and missing points are zero so they apply no impulse.
+struct b2WideContactConstraint
+{
+	b2WideContactPoint points[b2_maxManifoldPoints];
+	float32 normalX[B2_SIMD_WIDTH], normalY[B2_SIMD_WIDTH];
+	float32 invMassA[B2_SIMD_WIDTH], invIA[B2_SIMD_WIDTH];
+	float32 invMassB[B2_SIMD_WIDTH], invIB[B2_SIMD_WIDTH];
+	float32 friction[B2_SIMD_WIDTH];
+	float32 tangentSpeed[B2_SIMD_WIDTH];
+	int32 indexA[B2_SIMD_WIDTH], indexB[B2_SIMD_WIDTH];
+	// Index of the source velocity constraint, -1 for unused lanes.
+	int32 constraintIndex[B2_SIMD_WIDTH];
+};
+
 b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 {
 	m_step = def->step;
@@ -52,6 +82,9 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 	m_positions = def->positions;
 	m_velocities = def->velocities;
 	m_contacts = def->contacts;
+	m_wideConstraints = NULL;
+	m_wideCount = 0;
+	m_colorCount = 0;
 
 	// Initialize position independent portions of the constraints.
 	for (int32 i = 0; i < m_count; ++i)
@@ -91,8 +124,8 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 		pc->indexB = bodyB->m_islandIndex;
 		pc->invMassA = bodyA->m_invMass;
 		pc->invMassB = bodyB->m_invMass;
-		pc->localCenterA = bodyA->m_sweep.localCenter;
-		pc->localCenterB = bodyB->m_sweep.localCenter;
+		pc->localCenterA = bodyA->m_state->sweep.localCenter;
+		pc->localCenterB = bodyB->m_state->sweep.localCenter;
 		pc->invIA = bodyA->m_invI;
 		pc->invIB = bodyB->m_invI;
 		pc->localNormal = manifold->localNormal;
@@ -131,6 +164,10 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 
 b2ContactSolver::~b2ContactSolver()
 {
+	if (m_wideConstraints)
+	{
+		m_allocator->Free(m_wideConstraints);
+	}
 	m_allocator->Free(m_velocityConstraints);
 	m_allocator->Free(m_positionConstraints);
 }
@@ -146,6 +183,7 @@ void b2ContactSolver::InitializeVelocityConstraints()
 		float32 radiusA = pc->radiusA;
 		float32 radiusB = pc->radiusB;
 		b2Manifold* manifold = m_contacts[vc->contactIndex]->GetManifold();
+		bool speculative = m_contacts[vc->contactIndex]->m_speculativeDistance > 0.0f;
 
 		int32 indexA = vc->indexA;
 		int32 indexB = vc->indexB;
@@ -207,7 +245,17 @@ void b2ContactSolver::InitializeVelocityConstraints()
 			// Setup a velocity bias for restitution.
 			vcp->velocityBias = 0.0f;
 			float32 vRel = b2Dot(vc->normal, vB + b2Cross(wB, vcp->rB) - vA - b2Cross(wA, vcp->rA));
-			if (vRel < -b2_velocityThreshold)
+			float32 separation = worldManifold.separations[j];
+			if (speculative && separation > 0.0f)
+			{
+				// A speculative point only keeps the bodies from closing
+				// more than the gap within the step. It has no impulse to
+				// warm start from.
+				vcp->velocityBias = -separation * m_step.inv_dt;
+				vcp->normalImpulse = 0.0f;
+				vcp->tangentImpulse = 0.0f;
+			}
+			else if (vRel < -b2_velocityThreshold)
 			{
 				vcp->velocityBias = -vc->restitution * vRel;
 			}
@@ -245,6 +293,153 @@ void b2ContactSolver::InitializeVelocityConstraints()
 			}
 		}
 	}
+
+	if (m_step.wideContactSolver)
+	{
+		InitializeWideConstraints();
+	}
+}
+
+// Greedy coloring in constraint order, so the batches are deterministic.
+// Static and kinematic bodies are never written by the solver, so they
+// do not take part in the coloring.
+void b2ContactSolver::InitializeWideConstraints()
+{
+	b2Assert(m_wideConstraints == NULL);
+	if (m_count == 0)
+	{
+		return;
+	}
+
+	int32 bodyCount = 0;
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		const b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		bodyCount = b2Max(bodyCount, b2Max(vc->indexA, vc->indexB) + 1);
+	}
+
+	uint64* bodyColors = (uint64*)b2Alloc(bodyCount * sizeof(uint64));
+	memset(bodyColors, 0, bodyCount * sizeof(uint64));
+	int32* colors = (int32*)b2Alloc(m_count * sizeof(int32));
+	int32 colorCounts[e_maxColors + 1];
+	memset(colorCounts, 0, sizeof(colorCounts));
+
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		const b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		bool dynamicA = vc->invMassA > 0.0f || vc->invIA > 0.0f;
+		bool dynamicB = vc->invMassB > 0.0f || vc->invIB > 0.0f;
+		uint64 used = 0;
+		if (dynamicA)
+		{
+			used |= bodyColors[vc->indexA];
+		}
+		if (dynamicB)
+		{
+			used |= bodyColors[vc->indexB];
+		}
+
+		int32 color = 0;
+		while (color < e_maxColors && (used & ((uint64)1 << color)))
+		{
+			++color;
+		}
+
+		if (color < e_maxColors)
+		{
+			uint64 bit = (uint64)1 << color;
+			if (dynamicA)
+			{
+				bodyColors[vc->indexA] |= bit;
+			}
+			if (dynamicB)
+			{
+				bodyColors[vc->indexB] |= bit;
+			}
+		}
+
+		colors[i] = color;
+		++colorCounts[color];
+	}
+
+	// The overflow color gets one contact per batch.
+	m_colorStarts[0] = 0;
+	m_colorCount = 0;
+	for (int32 c = 0; c <= e_maxColors; ++c)
+	{
+		int32 batches = c < e_maxColors ?
+			(colorCounts[c] + B2_SIMD_WIDTH - 1) / B2_SIMD_WIDTH : colorCounts[c];
+		m_colorStarts[c + 1] = m_colorStarts[c] + batches;
+		if (batches > 0)
+		{
+			m_colorCount = c + 1;
+		}
+	}
+	m_wideCount = m_colorStarts[e_maxColors + 1];
+
+	m_wideConstraints = (b2WideContactConstraint*)m_allocator->Allocate(
+		m_wideCount * sizeof(b2WideContactConstraint));
+	memset(m_wideConstraints, 0, m_wideCount * sizeof(b2WideContactConstraint));
+	for (int32 i = 0; i < m_wideCount; ++i)
+	{
+		b2WideContactConstraint* wc = m_wideConstraints + i;
+		for (int32 lane = 0; lane < B2_SIMD_WIDTH; ++lane)
+		{
+			wc->indexA[lane] = -1;
+			wc->indexB[lane] = -1;
+			wc->constraintIndex[lane] = -1;
+		}
+	}
+
+	memset(colorCounts, 0, sizeof(colorCounts));
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		const b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		int32 color = colors[i];
+		int32 slot = colorCounts[color]++;
+		int32 batch, lane;
+		if (color < e_maxColors)
+		{
+			batch = m_colorStarts[color] + slot / B2_SIMD_WIDTH;
+			lane = slot % B2_SIMD_WIDTH;
+		}
+		else
+		{
+			batch = m_colorStarts[color] + slot;
+			lane = 0;
+		}
+
+		b2WideContactConstraint* wc = m_wideConstraints + batch;
+		wc->normalX[lane] = vc->normal.x;
+		wc->normalY[lane] = vc->normal.y;
+		wc->invMassA[lane] = vc->invMassA;
+		wc->invIA[lane] = vc->invIA;
+		wc->invMassB[lane] = vc->invMassB;
+		wc->invIB[lane] = vc->invIB;
+		wc->friction[lane] = vc->friction;
+		wc->tangentSpeed[lane] = vc->tangentSpeed;
+		wc->indexA[lane] = vc->indexA;
+		wc->indexB[lane] = vc->indexB;
+		wc->constraintIndex[lane] = i;
+
+		for (int32 j = 0; j < vc->pointCount; ++j)
+		{
+			const b2VelocityConstraintPoint* vcp = vc->points + j;
+			b2WideContactPoint* wcp = wc->points + j;
+			wcp->rAx[lane] = vcp->rA.x;
+			wcp->rAy[lane] = vcp->rA.y;
+			wcp->rBx[lane] = vcp->rB.x;
+			wcp->rBy[lane] = vcp->rB.y;
+			wcp->normalMass[lane] = vcp->normalMass;
+			wcp->tangentMass[lane] = vcp->tangentMass;
+			wcp->velocityBias[lane] = vcp->velocityBias;
+			wcp->normalImpulse[lane] = vcp->normalImpulse;
+			wcp->tangentImpulse[lane] = vcp->tangentImpulse;
+		}
+	}
+
+	b2Free(colors);
+	b2Free(bodyColors);
 }
 
 void b2ContactSolver::WarmStart()
@@ -289,6 +484,12 @@ void b2ContactSolver::WarmStart()
 
 void b2ContactSolver::SolveVelocityConstraints()
 {
+	if (m_wideConstraints)
+	{
+		SolveWideVelocityConstraints(0, m_wideCount);
+		return;
+	}
+
 	for (int32 i = 0; i < m_count; ++i)
 	{
 		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
@@ -595,8 +796,174 @@ void b2ContactSolver::SolveVelocityConstraints()
 	}
 }
 
+// Same sequential impulse scheme as SolveVelocityConstraints, one lane per
+// contact. Each normal point is solved on its own, the block solver does
+// not map well onto lanes.
+void b2ContactSolver::SolveWideVelocityConstraints(int32 begin, int32 end)
+{
+	b2Assert(0 <= begin && begin <= end && end <= m_wideCount);
+	const b2FloatW zero = b2ZeroW();
+
+	for (int32 i = begin; i < end; ++i)
+	{
+		b2WideContactConstraint* wc = m_wideConstraints + i;
+
+		// Gather body velocities.
+		float32 vAx[B2_SIMD_WIDTH], vAy[B2_SIMD_WIDTH], wA[B2_SIMD_WIDTH];
+		float32 vBx[B2_SIMD_WIDTH], vBy[B2_SIMD_WIDTH], wB[B2_SIMD_WIDTH];
+		for (int32 lane = 0; lane < B2_SIMD_WIDTH; ++lane)
+		{
+			int32 indexA = wc->indexA[lane];
+			int32 indexB = wc->indexB[lane];
+			if (indexA >= 0)
+			{
+				vAx[lane] = m_velocities[indexA].v.x;
+				vAy[lane] = m_velocities[indexA].v.y;
+				wA[lane] = m_velocities[indexA].w;
+				vBx[lane] = m_velocities[indexB].v.x;
+				vBy[lane] = m_velocities[indexB].v.y;
+				wB[lane] = m_velocities[indexB].w;
+			}
+			else
+			{
+				vAx[lane] = vAy[lane] = wA[lane] = 0.0f;
+				vBx[lane] = vBy[lane] = wB[lane] = 0.0f;
+			}
+		}
+
+		b2FloatW vAX = b2LoadW(vAx), vAY = b2LoadW(vAy), wAW = b2LoadW(wA);
+		b2FloatW vBX = b2LoadW(vBx), vBY = b2LoadW(vBy), wBW = b2LoadW(wB);
+
+		b2FloatW mA = b2LoadW(wc->invMassA);
+		b2FloatW iA = b2LoadW(wc->invIA);
+		b2FloatW mB = b2LoadW(wc->invMassB);
+		b2FloatW iB = b2LoadW(wc->invIB);
+		b2FloatW normalX = b2LoadW(wc->normalX);
+		b2FloatW normalY = b2LoadW(wc->normalY);
+		// tangent = b2Cross(normal, 1.0f)
+		b2FloatW tangentX = normalY;
+		b2FloatW tangentY = b2SubW(zero, normalX);
+		b2FloatW friction = b2LoadW(wc->friction);
+		b2FloatW tangentSpeed = b2LoadW(wc->tangentSpeed);
+
+		// Solve tangent constraints first because non-penetration is more
+		// important than friction.
+		for (int32 j = 0; j < b2_maxManifoldPoints; ++j)
+		{
+			b2WideContactPoint* wcp = wc->points + j;
+			b2FloatW rAx = b2LoadW(wcp->rAx), rAy = b2LoadW(wcp->rAy);
+			b2FloatW rBx = b2LoadW(wcp->rBx), rBy = b2LoadW(wcp->rBy);
+
+			// dv = vB + b2Cross(wB, rB) - vA - b2Cross(wA, rA)
+			b2FloatW dvx = b2SubW(b2SubW(vBX, b2MulW(wBW, rBy)), b2SubW(vAX, b2MulW(wAW, rAy)));
+			b2FloatW dvy = b2SubW(b2AddW(vBY, b2MulW(wBW, rBx)), b2AddW(vAY, b2MulW(wAW, rAx)));
+
+			b2FloatW vt = b2SubW(b2AddW(b2MulW(dvx, tangentX), b2MulW(dvy, tangentY)), tangentSpeed);
+			b2FloatW lambda = b2SubW(zero, b2MulW(b2LoadW(wcp->tangentMass), vt));
+
+			b2FloatW maxFriction = b2MulW(friction, b2LoadW(wcp->normalImpulse));
+			b2FloatW oldImpulse = b2LoadW(wcp->tangentImpulse);
+			b2FloatW newImpulse = b2MaxW(b2SubW(zero, maxFriction),
+										 b2MinW(b2AddW(oldImpulse, lambda), maxFriction));
+			lambda = b2SubW(newImpulse, oldImpulse);
+			b2StoreW(wcp->tangentImpulse, newImpulse);
+
+			b2FloatW Px = b2MulW(lambda, tangentX);
+			b2FloatW Py = b2MulW(lambda, tangentY);
+
+			vAX = b2SubW(vAX, b2MulW(mA, Px));
+			vAY = b2SubW(vAY, b2MulW(mA, Py));
+			wAW = b2SubW(wAW, b2MulW(iA, b2SubW(b2MulW(rAx, Py), b2MulW(rAy, Px))));
+			vBX = b2AddW(vBX, b2MulW(mB, Px));
+			vBY = b2AddW(vBY, b2MulW(mB, Py));
+			wBW = b2AddW(wBW, b2MulW(iB, b2SubW(b2MulW(rBx, Py), b2MulW(rBy, Px))));
+		}
+
+		// Solve normal constraints.
+		for (int32 j = 0; j < b2_maxManifoldPoints; ++j)
+		{
+			b2WideContactPoint* wcp = wc->points + j;
+			b2FloatW rAx = b2LoadW(wcp->rAx), rAy = b2LoadW(wcp->rAy);
+			b2FloatW rBx = b2LoadW(wcp->rBx), rBy = b2LoadW(wcp->rBy);
+
+			b2FloatW dvx = b2SubW(b2SubW(vBX, b2MulW(wBW, rBy)), b2SubW(vAX, b2MulW(wAW, rAy)));
+			b2FloatW dvy = b2SubW(b2AddW(vBY, b2MulW(wBW, rBx)), b2AddW(vAY, b2MulW(wAW, rAx)));
+
+			b2FloatW vn = b2AddW(b2MulW(dvx, normalX), b2MulW(dvy, normalY));
+			b2FloatW lambda = b2MulW(b2LoadW(wcp->normalMass),
+									 b2SubW(b2LoadW(wcp->velocityBias), vn));
+
+			b2FloatW oldImpulse = b2LoadW(wcp->normalImpulse);
+			b2FloatW newImpulse = b2MaxW(b2AddW(oldImpulse, lambda), zero);
+			lambda = b2SubW(newImpulse, oldImpulse);
+			b2StoreW(wcp->normalImpulse, newImpulse);
+
+			b2FloatW Px = b2MulW(lambda, normalX);
+			b2FloatW Py = b2MulW(lambda, normalY);
+
+			vAX = b2SubW(vAX, b2MulW(mA, Px));
+			vAY = b2SubW(vAY, b2MulW(mA, Py));
+			wAW = b2SubW(wAW, b2MulW(iA, b2SubW(b2MulW(rAx, Py), b2MulW(rAy, Px))));
+			vBX = b2AddW(vBX, b2MulW(mB, Px));
+			vBY = b2AddW(vBY, b2MulW(mB, Py));
+			wBW = b2AddW(wBW, b2MulW(iB, b2SubW(b2MulW(rBx, Py), b2MulW(rBy, Px))));
+		}
+
+		// Scatter. Bodies without mass are left alone, they may appear in
+		// several lanes of the batch.
+		b2StoreW(vAx, vAX);
+		b2StoreW(vAy, vAY);
+		b2StoreW(wA, wAW);
+		b2StoreW(vBx, vBX);
+		b2StoreW(vBy, vBY);
+		b2StoreW(wB, wBW);
+		for (int32 lane = 0; lane < B2_SIMD_WIDTH; ++lane)
+		{
+			if (wc->constraintIndex[lane] < 0)
+			{
+				continue;
+			}
+
+			if (wc->invMassA[lane] > 0.0f || wc->invIA[lane] > 0.0f)
+			{
+				b2Velocity* v = m_velocities + wc->indexA[lane];
+				v->v.Set(vAx[lane], vAy[lane]);
+				v->w = wA[lane];
+			}
+
+			if (wc->invMassB[lane] > 0.0f || wc->invIB[lane] > 0.0f)
+			{
+				b2Velocity* v = m_velocities + wc->indexB[lane];
+				v->v.Set(vBx[lane], vBy[lane]);
+				v->w = wB[lane];
+			}
+		}
+	}
+}
+
 void b2ContactSolver::StoreImpulses()
 {
+	// Copy the wide impulses back so the listener sees them too.
+	for (int32 i = 0; i < m_wideCount; ++i)
+	{
+		const b2WideContactConstraint* wc = m_wideConstraints + i;
+		for (int32 lane = 0; lane < B2_SIMD_WIDTH; ++lane)
+		{
+			int32 index = wc->constraintIndex[lane];
+			if (index < 0)
+			{
+				continue;
+			}
+
+			b2ContactVelocityConstraint* vc = m_velocityConstraints + index;
+			for (int32 j = 0; j < vc->pointCount; ++j)
+			{
+				vc->points[j].normalImpulse = wc->points[j].normalImpulse[lane];
+				vc->points[j].tangentImpulse = wc->points[j].tangentImpulse[lane];
+			}
+		}
+	}
+
 	for (int32 i = 0; i < m_count; ++i)
 	{
 		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
@@ -671,77 +1038,96 @@ struct b2PositionSolverManifold
 };
 
 // Sequential solver.
-bool b2ContactSolver::SolvePositionConstraints()
+// Solve one position constraint and return its minimum separation.
+// Bodies without mass are not written back, so constraints sharing only
+// static bodies can be solved concurrently.
+static float32 b2SolvePositionConstraint(b2ContactPositionConstraint* pc,
+										 b2Position* positions)
 {
 	float32 minSeparation = 0.0f;
 
-	for (int32 i = 0; i < m_count; ++i)
-	{
-		b2ContactPositionConstraint* pc = m_positionConstraints + i;
+	int32 indexA = pc->indexA;
+	int32 indexB = pc->indexB;
+	b2Vec2 localCenterA = pc->localCenterA;
+	float32 mA = pc->invMassA;
+	float32 iA = pc->invIA;
+	b2Vec2 localCenterB = pc->localCenterB;
+	float32 mB = pc->invMassB;
+	float32 iB = pc->invIB;
+	int32 pointCount = pc->pointCount;
 
-		int32 indexA = pc->indexA;
-		int32 indexB = pc->indexB;
-		b2Vec2 localCenterA = pc->localCenterA;
-		float32 mA = pc->invMassA;
-		float32 iA = pc->invIA;
-		b2Vec2 localCenterB = pc->localCenterB;
-		float32 mB = pc->invMassB;
-		float32 iB = pc->invIB;
-		int32 pointCount = pc->pointCount;
+	b2Vec2 cA = positions[indexA].c;
+	float32 aA = positions[indexA].a;
 
-		b2Vec2 cA = m_positions[indexA].c;
-		float32 aA = m_positions[indexA].a;
+	b2Vec2 cB = positions[indexB].c;
+	float32 aB = positions[indexB].a;
 
-		b2Vec2 cB = m_positions[indexB].c;
-		float32 aB = m_positions[indexB].a;
+	// Solve normal constraints
+	for (int32 j = 0; j < pointCount; ++j)
+	{
+		b2Transform xfA, xfB;
+		xfA.q.Set(aA);
+		xfB.q.Set(aB);
+		xfA.p = cA - b2Mul(xfA.q, localCenterA);
+		xfB.p = cB - b2Mul(xfB.q, localCenterB);
 
-		// Solve normal constraints
-		for (int32 j = 0; j < pointCount; ++j)
-		{
-			b2Transform xfA, xfB;
-			xfA.q.Set(aA);
-			xfB.q.Set(aB);
-			xfA.p = cA - b2Mul(xfA.q, localCenterA);
-			xfB.p = cB - b2Mul(xfB.q, localCenterB);
+		b2PositionSolverManifold psm;
+		psm.Initialize(pc, xfA, xfB, j);
+		b2Vec2 normal = psm.normal;
 
-			b2PositionSolverManifold psm;
-			psm.Initialize(pc, xfA, xfB, j);
-			b2Vec2 normal = psm.normal;
+		b2Vec2 point = psm.point;
+		float32 separation = psm.separation;
 
-			b2Vec2 point = psm.point;
-			float32 separation = psm.separation;
+		b2Vec2 rA = point - cA;
+		b2Vec2 rB = point - cB;
 
-			b2Vec2 rA = point - cA;
-			b2Vec2 rB = point - cB;
+		// Track max constraint error.
+		minSeparation = b2Min(minSeparation, separation);
 
-			// Track max constraint error.
-			minSeparation = b2Min(minSeparation, separation);
+		// Prevent large corrections and allow slop.
+		float32 C = b2Clamp(b2_baumgarte * (separation + b2_linearSlop), -b2_maxLinearCorrection, 0.0f);
 
-			// Prevent large corrections and allow slop.
-			float32 C = b2Clamp(b2_baumgarte * (separation + b2_linearSlop), -b2_maxLinearCorrection, 0.0f);
+		// Compute the effective mass.
+		float32 rnA = b2Cross(rA, normal);
+		float32 rnB = b2Cross(rB, normal);
+		float32 K = mA + mB + iA * rnA * rnA + iB * rnB * rnB;
 
-			// Compute the effective mass.
-			float32 rnA = b2Cross(rA, normal);
-			float32 rnB = b2Cross(rB, normal);
-			float32 K = mA + mB + iA * rnA * rnA + iB * rnB * rnB;
+		// Compute normal impulse
+		float32 impulse = K > 0.0f ? - C / K : 0.0f;
 
-			// Compute normal impulse
-			float32 impulse = K > 0.0f ? - C / K : 0.0f;
+		b2Vec2 P = impulse * normal;
 
-			b2Vec2 P = impulse * normal;
+		cA -= mA * P;
+		aA -= iA * b2Cross(rA, P);
 
-			cA -= mA * P;
-			aA -= iA * b2Cross(rA, P);
+		cB += mB * P;
+		aB += iB * b2Cross(rB, P);
+	}
 
-			cB += mB * P;
-			aB += iB * b2Cross(rB, P);
-		}
+	if (mA > 0.0f || iA > 0.0f)
+	{
+		positions[indexA].c = cA;
+		positions[indexA].a = aA;
+	}
 
-		m_positions[indexA].c = cA;
-		m_positions[indexA].a = aA;
+	if (mB > 0.0f || iB > 0.0f)
+	{
+		positions[indexB].c = cB;
+		positions[indexB].a = aB;
+	}
 
-		m_positions[indexB].c = cB;
-		m_positions[indexB].a = aB;
+	return minSeparation;
+}
+
+// Sequential solver.
+bool b2ContactSolver::SolvePositionConstraints()
+{
+	float32 minSeparation = 0.0f;
+
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		minSeparation = b2Min(minSeparation,
+			b2SolvePositionConstraint(m_positionConstraints + i, m_positions));
 	}
 
 	// We can't expect minSpeparation >= -b2_linearSlop because we don't
@@ -749,6 +1135,30 @@ bool b2ContactSolver::SolvePositionConstraints()
 	return minSeparation >= -3.0f * b2_linearSlop;
 }
 
+bool b2ContactSolver::SolveWidePositionConstraints(int32 begin, int32 end)
+{
+	b2Assert(0 <= begin && begin <= end && end <= m_wideCount);
+	float32 minSeparation = 0.0f;
+
+	for (int32 i = begin; i < end; ++i)
+	{
+		const b2WideContactConstraint* wc = m_wideConstraints + i;
+		for (int32 lane = 0; lane < B2_SIMD_WIDTH; ++lane)
+		{
+			int32 index = wc->constraintIndex[lane];
+			if (index < 0)
+			{
+				continue;
+			}
+
+			minSeparation = b2Min(minSeparation,
+				b2SolvePositionConstraint(m_positionConstraints + index, m_positions));
+		}
+	}
+
+	return minSeparation >= -3.0f * b2_linearSlop;
+}
+
 // Sequential position solver for position constraints.
 bool b2ContactSolver::SolveTOIPositionConstraints(int32 toiIndexA, int32 toiIndexB)
 {
@@ -27,6 +27,7 @@ class b2Contact;
 class b2Body;
 class b2StackAllocator;
 struct b2ContactPositionConstraint;
+struct b2WideContactConstraint;
 
 struct b2VelocityConstraintPoint
 {
@@ -69,6 +70,10 @@ struct b2ContactSolverDef
 class b2ContactSolver
 {
 public:
+	/// Colors available to the wide solver. Contacts that do not fit go to
+	/// an extra color where every batch holds a single contact.
+	enum { e_maxColors = 64 };
+
 	b2ContactSolver(b2ContactSolverDef* def);
 	~b2ContactSolver();
 
@@ -78,6 +83,17 @@ public:
 	void SolveVelocityConstraints();
 	void StoreImpulses();
 
+	/// Solve the wide batches [begin, end). Batches of one color share no
+	/// dynamic body, so any subset of a color may be solved concurrently.
+	/// The overflow color e_maxColors is the exception and must be solved
+	/// by a single thread.
+	void SolveWideVelocityConstraints(int32 begin, int32 end);
+
+	/// Position solve over the contacts of the wide batches [begin, end),
+	/// same concurrency rules as above. Returns false while the error is
+	/// still large.
+	bool SolveWidePositionConstraints(int32 begin, int32 end);
+
 	bool SolvePositionConstraints();
 	bool SolveTOIPositionConstraints(int32 toiIndexA, int32 toiIndexB);
 
@@ -89,6 +105,16 @@ public:
 	b2ContactVelocityConstraint* m_velocityConstraints;
 	b2Contact** m_contacts;
 	int m_count;
+
+	// Wide solver batches, grouped by color. Color c owns the batches
+	// [m_colorStarts[c], m_colorStarts[c + 1]).
+	b2WideContactConstraint* m_wideConstraints;
+	int32 m_wideCount;
+	int32 m_colorCount;
+	int32 m_colorStarts[e_maxColors + 2];
+
+private:
+	void InitializeWideConstraints();
 };
 
 #endif
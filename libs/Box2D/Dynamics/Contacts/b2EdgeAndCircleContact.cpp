@@ -45,5 +45,5 @@ void b2EdgeAndCircleContact::Evaluate(b2Manifold* manifold, const b2Transform& x
 {
 	b2CollideEdgeAndCircle(	manifold,
 								(b2EdgeShape*)m_fixtureA->GetShape(), xfA,
-								(b2CircleShape*)m_fixtureB->GetShape(), xfB);
+								(b2CircleShape*)m_fixtureB->GetShape(), xfB, m_speculativeDistance);
 }
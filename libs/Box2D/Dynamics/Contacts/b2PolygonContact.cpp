@@ -42,11 +42,13 @@ b2PolygonContact::b2PolygonContact(b2Fixture* fixtureA, b2Fixture* fixtureB)
 {
 	b2Assert(m_fixtureA->GetType() == b2Shape::e_polygon);
 	b2Assert(m_fixtureB->GetType() == b2Shape::e_polygon);
+	m_satCache.type = b2SATCache::e_none;
+	m_satCache.index = 0;
 }
 
 void b2PolygonContact::Evaluate(b2Manifold* manifold, const b2Transform& xfA, const b2Transform& xfB)
 {
 	b2CollidePolygons(	manifold,
 						(b2PolygonShape*)m_fixtureA->GetShape(), xfA,
-						(b2PolygonShape*)m_fixtureB->GetShape(), xfB);
+						(b2PolygonShape*)m_fixtureB->GetShape(), xfB, m_speculativeDistance, &m_satCache);
 }
@@ -189,6 +189,9 @@ b2Joint::b2Joint(const b2JointDef* def)
 	m_next = NULL;
 	m_bodyA = def->bodyA;
 	m_bodyB = def->bodyB;
+	m_persistentIsland = NULL;
+	m_islandPrev = NULL;
+	m_islandNext = NULL;
 	m_index = 0;
 	m_collideConnected = def->collideConnected;
 	m_islandFlag = false;
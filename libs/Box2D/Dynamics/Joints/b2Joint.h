@@ -24,6 +24,7 @@
 class b2Body;
 class b2Joint;
 struct b2SolverData;
+struct b2PersistentIsland;
 class b2BlockAllocator;
 
 enum b2JointType
@@ -153,6 +154,7 @@ protected:
 	friend class b2World;
 	friend class b2Body;
 	friend class b2Island;
+	friend class b2IslandManager;
 	friend class b2GearJoint;
 
 	static b2Joint* Create(const b2JointDef* def, b2BlockAllocator* allocator);
@@ -175,6 +177,11 @@ protected:
 	b2Body* m_bodyA;
 	b2Body* m_bodyB;
 
+	// Persistent island of the joint bodies.
+	b2PersistentIsland* m_persistentIsland;
+	b2Joint* m_islandPrev;
+	b2Joint* m_islandNext;
+
 	int32 m_index;
 
 	bool m_islandFlag;
@@ -127,8 +127,8 @@ void b2PrismaticJoint::InitVelocityConstraints(const b2SolverData& data)
 {
 	m_indexA = m_bodyA->m_islandIndex;
 	m_indexB = m_bodyB->m_islandIndex;
-	m_localCenterA = m_bodyA->m_sweep.localCenter;
-	m_localCenterB = m_bodyB->m_sweep.localCenter;
+	m_localCenterA = m_bodyA->m_state->sweep.localCenter;
+	m_localCenterB = m_bodyB->m_state->sweep.localCenter;
 	m_invMassA = m_bodyA->m_invMass;
 	m_invMassB = m_bodyB->m_invMass;
 	m_invIA = m_bodyA->m_invI;
@@ -517,17 +517,17 @@ float32 b2PrismaticJoint::GetJointSpeed() const
 	b2Body* bA = m_bodyA;
 	b2Body* bB = m_bodyB;
 
-	b2Vec2 rA = b2Mul(bA->m_xf.q, m_localAnchorA - bA->m_sweep.localCenter);
-	b2Vec2 rB = b2Mul(bB->m_xf.q, m_localAnchorB - bB->m_sweep.localCenter);
-	b2Vec2 p1 = bA->m_sweep.c + rA;
-	b2Vec2 p2 = bB->m_sweep.c + rB;
+	b2Vec2 rA = b2Mul(bA->m_state->xf.q, m_localAnchorA - bA->m_state->sweep.localCenter);
+	b2Vec2 rB = b2Mul(bB->m_state->xf.q, m_localAnchorB - bB->m_state->sweep.localCenter);
+	b2Vec2 p1 = bA->m_state->sweep.c + rA;
+	b2Vec2 p2 = bB->m_state->sweep.c + rB;
 	b2Vec2 d = p2 - p1;
-	b2Vec2 axis = b2Mul(bA->m_xf.q, m_localXAxisA);
+	b2Vec2 axis = b2Mul(bA->m_state->xf.q, m_localXAxisA);
 
-	b2Vec2 vA = bA->m_linearVelocity;
-	b2Vec2 vB = bB->m_linearVelocity;
-	float32 wA = bA->m_angularVelocity;
-	float32 wB = bB->m_angularVelocity;
+	b2Vec2 vA = bA->m_state->linearVelocity;
+	b2Vec2 vB = bB->m_state->linearVelocity;
+	float32 wA = bA->m_state->angularVelocity;
+	float32 wB = bB->m_state->angularVelocity;
 
 	float32 speed = b2Dot(d, b2Cross(wA, axis)) + b2Dot(axis, vB + b2Cross(wB, rB) - vA - b2Cross(wA, rA));
 	return speed;
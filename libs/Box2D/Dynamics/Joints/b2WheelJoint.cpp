@@ -78,8 +78,8 @@ void b2WheelJoint::InitVelocityConstraints(const b2SolverData& data)
 {
 	m_indexA = m_bodyA->m_islandIndex;
 	m_indexB = m_bodyB->m_islandIndex;
-	m_localCenterA = m_bodyA->m_sweep.localCenter;
-	m_localCenterB = m_bodyB->m_sweep.localCenter;
+	m_localCenterA = m_bodyA->m_state->sweep.localCenter;
+	m_localCenterB = m_bodyB->m_state->sweep.localCenter;
 	m_invMassA = m_bodyA->m_invMass;
 	m_invMassB = m_bodyB->m_invMass;
 	m_invIA = m_bodyA->m_invI;
@@ -362,8 +362,8 @@ float32 b2WheelJoint::GetJointTranslation() const
 
 float32 b2WheelJoint::GetJointSpeed() const
 {
-	float32 wA = m_bodyA->m_angularVelocity;
-	float32 wB = m_bodyB->m_angularVelocity;
+	float32 wA = m_bodyA->m_state->angularVelocity;
+	float32 wB = m_bodyB->m_state->angularVelocity;
 	return wB - wA;
 }
 
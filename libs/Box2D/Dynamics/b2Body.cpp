@@ -23,7 +23,7 @@
 #include <Box2D/Dynamics/Contacts/b2Contact.h>
 #include <Box2D/Dynamics/Joints/b2Joint.h>
 
-b2Body::b2Body(const b2BodyDef* bd, b2World* world)
+b2Body::b2Body(const b2BodyDef* bd, b2World* world, b2BodyState* state)
 {
 	b2Assert(bd->position.IsValid());
 	b2Assert(bd->linearVelocity.IsValid());
@@ -32,56 +32,70 @@ b2Body::b2Body(const b2BodyDef* bd, b2World* world)
 	b2Assert(b2IsValid(bd->angularDamping) && bd->angularDamping >= 0.0f);
 	b2Assert(b2IsValid(bd->linearDamping) && bd->linearDamping >= 0.0f);
 
-	m_flags = 0;
+	m_state = state;
+	m_state->body = this;
+	m_state->flags = 0;
 
 	if (bd->bullet)
 	{
-		m_flags |= e_bulletFlag;
+		m_state->flags |= e_bulletFlag;
+	}
+	if (bd->speculative)
+	{
+		m_state->flags |= e_speculativeFlag;
 	}
 	if (bd->fixedRotation)
 	{
-		m_flags |= e_fixedRotationFlag;
+		m_state->flags |= e_fixedRotationFlag;
 	}
 	if (bd->allowSleep)
 	{
-		m_flags |= e_autoSleepFlag;
+		m_state->flags |= e_autoSleepFlag;
 	}
 	if (bd->awake)
 	{
-		m_flags |= e_awakeFlag;
+		m_state->flags |= e_awakeFlag;
 	}
 	if (bd->active)
 	{
-		m_flags |= e_activeFlag;
+		m_state->flags |= e_activeFlag;
 	}
 
 	m_world = world;
 
-	m_xf.p = bd->position;
-	m_xf.q.Set(bd->angle);
-	m_xf0 = m_xf;
+	m_state->xf.p = bd->position;
+	m_state->xf.q.Set(bd->angle);
+	m_state->xf0 = m_state->xf;
 
-	m_sweep.localCenter.SetZero();
-	m_sweep.c0 = m_xf.p;
-	m_sweep.c = m_xf.p;
-	m_sweep.a0 = bd->angle;
-	m_sweep.a = bd->angle;
-	m_sweep.alpha0 = 0.0f;
+	m_state->sweep.localCenter.SetZero();
+	m_state->sweep.c0 = m_state->xf.p;
+	m_state->sweep.c = m_state->xf.p;
+	m_state->sweep.a0 = bd->angle;
+	m_state->sweep.a = bd->angle;
+	m_state->sweep.alpha0 = 0.0f;
 
 	m_jointList = NULL;
 	m_contactList = NULL;
 	m_prev = NULL;
 	m_next = NULL;
 
-	m_linearVelocity = bd->linearVelocity;
-	m_angularVelocity = bd->angularVelocity;
+	m_awakeIndex = -1;
+	m_toiStamp = 0;
+	m_toiEventCount = 0;
+
+	m_persistentIsland = NULL;
+	m_islandPrev = NULL;
+	m_islandNext = NULL;
+
+	m_state->linearVelocity = bd->linearVelocity;
+	m_state->angularVelocity = bd->angularVelocity;
 
 	m_linearDamping = bd->linearDamping;
 	m_angularDamping = bd->angularDamping;
 	m_gravityScale = bd->gravityScale;
 
-	m_force.SetZero();
-	m_torque = 0.0f;
+	m_state->force.SetZero();
+	m_state->torque = 0.0f;
 
 	m_sleepTime = 0.0f;
 
@@ -102,6 +116,7 @@ b2Body::b2Body(const b2BodyDef* bd, b2World* world)
 	m_invI = 0.0f;
 
 	m_userData = bd->userData;
+	m_cacheKey = bd->cacheKey;
 
 	m_fixtureList = NULL;
 	m_fixtureCount = 0;
@@ -131,17 +146,17 @@ void b2Body::SetType(b2BodyType type)
 
 	if (m_type == b2_staticBody)
 	{
-		m_linearVelocity.SetZero();
-		m_angularVelocity = 0.0f;
-		m_sweep.a0 = m_sweep.a;
-		m_sweep.c0 = m_sweep.c;
+		m_state->linearVelocity.SetZero();
+		m_state->angularVelocity = 0.0f;
+		m_state->sweep.a0 = m_state->sweep.a;
+		m_state->sweep.c0 = m_state->sweep.c;
 		SynchronizeFixtures();
 	}
 
 	SetAwake(true);
 
-	m_force.SetZero();
-	m_torque = 0.0f;
+	m_state->force.SetZero();
+	m_state->torque = 0.0f;
 
 	// Delete the attached contacts.
 	b2ContactEdge* ce = m_contactList;
@@ -153,6 +168,18 @@ void b2Body::SetType(b2BodyType type)
 	}
 	m_contactList = NULL;
 
+	if (m_type == b2_staticBody)
+	{
+		m_world->m_islandManager.RemoveBody(this);
+	}
+	else if (m_persistentIsland == NULL && IsActive())
+	{
+		m_world->m_islandManager.AddBody(this);
+	}
+
+	// The body was already awake if it was static.
+	m_world->AddAwakeBody(this);
+
 	// Touch the proxies so that new contacts will be created (when appropriate)
 	b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
 	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
@@ -179,10 +206,10 @@ b2Fixture* b2Body::CreateFixture(const b2FixtureDef* def)
 	b2Fixture* fixture = new (memory) b2Fixture;
 	fixture->Create(allocator, this, def);
 
-	if (m_flags & e_activeFlag)
+	if (m_state->flags & e_activeFlag)
 	{
 		b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
-		fixture->CreateProxies(broadPhase, m_xf);
+		fixture->CreateProxies(broadPhase, m_state->xf);
 	}
 
 	fixture->m_next = m_fixtureList;
@@ -223,6 +250,26 @@ void b2Body::DestroyFixture(b2Fixture* fixture)
 
 	b2Assert(fixture->m_body == this);
 
+	// Destroy any contacts associated with the fixture.
+	b2ContactEdge* edge = m_contactList;
+	while (edge)
+	{
+		b2Contact* c = edge->contact;
+		edge = edge->next;
+
+		b2Fixture* fixtureA = c->GetFixtureA();
+		b2Fixture* fixtureB = c->GetFixtureB();
+
+		if (fixture == fixtureA || fixture == fixtureB)
+		{
+			// This destroys the contact and removes it from
+			// this body's contact list. The fixture is still listed so
+			// its index can be cached.
+			m_world->m_contactManager.Cache(c);
+			m_world->m_contactManager.Destroy(c);
+		}
+	}
+
 	// Remove the fixture from this body's singly linked list.
 	b2Assert(m_fixtureCount > 0);
 	b2Fixture** node = &m_fixtureList;
@@ -246,27 +293,9 @@ void b2Body::DestroyFixture(b2Fixture* fixture)
 	// You tried to remove a shape that is not attached to this body.
 	b2Assert(found);
 
-	// Destroy any contacts associated with the fixture.
-	b2ContactEdge* edge = m_contactList;
-	while (edge)
-	{
-		b2Contact* c = edge->contact;
-		edge = edge->next;
-
-		b2Fixture* fixtureA = c->GetFixtureA();
-		b2Fixture* fixtureB = c->GetFixtureB();
-
-		if (fixture == fixtureA || fixture == fixtureB)
-		{
-			// This destroys the contact and removes it from
-			// this body's contact list.
-			m_world->m_contactManager.Destroy(c);
-		}
-	}
-
 	b2BlockAllocator* allocator = &m_world->m_blockAllocator;
 
-	if (m_flags & e_activeFlag)
+	if (m_state->flags & e_activeFlag)
 	{
 		b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
 		fixture->DestroyProxies(broadPhase);
@@ -291,14 +320,14 @@ void b2Body::ResetMassData()
 	m_invMass = 0.0f;
 	m_I = 0.0f;
 	m_invI = 0.0f;
-	m_sweep.localCenter.SetZero();
+	m_state->sweep.localCenter.SetZero();
 
 	// Static and kinematic bodies have zero mass.
 	if (m_type == b2_staticBody || m_type == b2_kinematicBody)
 	{
-		m_sweep.c0 = m_xf.p;
-		m_sweep.c = m_xf.p;
-		m_sweep.a0 = m_sweep.a;
+		m_state->sweep.c0 = m_state->xf.p;
+		m_state->sweep.c = m_state->xf.p;
+		m_state->sweep.a0 = m_state->sweep.a;
 		return;
 	}
 
@@ -333,7 +362,7 @@ void b2Body::ResetMassData()
 		m_invMass = 1.0f;
 	}
 
-	if (m_I > 0.0f && (m_flags & e_fixedRotationFlag) == 0)
+	if (m_I > 0.0f && (m_state->flags & e_fixedRotationFlag) == 0)
 	{
 		// Center the inertia about the center of mass.
 		m_I -= m_mass * b2Dot(localCenter, localCenter);
@@ -348,12 +377,12 @@ void b2Body::ResetMassData()
 	}
 
 	// Move center of mass.
-	b2Vec2 oldCenter = m_sweep.c;
-	m_sweep.localCenter = localCenter;
-	m_sweep.c0 = m_sweep.c = b2Mul(m_xf, m_sweep.localCenter);
+	b2Vec2 oldCenter = m_state->sweep.c;
+	m_state->sweep.localCenter = localCenter;
+	m_state->sweep.c0 = m_state->sweep.c = b2Mul(m_state->xf, m_state->sweep.localCenter);
 
 	// Update center of mass velocity.
-	m_linearVelocity += b2Cross(m_angularVelocity, m_sweep.c - oldCenter);
+	m_state->linearVelocity += b2Cross(m_state->angularVelocity, m_state->sweep.c - oldCenter);
 }
 
 void b2Body::SetMassData(const b2MassData* massData)
@@ -381,7 +410,7 @@ void b2Body::SetMassData(const b2MassData* massData)
 
 	m_invMass = 1.0f / m_mass;
 
-	if (massData->I > 0.0f && (m_flags & b2Body::e_fixedRotationFlag) == 0)
+	if (massData->I > 0.0f && (m_state->flags & b2Body::e_fixedRotationFlag) == 0)
 	{
 		m_I = massData->I - m_mass * b2Dot(massData->center, massData->center);
 		b2Assert(m_I > 0.0f);
@@ -389,12 +418,12 @@ void b2Body::SetMassData(const b2MassData* massData)
 	}
 
 	// Move center of mass.
-	b2Vec2 oldCenter = m_sweep.c;
-	m_sweep.localCenter =  massData->center;
-	m_sweep.c0 = m_sweep.c = b2Mul(m_xf, m_sweep.localCenter);
+	b2Vec2 oldCenter = m_state->sweep.c;
+	m_state->sweep.localCenter =  massData->center;
+	m_state->sweep.c0 = m_state->sweep.c = b2Mul(m_state->xf, m_state->sweep.localCenter);
 
 	// Update center of mass velocity.
-	m_linearVelocity += b2Cross(m_angularVelocity, m_sweep.c - oldCenter);
+	m_state->linearVelocity += b2Cross(m_state->angularVelocity, m_state->sweep.c - oldCenter);
 }
 
 bool b2Body::ShouldCollide(const b2Body* other) const
@@ -428,33 +457,52 @@ void b2Body::SetTransform(const b2Vec2& position, float32 angle)
 		return;
 	}
 
-	m_xf.q.Set(angle);
-	m_xf.p = position;
-	m_xf0 = m_xf;
+	m_state->xf.q.Set(angle);
+	m_state->xf.p = position;
+	m_state->xf0 = m_state->xf;
 
-	m_sweep.c = b2Mul(m_xf, m_sweep.localCenter);
-	m_sweep.a = angle;
+	m_state->sweep.c = b2Mul(m_state->xf, m_state->sweep.localCenter);
+	m_state->sweep.a = angle;
 
-	m_sweep.c0 = m_sweep.c;
-	m_sweep.a0 = angle;
+	m_state->sweep.c0 = m_state->sweep.c;
+	m_state->sweep.a0 = angle;
 
 	b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
 	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
 	{
-		f->Synchronize(broadPhase, m_xf, m_xf);
+		f->Synchronize(broadPhase, m_state->xf, m_state->xf);
 	}
 }
 
+void b2Body::Wake()
+{
+	if (m_persistentIsland)
+	{
+		m_persistentIsland->awake = true;
+	}
+	m_world->AddAwakeBody(this);
+}
+
 void b2Body::SynchronizeFixtures()
 {
 	b2Transform xf1;
-	xf1.q.Set(m_sweep.a0);
-	xf1.p = m_sweep.c0 - b2Mul(xf1.q, m_sweep.localCenter);
+	xf1.q.Set(m_state->sweep.a0);
+	xf1.p = m_state->sweep.c0 - b2Mul(xf1.q, m_state->sweep.localCenter);
+
+	// Speculative bodies also cover the same motion again, so the contacts
+	// of the next step exist before the shapes meet.
+	b2Transform xf2 = m_state->xf;
+	if (m_world->m_speculativeContacts || IsSpeculative())
+	{
+		const b2Sweep& sweep = m_state->sweep;
+		xf2.q.Set(2.0f * sweep.a - sweep.a0);
+		xf2.p = 2.0f * sweep.c - sweep.c0 - b2Mul(xf2.q, sweep.localCenter);
+	}
 
 	b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
 	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
 	{
-		f->Synchronize(broadPhase, xf1, m_xf);
+		f->Synchronize(broadPhase, xf1, xf2);
 	}
 }
 
@@ -469,20 +517,25 @@ void b2Body::SetActive(bool flag)
 
 	if (flag)
 	{
-		m_flags |= e_activeFlag;
+		m_state->flags |= e_activeFlag;
 
 		// Create all proxies.
 		b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
 		for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
 		{
-			f->CreateProxies(broadPhase, m_xf);
+			f->CreateProxies(broadPhase, m_state->xf);
+		}
+
+		if (m_type != b2_staticBody)
+		{
+			m_world->m_islandManager.AddBody(this);
 		}
 
 		// Contacts are created the next time step.
 	}
 	else
 	{
-		m_flags &= ~e_activeFlag;
+		m_state->flags &= ~e_activeFlag;
 
 		// Destroy all proxies.
 		b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
@@ -500,12 +553,14 @@ void b2Body::SetActive(bool flag)
 			m_world->m_contactManager.Destroy(ce0->contact);
 		}
 		m_contactList = NULL;
+
+		m_world->m_islandManager.RemoveBody(this);
 	}
 }
 
 void b2Body::SetFixedRotation(bool flag)
 {
-	bool status = (m_flags & e_fixedRotationFlag) == e_fixedRotationFlag;
+	bool status = (m_state->flags & e_fixedRotationFlag) == e_fixedRotationFlag;
 	if (status == flag)
 	{
 		return;
@@ -513,18 +568,28 @@ void b2Body::SetFixedRotation(bool flag)
 
 	if (flag)
 	{
-		m_flags |= e_fixedRotationFlag;
+		m_state->flags |= e_fixedRotationFlag;
 	}
 	else
 	{
-		m_flags &= ~e_fixedRotationFlag;
+		m_state->flags &= ~e_fixedRotationFlag;
 	}
 
-	m_angularVelocity = 0.0f;
+	m_state->angularVelocity = 0.0f;
 
 	ResetMassData();
 }
 
+int32 b2Body::GetTOIEventCount() const
+{
+	// The count is reset lazily when SolveTOI first touches the body.
+	if (m_toiStamp != m_world->m_toiStamp)
+	{
+		return 0;
+	}
+	return m_toiEventCount;
+}
+
 void b2Body::Dump()
 {
 	int32 bodyIndex = m_islandIndex;
@@ -532,17 +597,18 @@ void b2Body::Dump()
 	b2Log("{\n");
 	b2Log("  b2BodyDef bd;\n");
 	b2Log("  bd.type = b2BodyType(%d);\n", m_type);
-	b2Log("  bd.position.Set(%.15lef, %.15lef);\n", m_xf.p.x, m_xf.p.y);
-	b2Log("  bd.angle = %.15lef;\n", m_sweep.a);
-	b2Log("  bd.linearVelocity.Set(%.15lef, %.15lef);\n", m_linearVelocity.x, m_linearVelocity.y);
-	b2Log("  bd.angularVelocity = %.15lef;\n", m_angularVelocity);
+	b2Log("  bd.position.Set(%.15lef, %.15lef);\n", m_state->xf.p.x, m_state->xf.p.y);
+	b2Log("  bd.angle = %.15lef;\n", m_state->sweep.a);
+	b2Log("  bd.linearVelocity.Set(%.15lef, %.15lef);\n", m_state->linearVelocity.x, m_state->linearVelocity.y);
+	b2Log("  bd.angularVelocity = %.15lef;\n", m_state->angularVelocity);
 	b2Log("  bd.linearDamping = %.15lef;\n", m_linearDamping);
 	b2Log("  bd.angularDamping = %.15lef;\n", m_angularDamping);
-	b2Log("  bd.allowSleep = bool(%d);\n", m_flags & e_autoSleepFlag);
-	b2Log("  bd.awake = bool(%d);\n", m_flags & e_awakeFlag);
-	b2Log("  bd.fixedRotation = bool(%d);\n", m_flags & e_fixedRotationFlag);
-	b2Log("  bd.bullet = bool(%d);\n", m_flags & e_bulletFlag);
-	b2Log("  bd.active = bool(%d);\n", m_flags & e_activeFlag);
+	b2Log("  bd.allowSleep = bool(%d);\n", m_state->flags & e_autoSleepFlag);
+	b2Log("  bd.awake = bool(%d);\n", m_state->flags & e_awakeFlag);
+	b2Log("  bd.fixedRotation = bool(%d);\n", m_state->flags & e_fixedRotationFlag);
+	b2Log("  bd.bullet = bool(%d);\n", m_state->flags & e_bulletFlag);
+	b2Log("  bd.speculative = bool(%d);\n", m_state->flags & e_speculativeFlag);
+	b2Log("  bd.active = bool(%d);\n", m_state->flags & e_activeFlag);
 	b2Log("  bd.gravityScale = %.15lef;\n", m_gravityScale);
 	b2Log("  bodies[%d] = m_world->CreateBody(&bd);\n", m_islandIndex);
 	b2Log("\n");
@@ -22,6 +22,7 @@
 
 #include <Box2D/Common/b2Math.h>
 #include <Box2D/Collision/Shapes/b2Shape.h>
+#include <Box2D/Dynamics/b2IslandManager.h>
 #include <memory>
 
 class b2Fixture;
@@ -29,6 +30,7 @@ class b2Joint;
 class b2Contact;
 class b2Controller;
 class b2World;
+class b2Body;
 struct b2FixtureDef;
 struct b2JointEdge;
 struct b2ContactEdge;
@@ -55,6 +57,7 @@ struct b2BodyDef
 	b2BodyDef()
 	{
 		userData = NULL;
+		cacheKey = 0;
 		position.Set(0.0f, 0.0f);
 		angle = 0.0f;
 		linearVelocity.Set(0.0f, 0.0f);
@@ -65,6 +68,7 @@ struct b2BodyDef
 		awake = true;
 		fixedRotation = false;
 		bullet = false;
+		speculative = false;
 		type = b2_staticBody;
 		active = true;
 		gravityScale = 1.0f;
@@ -118,16 +122,45 @@ struct b2BodyDef
 	/// @warning You should use this flag sparingly since it increases processing time.
 	bool bullet;
 
+	/// Should the contacts of this body be speculative? See b2Body::SetSpeculative.
+	bool speculative;
+
 	/// Does this body start out active?
 	bool active;
 
 	/// Use this to store application specific body data.
 	void* userData;
 
+	/// Identifies this body across re-creation, 0 for none. Contacts of a
+	/// destroyed body are cached by key and fixture index for a few steps
+	/// and a body created with the same key warm starts from them.
+	uint32 cacheKey;
+
 	/// Scale the gravity applied to this body.
 	float32 gravityScale;
 };
 
+/// The body state touched every step. b2World keeps these in one dense
+/// array, indexed by creation order with holes filled from the end, so
+/// per-step sweeps stay in cache. The array moves as bodies are created
+/// and destroyed; b2Body is the stable handle.
+struct b2BodyState
+{
+	b2Transform xf;		// the body origin transform
+	b2Transform xf0;	// the previous transform for particle simulation
+	b2Sweep sweep;		// the swept motion for CCD
+
+	b2Vec2 linearVelocity;
+	float32 angularVelocity;
+
+	b2Vec2 force;
+	float32 torque;
+
+	uint16 flags;
+
+	b2Body* body;
+};
+
 /// A rigid body. These are created via b2World::CreateBody.
 class b2Body
 {
@@ -167,7 +200,8 @@ public:
 	void SetTransform(const b2Vec2& position, float32 angle);
 
 	/// Get the body transform for the body's origin.
-	/// @return the world transform of the body's origin.
+	/// @return the world transform of the body's origin. The reference
+	/// is only valid until the next body is created or destroyed.
 	const b2Transform& GetTransform() const;
 
 	/// Get the world body origin position.
@@ -317,6 +351,19 @@ public:
 	/// Is this body treated like a bullet for continuous collision detection?
 	bool IsBullet() const;
 
+	/// Should the contacts of this body be speculative? A speculative
+	/// contact also keeps the points the shapes can reach within a step and
+	/// the solver only lets the bodies close that gap, which prevents
+	/// tunneling without TOI sub-steps. Contacts begin slightly before the
+	/// shapes touch, and restitution is lost on speculative points.
+	void SetSpeculative(bool flag);
+
+	/// Are the contacts of this body speculative?
+	bool IsSpeculative() const;
+
+	/// Get the number of TOI sub-steps this body took in the last step.
+	int32 GetTOIEventCount() const;
+
 	/// You can disable sleeping on this body. If you disable sleeping, the
 	/// body will be woken.
 	void SetSleepingAllowed(bool flag);
@@ -382,6 +429,11 @@ public:
 	/// Set the user data. Use this to store your application specific data.
 	void SetUserData(void* data);
 
+	/// Get/set the key that identifies this body across re-creation.
+	/// See b2BodyDef::cacheKey.
+	uint32 GetCacheKey() const;
+	void SetCacheKey(uint32 key);
+
 	/// Get the parent world of this body.
 	b2World* GetWorld();
 	const b2World* GetWorld() const;
@@ -408,6 +460,7 @@ private:
 	friend class b2ContactManager;
 	friend class b2ContactSolver;
 	friend class b2Contact;
+	friend class b2IslandManager;
 
 	friend class b2DistanceJoint;
 	friend class b2FrictionJoint;
@@ -424,7 +477,7 @@ private:
 	friend class b2ParticleSystem;
 	friend class b2ParticleGroup;
 
-	// m_flags
+	// b2BodyState::flags
 	enum
 	{
 		e_islandFlag		= 0x0001,
@@ -433,10 +486,11 @@ private:
 		e_bulletFlag		= 0x0008,
 		e_fixedRotationFlag	= 0x0010,
 		e_activeFlag		= 0x0020,
-		e_toiFlag			= 0x0040
+		e_toiFlag			= 0x0040,
+		e_speculativeFlag	= 0x0080
 	};
 
-	b2Body(const b2BodyDef* bd, b2World* world);
+	b2Body(const b2BodyDef* bd, b2World* world, b2BodyState* state);
 	~b2Body();
 
 	void SynchronizeFixtures();
@@ -448,21 +502,27 @@ private:
 
 	void Advance(float32 t);
 
+	// Join the awake set and wake the persistent island.
+	void Wake();
+
 	b2BodyType m_type;
 
-	uint16 m_flags;
+	// Hot state in b2World's body state array.
+	b2BodyState* m_state;
 
 	int32 m_islandIndex;
 
-	b2Transform m_xf;		// the body origin transform
-	b2Transform m_xf0;		// the previous transform for particle simulation
-	b2Sweep m_sweep;		// the swept motion for CCD
+	// Index in b2World's awake set, -1 when not in it.
+	int32 m_awakeIndex;
 
-	b2Vec2 m_linearVelocity;
-	float32 m_angularVelocity;
+	// Step in which SolveTOI last reset this body's TOI state.
+	uint32 m_toiStamp;
+	int32 m_toiEventCount;
 
-	b2Vec2 m_force;
-	float32 m_torque;
+	// Persistent island membership, NULL for static and inactive bodies.
+	b2PersistentIsland* m_persistentIsland;
+	b2Body* m_islandPrev;
+	b2Body* m_islandNext;
 
 	b2World* m_world;
 	b2Body* m_prev;
@@ -486,6 +546,7 @@ private:
 	float32 m_sleepTime;
 
 	void* m_userData;
+	uint32 m_cacheKey;
 };
 
 inline b2BodyType b2Body::GetType() const
@@ -495,27 +556,27 @@ inline b2BodyType b2Body::GetType() const
 
 inline const b2Transform& b2Body::GetTransform() const
 {
-	return m_xf;
+	return m_state->xf;
 }
 
 inline const b2Vec2& b2Body::GetPosition() const
 {
-	return m_xf.p;
+	return m_state->xf.p;
 }
 
 inline float32 b2Body::GetAngle() const
 {
-	return m_sweep.a;
+	return m_state->sweep.a;
 }
 
 inline const b2Vec2& b2Body::GetWorldCenter() const
 {
-	return m_sweep.c;
+	return m_state->sweep.c;
 }
 
 inline const b2Vec2& b2Body::GetLocalCenter() const
 {
-	return m_sweep.localCenter;
+	return m_state->sweep.localCenter;
 }
 
 inline void b2Body::SetLinearVelocity(const b2Vec2& v)
@@ -530,12 +591,12 @@ inline void b2Body::SetLinearVelocity(const b2Vec2& v)
 		SetAwake(true);
 	}
 
-	m_linearVelocity = v;
+	m_state->linearVelocity = v;
 }
 
 inline const b2Vec2& b2Body::GetLinearVelocity() const
 {
-	return m_linearVelocity;
+	return m_state->linearVelocity;
 }
 
 inline void b2Body::SetAngularVelocity(float32 w)
@@ -550,12 +611,12 @@ inline void b2Body::SetAngularVelocity(float32 w)
 		SetAwake(true);
 	}
 
-	m_angularVelocity = w;
+	m_state->angularVelocity = w;
 }
 
 inline float32 b2Body::GetAngularVelocity() const
 {
-	return m_angularVelocity;
+	return m_state->angularVelocity;
 }
 
 inline float32 b2Body::GetMass() const
@@ -565,39 +626,39 @@ inline float32 b2Body::GetMass() const
 
 inline float32 b2Body::GetInertia() const
 {
-	return m_I + m_mass * b2Dot(m_sweep.localCenter, m_sweep.localCenter);
+	return m_I + m_mass * b2Dot(m_state->sweep.localCenter, m_state->sweep.localCenter);
 }
 
 inline void b2Body::GetMassData(b2MassData* data) const
 {
 	data->mass = m_mass;
-	data->I = m_I + m_mass * b2Dot(m_sweep.localCenter, m_sweep.localCenter);
-	data->center = m_sweep.localCenter;
+	data->I = m_I + m_mass * b2Dot(m_state->sweep.localCenter, m_state->sweep.localCenter);
+	data->center = m_state->sweep.localCenter;
 }
 
 inline b2Vec2 b2Body::GetWorldPoint(const b2Vec2& localPoint) const
 {
-	return b2Mul(m_xf, localPoint);
+	return b2Mul(m_state->xf, localPoint);
 }
 
 inline b2Vec2 b2Body::GetWorldVector(const b2Vec2& localVector) const
 {
-	return b2Mul(m_xf.q, localVector);
+	return b2Mul(m_state->xf.q, localVector);
 }
 
 inline b2Vec2 b2Body::GetLocalPoint(const b2Vec2& worldPoint) const
 {
-	return b2MulT(m_xf, worldPoint);
+	return b2MulT(m_state->xf, worldPoint);
 }
 
 inline b2Vec2 b2Body::GetLocalVector(const b2Vec2& worldVector) const
 {
-	return b2MulT(m_xf.q, worldVector);
+	return b2MulT(m_state->xf.q, worldVector);
 }
 
 inline b2Vec2 b2Body::GetLinearVelocityFromWorldPoint(const b2Vec2& worldPoint) const
 {
-	return m_linearVelocity + b2Cross(m_angularVelocity, worldPoint - m_sweep.c);
+	return m_state->linearVelocity + b2Cross(m_state->angularVelocity, worldPoint - m_state->sweep.c);
 }
 
 inline b2Vec2 b2Body::GetLinearVelocityFromLocalPoint(const b2Vec2& localPoint) const
@@ -639,71 +700,89 @@ inline void b2Body::SetBullet(bool flag)
 {
 	if (flag)
 	{
-		m_flags |= e_bulletFlag;
+		m_state->flags |= e_bulletFlag;
 	}
 	else
 	{
-		m_flags &= ~e_bulletFlag;
+		m_state->flags &= ~e_bulletFlag;
 	}
 }
 
 inline bool b2Body::IsBullet() const
 {
-	return (m_flags & e_bulletFlag) == e_bulletFlag;
+	return (m_state->flags & e_bulletFlag) == e_bulletFlag;
+}
+
+inline void b2Body::SetSpeculative(bool flag)
+{
+	if (flag)
+	{
+		m_state->flags |= e_speculativeFlag;
+	}
+	else
+	{
+		m_state->flags &= ~e_speculativeFlag;
+	}
+}
+
+inline bool b2Body::IsSpeculative() const
+{
+	return (m_state->flags & e_speculativeFlag) == e_speculativeFlag;
 }
 
 inline void b2Body::SetAwake(bool flag)
 {
 	if (flag)
 	{
-		if ((m_flags & e_awakeFlag) == 0)
+		if ((m_state->flags & e_awakeFlag) == 0)
 		{
-			m_flags |= e_awakeFlag;
+			m_state->flags |= e_awakeFlag;
 			m_sleepTime = 0.0f;
+			Wake();
 		}
 	}
 	else
 	{
-		m_flags &= ~e_awakeFlag;
+		m_state->flags &= ~e_awakeFlag;
 		m_sleepTime = 0.0f;
-		m_linearVelocity.SetZero();
-		m_angularVelocity = 0.0f;
-		m_force.SetZero();
-		m_torque = 0.0f;
+		m_state->linearVelocity.SetZero();
+		m_state->angularVelocity = 0.0f;
+		m_state->force.SetZero();
+		m_state->torque = 0.0f;
 	}
 }
 
 inline bool b2Body::IsAwake() const
 {
-	return (m_flags & e_awakeFlag) == e_awakeFlag;
+	return (m_state->flags & e_awakeFlag) == e_awakeFlag;
 }
 
 inline bool b2Body::IsActive() const
 {
-	return (m_flags & e_activeFlag) == e_activeFlag;
+	return (m_state->flags & e_activeFlag) == e_activeFlag;
 }
 
 inline bool b2Body::IsFixedRotation() const
 {
-	return (m_flags & e_fixedRotationFlag) == e_fixedRotationFlag;
+	return (m_state->flags & e_fixedRotationFlag) == e_fixedRotationFlag;
 }
 
 inline void b2Body::SetSleepingAllowed(bool flag)
 {
 	if (flag)
 	{
-		m_flags |= e_autoSleepFlag;
+		m_state->flags |= e_autoSleepFlag;
 	}
 	else
 	{
-		m_flags &= ~e_autoSleepFlag;
+		m_state->flags &= ~e_autoSleepFlag;
 		SetAwake(true);
 	}
 }
 
 inline bool b2Body::IsSleepingAllowed() const
 {
-	return (m_flags & e_autoSleepFlag) == e_autoSleepFlag;
+	return (m_state->flags & e_autoSleepFlag) == e_autoSleepFlag;
 }
 
 inline b2Fixture* b2Body::GetFixtureList()
@@ -756,6 +835,16 @@ inline void* b2Body::GetUserData() const
 	return m_userData;
 }
 
+inline uint32 b2Body::GetCacheKey() const
+{
+	return m_cacheKey;
+}
+
+inline void b2Body::SetCacheKey(uint32 key)
+{
+	m_cacheKey = key;
+}
+
 inline void b2Body::ApplyForce(const b2Vec2& force, const b2Vec2& point, bool wake)
 {
 	if (m_type != b2_dynamicBody)
@@ -763,16 +852,16 @@ inline void b2Body::ApplyForce(const b2Vec2& force, const b2Vec2& point, bool wa
 		return;
 	}
 
-	if (wake && (m_flags & e_awakeFlag) == 0)
+	if (wake && (m_state->flags & e_awakeFlag) == 0)
 	{
 		SetAwake(true);
 	}
 
 	// Don't accumulate a force if the body is sleeping.
-	if (m_flags & e_awakeFlag)
+	if (m_state->flags & e_awakeFlag)
 	{
-		m_force += force;
-		m_torque += b2Cross(point - m_sweep.c, force);
+		m_state->force += force;
+		m_state->torque += b2Cross(point - m_state->sweep.c, force);
 	}
 }
 
@@ -783,15 +872,15 @@ inline void b2Body::ApplyForceToCenter(const b2Vec2& force, bool wake)
 		return;
 	}
 
-	if (wake && (m_flags & e_awakeFlag) == 0)
+	if (wake && (m_state->flags & e_awakeFlag) == 0)
 	{
 		SetAwake(true);
 	}
 
 	// Don't accumulate a force if the body is sleeping
-	if (m_flags & e_awakeFlag)
+	if (m_state->flags & e_awakeFlag)
 	{
-		m_force += force;
+		m_state->force += force;
 	}
 }
 
@@ -802,15 +891,15 @@ inline void b2Body::ApplyTorque(float32 torque, bool wake)
 		return;
 	}
 
-	if (wake && (m_flags & e_awakeFlag) == 0)
+	if (wake && (m_state->flags & e_awakeFlag) == 0)
 	{
 		SetAwake(true);
 	}
 
 	// Don't accumulate a force if the body is sleeping
-	if (m_flags & e_awakeFlag)
+	if (m_state->flags & e_awakeFlag)
 	{
-		m_torque += torque;
+		m_state->torque += torque;
 	}
 }
 
@@ -821,16 +910,16 @@ inline void b2Body::ApplyLinearImpulse(const b2Vec2& impulse, const b2Vec2& poin
 		return;
 	}
 
-	if (wake && (m_flags & e_awakeFlag) == 0)
+	if (wake && (m_state->flags & e_awakeFlag) == 0)
 	{
 		SetAwake(true);
 	}
 
 	// Don't accumulate velocity if the body is sleeping
-	if (m_flags & e_awakeFlag)
+	if (m_state->flags & e_awakeFlag)
 	{
-		m_linearVelocity += m_invMass * impulse;
-		m_angularVelocity += m_invI * b2Cross(point - m_sweep.c, impulse);
+		m_state->linearVelocity += m_invMass * impulse;
+		m_state->angularVelocity += m_invI * b2Cross(point - m_state->sweep.c, impulse);
 	}
 }
 
@@ -841,32 +930,32 @@ inline void b2Body::ApplyAngularImpulse(float32 impulse, bool wake)
 		return;
 	}
 
-	if (wake && (m_flags & e_awakeFlag) == 0)
+	if (wake && (m_state->flags & e_awakeFlag) == 0)
 	{
 		SetAwake(true);
 	}
 
 	// Don't accumulate velocity if the body is sleeping
-	if (m_flags & e_awakeFlag)
+	if (m_state->flags & e_awakeFlag)
 	{
-		m_angularVelocity += m_invI * impulse;
+		m_state->angularVelocity += m_invI * impulse;
 	}
 }
 
 inline void b2Body::SynchronizeTransform()
 {
-	m_xf.q.Set(m_sweep.a);
-	m_xf.p = m_sweep.c - b2Mul(m_xf.q, m_sweep.localCenter);
+	m_state->xf.q.Set(m_state->sweep.a);
+	m_state->xf.p = m_state->sweep.c - b2Mul(m_state->xf.q, m_state->sweep.localCenter);
 }
 
 inline void b2Body::Advance(float32 alpha)
 {
 	// Advance to the new safe time. This doesn't sync the broad-phase.
-	m_sweep.Advance(alpha);
-	m_sweep.c = m_sweep.c0;
-	m_sweep.a = m_sweep.a0;
-	m_xf.q.Set(m_sweep.a);
-	m_xf.p = m_sweep.c - b2Mul(m_xf.q, m_sweep.localCenter);
+	m_state->sweep.Advance(alpha);
+	m_state->sweep.c = m_state->sweep.c0;
+	m_state->sweep.a = m_state->sweep.a0;
+	m_state->xf.q.Set(m_state->sweep.a);
+	m_state->xf.p = m_state->sweep.c - b2Mul(m_state->xf.q, m_state->sweep.localCenter);
 }
 
 inline b2World* b2Body::GetWorld()
@@ -20,6 +20,7 @@
 #include <Box2D/Dynamics/b2ContactManager.h>
 #include <Box2D/Dynamics/b2Body.h>
 #include <Box2D/Dynamics/b2Fixture.h>
+#include <Box2D/Dynamics/b2World.h>
 #include <Box2D/Dynamics/b2WorldCallbacks.h>
 #include <Box2D/Dynamics/Contacts/b2Contact.h>
 
@@ -33,6 +34,250 @@ b2ContactManager::b2ContactManager()
 	m_contactFilter = &b2_defaultFilter;
 	m_contactListener = &b2_defaultListener;
 	m_allocator = NULL;
+
+	m_activeContactCapacity = 16;
+	m_activeContactCount = 0;
+	m_activeContacts = (b2Contact**)b2Alloc(m_activeContactCapacity * sizeof(b2Contact*));
+
+	m_contactCacheCapacity = 16;
+	m_contactCacheCount = 0;
+	m_contactCache = (b2CachedContact*)b2Alloc(m_contactCacheCapacity * sizeof(b2CachedContact));
+	m_cacheBuckets = (int32*)b2Alloc(2 * m_contactCacheCapacity * sizeof(int32));
+	memset(m_cacheBuckets, 0xff, 2 * m_contactCacheCapacity * sizeof(int32));
+	m_cacheStep = 0;
+}
+
+b2ContactManager::~b2ContactManager()
+{
+	b2Free(m_activeContacts);
+	b2Free(m_cacheBuckets);
+	b2Free(m_contactCache);
+}
+
+// Index of a fixture in creation order. The body list is newest first.
+static int32 b2GetFixtureIndex(const b2Fixture* fixture)
+{
+	int32 index = 0;
+	for (const b2Fixture* f = fixture->GetNext(); f; f = f->GetNext())
+	{
+		++index;
+	}
+	return index;
+}
+
+static b2CachedSide b2GetCachedSide(const b2Fixture* fixture, int32 childIndex)
+{
+	const b2Body* body = fixture->GetBody();
+	b2CachedSide side;
+	side.key = body->GetCacheKey();
+	side.body = side.key != 0 ? NULL : body;
+	side.fixture = b2GetFixtureIndex(fixture);
+	side.child = childIndex;
+	return side;
+}
+
+static uint32 b2HashCachedSide(const b2CachedSide& side)
+{
+	uint32 id = side.key != 0 ? side.key : (uint32)((size_t)side.body >> 4);
+	return (id * 2654435761u) ^ ((uint32)side.fixture * 40503u) ^ ((uint32)side.child * 12289u);
+}
+
+// Sums are order independent, so a pair hashes the same both ways round.
+static uint32 b2HashCachedPair(const b2CachedSide& sideA, const b2CachedSide& sideB)
+{
+	return b2HashCachedSide(sideA) + b2HashCachedSide(sideB);
+}
+
+void b2ContactManager::Cache(b2Contact* c)
+{
+	if (c->m_manifold.pointCount == 0)
+	{
+		return;
+	}
+
+	if (m_contactCacheCount == m_contactCacheCapacity)
+	{
+		b2CachedContact* oldBuffer = m_contactCache;
+		m_contactCacheCapacity *= 2;
+		m_contactCache = (b2CachedContact*)b2Alloc(m_contactCacheCapacity * sizeof(b2CachedContact));
+		memcpy(m_contactCache, oldBuffer, m_contactCacheCount * sizeof(b2CachedContact));
+		b2Free(oldBuffer);
+
+		// Rehash into the larger bucket array.
+		int32 bucketCount = 2 * m_contactCacheCapacity;
+		b2Free(m_cacheBuckets);
+		m_cacheBuckets = (int32*)b2Alloc(bucketCount * sizeof(int32));
+		memset(m_cacheBuckets, 0xff, bucketCount * sizeof(int32));
+		for (int32 i = 0; i < m_contactCacheCount; ++i)
+		{
+			int32* head = m_cacheBuckets + (m_contactCache[i].hash & (bucketCount - 1));
+			m_contactCache[i].next = *head;
+			*head = i;
+		}
+	}
+
+	int32 index = m_contactCacheCount++;
+	b2CachedContact* entry = m_contactCache + index;
+	entry->sideA = b2GetCachedSide(c->GetFixtureA(), c->GetChildIndexA());
+	entry->sideB = b2GetCachedSide(c->GetFixtureB(), c->GetChildIndexB());
+	entry->hash = b2HashCachedPair(entry->sideA, entry->sideB);
+	entry->step = m_cacheStep;
+	entry->manifold = c->m_manifold;
+
+	int32* head = m_cacheBuckets + (entry->hash & (2 * m_contactCacheCapacity - 1));
+	entry->next = *head;
+	*head = index;
+}
+
+void b2ContactManager::RemoveCachedContact(int32 index)
+{
+	const int32 mask = 2 * m_contactCacheCapacity - 1;
+
+	// Unlink the entry from its chain.
+	int32* link = m_cacheBuckets + (m_contactCache[index].hash & mask);
+	while (*link != index)
+	{
+		link = &m_contactCache[*link].next;
+	}
+	*link = m_contactCache[index].next;
+
+	// Move the last entry into the hole and point its chain at it.
+	int32 last = --m_contactCacheCount;
+	if (index != last)
+	{
+		link = m_cacheBuckets + (m_contactCache[last].hash & mask);
+		while (*link != last)
+		{
+			link = &m_contactCache[*link].next;
+		}
+		*link = index;
+		m_contactCache[index] = m_contactCache[last];
+	}
+}
+
+void b2ContactManager::Restore(b2Contact* c)
+{
+	b2CachedSide sideA = b2GetCachedSide(c->GetFixtureA(), c->GetChildIndexA());
+	b2CachedSide sideB = b2GetCachedSide(c->GetFixtureB(), c->GetChildIndexB());
+	uint32 hash = b2HashCachedPair(sideA, sideB);
+
+	int32 i = m_cacheBuckets[hash & (2 * m_contactCacheCapacity - 1)];
+	for (; i != b2_nullNode; i = m_contactCache[i].next)
+	{
+		const b2CachedContact* entry = m_contactCache + i;
+		if (entry->hash != hash)
+		{
+			continue;
+		}
+
+		// Contact creation may order the fixtures the other way.
+		bool flip;
+		if (entry->sideA == sideA && entry->sideB == sideB)
+		{
+			flip = false;
+		}
+		else if (entry->sideA == sideB && entry->sideB == sideA)
+		{
+			flip = true;
+		}
+		else
+		{
+			continue;
+		}
+
+		// Update matches the contact ids of the new manifold against this
+		// one and carries the impulses over.
+		c->m_manifold = entry->manifold;
+		if (flip)
+		{
+			// The tangent follows the normal, which points the other way.
+			for (int32 j = 0; j < c->m_manifold.pointCount; ++j)
+			{
+				b2ManifoldPoint* mp = c->m_manifold.points + j;
+				b2ContactFeature cf = mp->id.cf;
+				mp->id.cf.indexA = cf.indexB;
+				mp->id.cf.indexB = cf.indexA;
+				mp->id.cf.typeA = cf.typeB;
+				mp->id.cf.typeB = cf.typeA;
+				mp->tangentImpulse = -mp->tangentImpulse;
+			}
+		}
+
+		RemoveCachedContact(i);
+		return;
+	}
+}
+
+void b2ContactManager::AgeCache()
+{
+	++m_cacheStep;
+	int32 i = 0;
+	while (i < m_contactCacheCount)
+	{
+		if (m_cacheStep - m_contactCache[i].step > b2_contactCacheSteps)
+		{
+			RemoveCachedContact(i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+void b2ContactManager::Uncache(const b2Body* body)
+{
+	int32 i = 0;
+	while (i < m_contactCacheCount)
+	{
+		if (m_contactCache[i].sideA.body == body || m_contactCache[i].sideB.body == body)
+		{
+			RemoveCachedContact(i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+void b2ContactManager::AddActiveContact(b2Contact* c)
+{
+	if (c->m_activeIndex != -1)
+	{
+		return;
+	}
+
+	if (m_activeContactCount == m_activeContactCapacity)
+	{
+		b2Contact** oldBuffer = m_activeContacts;
+		m_activeContactCapacity *= 2;
+		m_activeContacts = (b2Contact**)b2Alloc(m_activeContactCapacity * sizeof(b2Contact*));
+		memcpy(m_activeContacts, oldBuffer, m_activeContactCount * sizeof(b2Contact*));
+		b2Free(oldBuffer);
+	}
+
+	// The TOI state was last reset when the contact was active.
+	c->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
+	c->m_toiCount = 0;
+	c->m_toi = 1.0f;
+
+	c->m_activeIndex = m_activeContactCount;
+	m_activeContacts[m_activeContactCount++] = c;
+}
+
+void b2ContactManager::RemoveActiveContact(b2Contact* c)
+{
+	int32 index = c->m_activeIndex;
+	if (index == -1)
+	{
+		return;
+	}
+
+	b2Contact* last = m_activeContacts[--m_activeContactCount];
+	m_activeContacts[index] = last;
+	last->m_activeIndex = index;
+	c->m_activeIndex = -1;
 }
 
 void b2ContactManager::Destroy(b2Contact* c)
@@ -47,6 +292,9 @@ void b2ContactManager::Destroy(b2Contact* c)
 		m_contactListener->EndContact(c);
 	}
 
+	bodyA->m_world->m_islandManager.UnlinkContact(c);
+	RemoveActiveContact(c);
+
 	// Remove from the world.
 	if (c->m_prev)
 	{
@@ -101,14 +349,16 @@ void b2ContactManager::Destroy(b2Contact* c)
 }
 
 // This is the top level collision call for the time step. Here
-// all the narrow phase collision is processed for the world
-// contact list.
+// all the narrow phase collision is processed for the active
+// contacts. Contacts are removed from the set in place, so the
+// index only advances past contacts that stay.
 void b2ContactManager::Collide()
 {
 	// Update awake contacts.
-	b2Contact* c = m_contactList;
-	while (c)
+	int32 i = 0;
+	while (i < m_activeContactCount)
 	{
+		b2Contact* c = m_activeContacts[i];
 		b2Fixture* fixtureA = c->GetFixtureA();
 		b2Fixture* fixtureB = c->GetFixtureB();
 		int32 indexA = c->GetChildIndexA();
@@ -122,18 +372,14 @@ void b2ContactManager::Collide()
 			// Should these bodies collide?
 			if (bodyB->ShouldCollide(bodyA) == false)
 			{
-				b2Contact* cNuke = c;
-				c = cNuke->GetNext();
-				Destroy(cNuke);
+				Destroy(c);
 				continue;
 			}
 
 			// Check user filtering.
 			if (m_contactFilter && m_contactFilter->ShouldCollide(fixtureA, fixtureB) == false)
 			{
-				b2Contact* cNuke = c;
-				c = cNuke->GetNext();
-				Destroy(cNuke);
+				Destroy(c);
 				continue;
 			}
 
@@ -147,7 +393,8 @@ void b2ContactManager::Collide()
 		// At least one body must be awake and it must be dynamic or kinematic.
 		if (activeA == false && activeB == false)
 		{
-			c = c->GetNext();
+			// Asleep, it comes back when one of the bodies wakes up.
+			RemoveActiveContact(c);
 			continue;
 		}
 
@@ -158,15 +405,13 @@ void b2ContactManager::Collide()
 		// Here we destroy contacts that cease to overlap in the broad-phase.
 		if (overlap == false)
 		{
-			b2Contact* cNuke = c;
-			c = cNuke->GetNext();
-			Destroy(cNuke);
+			Destroy(c);
 			continue;
 		}
 
 		// The contact persists.
 		c->Update(m_contactListener);
-		c = c->GetNext();
+		++i;
 	}
 }
 
@@ -284,6 +529,13 @@ void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 	}
 	bodyB->m_contactList = &c->m_nodeB;
 
+	if (m_contactCacheCount > 0)
+	{
+		Restore(c);
+	}
+
+	AddActiveContact(c);
+
 	// Wake up the bodies
 	if (fixtureA->IsSensor() == false && fixtureB->IsSensor() == false)
 	{
@@ -20,13 +20,43 @@
 #define B2_CONTACT_MANAGER_H
 
 #include <Box2D/Collision/b2BroadPhase.h>
+#include <Box2D/Collision/b2Collision.h>
 
+class b2Body;
 class b2Contact;
 class b2ContactFilter;
 class b2ContactListener;
 class b2BlockAllocator;
 class b2ParticleSystem;
 
+// One side of a cached contact: the body cache key, or the body address
+// when the key is 0, and the fixture index in creation order.
+struct b2CachedSide
+{
+	bool operator==(const b2CachedSide& other) const
+	{
+		return key == other.key && body == other.body &&
+			fixture == other.fixture && child == other.child;
+	}
+
+	uint32 key;
+	const b2Body* body;
+	int32 fixture;
+	int32 child;
+};
+
+// The manifold of a contact destroyed with its body or fixture. Entries
+// are chained in hash buckets of both sides, so either fixture order
+// finds them.
+struct b2CachedContact
+{
+	b2CachedSide sideA, sideB;
+	uint32 hash;
+	int32 next;
+	int32 step;
+	b2Manifold manifold;
+};
+
 // Delegate of b2World.
 class b2ContactManager
 {
@@ -34,6 +64,7 @@ public:
 	friend class b2ParticleSystem;
 
 	b2ContactManager();
+	~b2ContactManager();
 
 	// Broad-phase callback.
 	void AddPair(void* proxyUserDataA, void* proxyUserDataB);
@@ -42,14 +73,53 @@ public:
 
 	void Destroy(b2Contact* c);
 
+	// Keep the impulses of a contact about to be destroyed so a contact
+	// created for the same key and fixture pair can warm start from them.
+	void Cache(b2Contact* c);
+
+	// Drop cached contacts older than b2_contactCacheSteps. Called once
+	// per step.
+	void AgeCache();
+
+	// Drop cached contacts that match body by address. Called before a
+	// body without a cache key is freed, as its address may be reused.
+	void Uncache(const b2Body* body);
+
 	void Collide();
-            
+
+	// Add a contact that may need narrow phase updates to the active set.
+	// Its TOI state is reset. Contacts already in the set are left alone.
+	void AddActiveContact(b2Contact* c);
+	void RemoveActiveContact(b2Contact* c);
+
 	b2BroadPhase m_broadPhase;
 	b2Contact* m_contactList;
 	int32 m_contactCount;
 	b2ContactFilter* m_contactFilter;
 	b2ContactListener* m_contactListener;
 	b2BlockAllocator* m_allocator;
+
+	// Contacts with at least one awake non-static body. Contacts whose
+	// bodies all went to sleep are dropped lazily by Collide, so filtering
+	// of sleeping contacts waits until one of the bodies wakes up.
+	b2Contact** m_activeContacts;
+	int32 m_activeContactCount;
+	int32 m_activeContactCapacity;
+
+	b2CachedContact* m_contactCache;
+	int32 m_contactCacheCount;
+	int32 m_contactCacheCapacity;
+	int32 m_cacheStep;
+
+	// Heads of the entry chains, twice the cache capacity so a power of two.
+	int32* m_cacheBuckets;
+
+private:
+	// Give a new contact the manifold cached for its pair, if any.
+	void Restore(b2Contact* c);
+
+	// Remove entry index, moving the last entry into its place.
+	void RemoveCachedContact(int32 index);
 };
 
 #endif
@@ -25,6 +25,7 @@
 #include <Box2D/Collision/Shapes/b2ChainShape.h>
 #include <Box2D/Collision/b2BroadPhase.h>
 #include <Box2D/Collision/b2Collision.h>
+#include <Box2D/Common/b2BatchMath.h>
 #include <Box2D/Common/b2BlockAllocator.h>
 
 b2Fixture::b2Fixture()
@@ -161,11 +162,21 @@ void b2Fixture::Synchronize(b2BroadPhase* broadPhase, const b2Transform& transfo
 		b2FixtureProxy* proxy = m_proxies + i;
 
 		// Compute an AABB that covers the swept shape (may miss some rotation effect).
-		b2AABB aabb1, aabb2;
-		m_shape->ComputeAABB(&aabb1, transform1, proxy->childIndex);
-		m_shape->ComputeAABB(&aabb2, transform2, proxy->childIndex);
-	
-		proxy->aabb.Combine(aabb1, aabb2);
+		// Polygons get both poses in one batch.
+		b2AABB aabbs[2];
+		if (m_shape->m_type == b2Shape::e_polygon)
+		{
+			b2PolygonShape* poly = (b2PolygonShape*)m_shape;
+			b2Transform xfs[2] = {transform1, transform2};
+			b2ComputeAABBs(aabbs, xfs, 2, poly->m_vertices, poly->m_count, poly->m_radius);
+		}
+		else
+		{
+			m_shape->ComputeAABB(aabbs + 0, transform1, proxy->childIndex);
+			m_shape->ComputeAABB(aabbs + 1, transform2, proxy->childIndex);
+		}
+
+		proxy->aabb.Combine(aabbs[0], aabbs[1]);
 
 		b2Vec2 displacement = transform2.p - transform1.p;
 
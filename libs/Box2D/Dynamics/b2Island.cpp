@@ -25,8 +25,11 @@
 #include <Box2D/Dynamics/Contacts/b2ContactSolver.h>
 #include <Box2D/Dynamics/Joints/b2Joint.h>
 #include <Box2D/Common/b2StackAllocator.h>
+#include <Box2D/Common/b2ThreadPool.h>
 #include <Box2D/Common/b2Timer.h>
 
+#include <string.h>
+
 /*
 Position Correction Notes
 =========================
@@ -145,6 +148,67 @@ This might be faster than computing sin+cos.
 However, we can compute sin+cos of the same angle fast.
 */
 
+// Shared state of a parallel island solve.
+struct b2ColoredSolve : public b2ThreadTask
+{
+	b2Island* island;
+	b2ContactSolver* contactSolver;
+	const b2SolverData* solverData;
+	b2Joint** joints;
+	int32 jointStarts[b2ContactSolver::e_maxColors + 2];
+	b2ThreadBarrier* barrier;
+	// Two slots per thread, alternating between position iterations.
+	bool* okay;
+	int32 iterations;
+	bool positions;
+	bool positionSolved;
+
+	void Execute(int32 threadIndex, int32 threadCount)
+	{
+		island->SolveColored(this, threadIndex, threadCount);
+	}
+};
+
+// Share of a color for one thread. The last color is not independent and
+// goes to thread 0. Returns false if the color is empty, then the threads
+// skip its barrier as well.
+static bool b2GetColorRange(const int32* starts, int32 color,
+							int32 threadIndex, int32 threadCount,
+							int32* begin, int32* end)
+{
+	int32 first = starts[color];
+	int32 count = starts[color + 1] - first;
+	if (count == 0)
+	{
+		return false;
+	}
+
+	if (color == b2ContactSolver::e_maxColors)
+	{
+		*begin = first;
+		*end = threadIndex == 0 ? first + count : first;
+		return true;
+	}
+
+	*begin = first + count * threadIndex / threadCount;
+	*end = first + count * (threadIndex + 1) / threadCount;
+	return true;
+}
+
+// Without a pool the calling thread runs the schedule alone, so the
+// constraints are solved in the same order as on any number of threads.
+static void RunColored(b2ColoredSolve* solve, b2ThreadPool* threadPool)
+{
+	if (threadPool)
+	{
+		threadPool->Run(solve);
+	}
+	else
+	{
+		solve->Execute(0, 1);
+	}
+}
+
 b2Island::b2Island(
 	int32 bodyCapacity,
 	int32 contactCapacity,
@@ -180,7 +244,8 @@ b2Island::~b2Island()
 	m_allocator->Free(m_bodies);
 }
 
-void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep)
+void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep,
+					 bool parallel, b2ThreadPool* threadPool)
 {
 	b2Timer timer;
 
@@ -191,20 +256,20 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	{
 		b2Body* b = m_bodies[i];
 
-		b2Vec2 c = b->m_sweep.c;
-		float32 a = b->m_sweep.a;
-		b2Vec2 v = b->m_linearVelocity;
-		float32 w = b->m_angularVelocity;
+		b2Vec2 c = b->m_state->sweep.c;
+		float32 a = b->m_state->sweep.a;
+		b2Vec2 v = b->m_state->linearVelocity;
+		float32 w = b->m_state->angularVelocity;
 
 		// Store positions for continuous collision.
-		b->m_sweep.c0 = b->m_sweep.c;
-		b->m_sweep.a0 = b->m_sweep.a;
+		b->m_state->sweep.c0 = b->m_state->sweep.c;
+		b->m_state->sweep.a0 = b->m_state->sweep.a;
 
 		if (b->m_type == b2_dynamicBody)
 		{
 			// Integrate velocities.
-			v += h * (b->m_gravityScale * gravity + b->m_invMass * b->m_force);
-			w += h * b->m_invI * b->m_torque;
+			v += h * (b->m_gravityScale * gravity + b->m_invMass * b->m_state->force);
+			w += h * b->m_invI * b->m_state->torque;
 
 			// Apply damping.
 			// ODE: dv/dt + c * v = 0
@@ -234,6 +299,8 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	// Initialize velocity constraints.
 	b2ContactSolverDef contactSolverDef;
 	contactSolverDef.step = step;
+	// The parallel solve runs on the colored batches of the wide solver.
+	contactSolverDef.step.wideContactSolver = step.wideContactSolver || parallel;
 	contactSolverDef.contacts = m_contacts;
 	contactSolverDef.count = m_contactCount;
 	contactSolverDef.positions = m_positions;
@@ -253,18 +320,44 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 		m_joints[i]->InitVelocityConstraints(solverData);
 	}
 
+	int32 threadCount = threadPool ? threadPool->GetThreadCount() : 1;
+	b2ThreadBarrier barrier(threadCount);
+	b2ColoredSolve colored;
+	colored.joints = NULL;
+	colored.okay = NULL;
+	if (parallel)
+	{
+		colored.island = this;
+		colored.contactSolver = &contactSolver;
+		colored.solverData = &solverData;
+		colored.joints = (b2Joint**)m_allocator->Allocate(m_jointCount * sizeof(b2Joint*));
+		ColorJoints(colored.joints, colored.jointStarts);
+		colored.barrier = &barrier;
+		colored.okay = (bool*)m_allocator->Allocate(2 * threadCount * sizeof(bool));
+		colored.positionSolved = false;
+	}
+
 	profile->solveInit = timer.GetMilliseconds();
 
 	// Solve velocity constraints
 	timer.Reset();
-	for (int32 i = 0; i < step.velocityIterations; ++i)
+	if (parallel)
 	{
-		for (int32 j = 0; j < m_jointCount; ++j)
+		colored.positions = false;
+		colored.iterations = step.velocityIterations;
+		RunColored(&colored, threadPool);
+	}
+	else
+	{
+		for (int32 i = 0; i < step.velocityIterations; ++i)
 		{
-			m_joints[j]->SolveVelocityConstraints(solverData);
-		}
+			for (int32 j = 0; j < m_jointCount; ++j)
+			{
+				m_joints[j]->SolveVelocityConstraints(solverData);
+			}
 
-		contactSolver.SolveVelocityConstraints();
+			contactSolver.SolveVelocityConstraints();
+		}
 	}
 
 	// Store impulses for warm starting
@@ -307,22 +400,35 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	// Solve position constraints
 	timer.Reset();
 	bool positionSolved = false;
-	for (int32 i = 0; i < step.positionIterations; ++i)
+	if (parallel)
 	{
-		bool contactsOkay = contactSolver.SolvePositionConstraints();
+		colored.positions = true;
+		colored.iterations = step.positionIterations;
+		RunColored(&colored, threadPool);
+		positionSolved = colored.positionSolved;
 
-		bool jointsOkay = true;
-		for (int32 i = 0; i < m_jointCount; ++i)
+		m_allocator->Free(colored.okay);
+		m_allocator->Free(colored.joints);
+	}
+	else
+	{
+		for (int32 i = 0; i < step.positionIterations; ++i)
 		{
-			bool jointOkay = m_joints[i]->SolvePositionConstraints(solverData);
-			jointsOkay = jointsOkay && jointOkay;
-		}
+			bool contactsOkay = contactSolver.SolvePositionConstraints();
 
-		if (contactsOkay && jointsOkay)
-		{
-			// Exit early if the position errors are small.
-			positionSolved = true;
-			break;
+			bool jointsOkay = true;
+			for (int32 i = 0; i < m_jointCount; ++i)
+			{
+				bool jointOkay = m_joints[i]->SolvePositionConstraints(solverData);
+				jointsOkay = jointsOkay && jointOkay;
+			}
+
+			if (contactsOkay && jointsOkay)
+			{
+				// Exit early if the position errors are small.
+				positionSolved = true;
+				break;
+			}
 		}
 	}
 
@@ -330,10 +436,10 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	for (int32 i = 0; i < m_bodyCount; ++i)
 	{
 		b2Body* body = m_bodies[i];
-		body->m_sweep.c = m_positions[i].c;
-		body->m_sweep.a = m_positions[i].a;
-		body->m_linearVelocity = m_velocities[i].v;
-		body->m_angularVelocity = m_velocities[i].w;
+		body->m_state->sweep.c = m_positions[i].c;
+		body->m_state->sweep.a = m_positions[i].a;
+		body->m_state->linearVelocity = m_velocities[i].v;
+		body->m_state->angularVelocity = m_velocities[i].w;
 		body->SynchronizeTransform();
 	}
 
@@ -356,9 +462,9 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 				continue;
 			}
 
-			if ((b->m_flags & b2Body::e_autoSleepFlag) == 0 ||
-				b->m_angularVelocity * b->m_angularVelocity > angTolSqr ||
-				b2Dot(b->m_linearVelocity, b->m_linearVelocity) > linTolSqr)
+			if ((b->m_state->flags & b2Body::e_autoSleepFlag) == 0 ||
+				b->m_state->angularVelocity * b->m_state->angularVelocity > angTolSqr ||
+				b2Dot(b->m_state->linearVelocity, b->m_state->linearVelocity) > linTolSqr)
 			{
 				b->m_sleepTime = 0.0f;
 				minSleepTime = 0.0f;
@@ -381,6 +487,156 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	}
 }
 
+// Joints then contacts for velocities, contacts then joints for positions,
+// as in the serial solver. Within each, constraints are solved in color
+// order rather than island order. Each color is split across the threads
+// with a barrier before the next one. A color shares no body, so the split
+// does not change the result.
+void b2Island::SolveColored(b2ColoredSolve* solve, int32 threadIndex, int32 threadCount)
+{
+	b2ContactSolver* contactSolver = solve->contactSolver;
+	const b2SolverData& data = *solve->solverData;
+	const int32* contactStarts = contactSolver->m_colorStarts;
+	const int32 colorCount = b2ContactSolver::e_maxColors + 1;
+	int32 begin, end;
+
+	for (int32 i = 0; i < solve->iterations; ++i)
+	{
+		if (solve->positions == false)
+		{
+			for (int32 c = 0; c < colorCount; ++c)
+			{
+				if (b2GetColorRange(solve->jointStarts, c, threadIndex, threadCount, &begin, &end))
+				{
+					for (int32 j = begin; j < end; ++j)
+					{
+						solve->joints[j]->SolveVelocityConstraints(data);
+					}
+					solve->barrier->Wait();
+				}
+			}
+
+			for (int32 c = 0; c < contactSolver->m_colorCount; ++c)
+			{
+				if (b2GetColorRange(contactStarts, c, threadIndex, threadCount, &begin, &end))
+				{
+					contactSolver->SolveWideVelocityConstraints(begin, end);
+					solve->barrier->Wait();
+				}
+			}
+			continue;
+		}
+
+		bool okay = true;
+		for (int32 c = 0; c < contactSolver->m_colorCount; ++c)
+		{
+			if (b2GetColorRange(contactStarts, c, threadIndex, threadCount, &begin, &end))
+			{
+				bool contactsOkay = contactSolver->SolveWidePositionConstraints(begin, end);
+				okay = okay && contactsOkay;
+				solve->barrier->Wait();
+			}
+		}
+
+		for (int32 c = 0; c < colorCount; ++c)
+		{
+			if (b2GetColorRange(solve->jointStarts, c, threadIndex, threadCount, &begin, &end))
+			{
+				for (int32 j = begin; j < end; ++j)
+				{
+					bool jointOkay = solve->joints[j]->SolvePositionConstraints(data);
+					okay = okay && jointOkay;
+				}
+				solve->barrier->Wait();
+			}
+		}
+
+		// Exit early if the position errors are small. Every thread reaches
+		// the same decision.
+		bool* slots = solve->okay + (i & 1) * threadCount;
+		slots[threadIndex] = okay;
+		solve->barrier->Wait();
+		bool solved = true;
+		for (int32 t = 0; t < threadCount; ++t)
+		{
+			solved = solved && slots[t];
+		}
+
+		if (solved)
+		{
+			if (threadIndex == 0)
+			{
+				solve->positionSolved = true;
+			}
+			break;
+		}
+	}
+}
+
+// Joints write both bodies, static ones included, so every body counts as
+// a conflict. Gear joints touch four bodies and are left to the serial
+// color.
+void b2Island::ColorJoints(b2Joint** joints, int32* starts) const
+{
+	const int32 overflow = b2ContactSolver::e_maxColors;
+	int32 counts[b2ContactSolver::e_maxColors + 1];
+	memset(counts, 0, sizeof(counts));
+
+	uint64* bodyColors = NULL;
+	int32* colors = NULL;
+	if (m_jointCount > 0)
+	{
+		bodyColors = (uint64*)b2Alloc(m_bodyCount * sizeof(uint64));
+		memset(bodyColors, 0, m_bodyCount * sizeof(uint64));
+		colors = (int32*)b2Alloc(m_jointCount * sizeof(int32));
+	}
+
+	for (int32 i = 0; i < m_jointCount; ++i)
+	{
+		b2Joint* joint = m_joints[i];
+		int32 color = overflow;
+		if (joint->GetType() != e_gearJoint)
+		{
+			int32 indexA = joint->m_bodyA->m_islandIndex;
+			int32 indexB = joint->m_bodyB->m_islandIndex;
+			uint64 used = bodyColors[indexA] | bodyColors[indexB];
+
+			color = 0;
+			while (color < overflow && (used & ((uint64)1 << color)))
+			{
+				++color;
+			}
+
+			if (color < overflow)
+			{
+				bodyColors[indexA] |= (uint64)1 << color;
+				bodyColors[indexB] |= (uint64)1 << color;
+			}
+		}
+
+		colors[i] = color;
+		++counts[color];
+	}
+
+	starts[0] = 0;
+	for (int32 c = 0; c <= overflow; ++c)
+	{
+		starts[c + 1] = starts[c] + counts[c];
+		counts[c] = starts[c];
+	}
+
+	for (int32 i = 0; i < m_jointCount; ++i)
+	{
+		joints[counts[colors[i]]++] = m_joints[i];
+	}
+
+	if (m_jointCount > 0)
+	{
+		b2Free(colors);
+		b2Free(bodyColors);
+	}
+}
+
 void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiIndexB)
 {
 	b2Assert(toiIndexA < m_bodyCount);
@@ -390,10 +646,10 @@ void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiInd
 	for (int32 i = 0; i < m_bodyCount; ++i)
 	{
 		b2Body* b = m_bodies[i];
-		m_positions[i].c = b->m_sweep.c;
-		m_positions[i].a = b->m_sweep.a;
-		m_velocities[i].v = b->m_linearVelocity;
-		m_velocities[i].w = b->m_angularVelocity;
+		m_positions[i].c = b->m_state->sweep.c;
+		m_positions[i].a = b->m_state->sweep.a;
+		m_velocities[i].v = b->m_state->linearVelocity;
+		m_velocities[i].w = b->m_state->angularVelocity;
 	}
 
 	b2ContactSolverDef contactSolverDef;
@@ -449,10 +705,10 @@ void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiInd
 #endif
 
 	// Leap of faith to new safe state.
-	m_bodies[toiIndexA]->m_sweep.c0 = m_positions[toiIndexA].c;
-	m_bodies[toiIndexA]->m_sweep.a0 = m_positions[toiIndexA].a;
-	m_bodies[toiIndexB]->m_sweep.c0 = m_positions[toiIndexB].c;
-	m_bodies[toiIndexB]->m_sweep.a0 = m_positions[toiIndexB].a;
+	m_bodies[toiIndexA]->m_state->sweep.c0 = m_positions[toiIndexA].c;
+	m_bodies[toiIndexA]->m_state->sweep.a0 = m_positions[toiIndexA].a;
+	m_bodies[toiIndexB]->m_state->sweep.c0 = m_positions[toiIndexB].c;
+	m_bodies[toiIndexB]->m_state->sweep.a0 = m_positions[toiIndexB].a;
 
 	// No warm starting is needed for TOI events because warm
 	// starting impulses were applied in the discrete solver.
@@ -503,10 +759,10 @@ void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiInd
 
 		// Sync bodies
 		b2Body* body = m_bodies[i];
-		body->m_sweep.c = c;
-		body->m_sweep.a = a;
-		body->m_linearVelocity = v;
-		body->m_angularVelocity = w;
+		body->m_state->sweep.c = c;
+		body->m_state->sweep.a = a;
+		body->m_state->linearVelocity = v;
+		body->m_state->angularVelocity = w;
 		body->SynchronizeTransform();
 	}
 
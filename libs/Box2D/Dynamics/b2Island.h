@@ -29,6 +29,8 @@ class b2StackAllocator;
 class b2ContactListener;
 struct b2ContactVelocityConstraint;
 struct b2Profile;
+class b2ThreadPool;
+struct b2ColoredSolve;
 
 /// This is an internal class.
 class b2Island
@@ -45,7 +47,12 @@ public:
 		m_jointCount = 0;
 	}
 
-	void Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep);
+	/// With parallel set, contacts and joints are split into colors that
+	/// share no dynamic body and each color is solved across the threads
+	/// of threadPool, or on the calling thread if it is NULL. Both run the
+	/// same schedule, so results do not depend on the thread count.
+	void Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep,
+			   bool parallel, b2ThreadPool* threadPool);
 
 	void SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiIndexB);
 
@@ -71,6 +78,9 @@ public:
 
 	void Report(const b2ContactVelocityConstraint* constraints);
 
+	/// Iterations of a parallel solve, run by every thread of the pool.
+	void SolveColored(b2ColoredSolve* solve, int32 threadIndex, int32 threadCount);
+
 	b2StackAllocator* m_allocator;
 	b2ContactListener* m_listener;
 
@@ -88,6 +98,11 @@ public:
 	int32 m_bodyCapacity;
 	int32 m_contactCapacity;
 	int32 m_jointCapacity;
+
+private:
+	/// Sort the joints by color into joints. Color c owns
+	/// [starts[c], starts[c + 1]), the last color is solved serially.
+	void ColorJoints(b2Joint** joints, int32* starts) const;
 };
 
 #endif
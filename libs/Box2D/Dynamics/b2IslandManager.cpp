@@ -0,0 +1,397 @@
+/*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Dynamics/b2IslandManager.h>
+#include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Dynamics/Contacts/b2Contact.h>
+#include <Box2D/Dynamics/Joints/b2Joint.h>
+#include <Box2D/Common/b2BlockAllocator.h>
+#include <Box2D/Common/b2StackAllocator.h>
+
+b2IslandManager::b2IslandManager()
+{
+	m_islandList = NULL;
+	m_islandCount = 0;
+	m_allocator = NULL;
+}
+
+template <typename T>
+void b2IslandManager::Append(T** head, T** tail, T* item)
+{
+	item->m_islandPrev = *tail;
+	item->m_islandNext = NULL;
+	if (*tail)
+	{
+		(*tail)->m_islandNext = item;
+	}
+	else
+	{
+		*head = item;
+	}
+	*tail = item;
+}
+
+template <typename T>
+void b2IslandManager::Remove(T** head, T** tail, T* item)
+{
+	if (item->m_islandPrev)
+	{
+		item->m_islandPrev->m_islandNext = item->m_islandNext;
+	}
+	else
+	{
+		*head = item->m_islandNext;
+	}
+
+	if (item->m_islandNext)
+	{
+		item->m_islandNext->m_islandPrev = item->m_islandPrev;
+	}
+	else
+	{
+		*tail = item->m_islandPrev;
+	}
+
+	item->m_islandPrev = NULL;
+	item->m_islandNext = NULL;
+}
+
+b2PersistentIsland* b2IslandManager::CreateIsland()
+{
+	void* mem = m_allocator->Allocate(sizeof(b2PersistentIsland));
+	b2PersistentIsland* island = (b2PersistentIsland*)mem;
+	island->bodyList = NULL;
+	island->bodyTail = NULL;
+	island->contactList = NULL;
+	island->contactTail = NULL;
+	island->jointList = NULL;
+	island->jointTail = NULL;
+	island->bodyCount = 0;
+	island->contactCount = 0;
+	island->jointCount = 0;
+	island->constraintRemoveCount = 0;
+	island->awake = false;
+
+	// New islands go to the end so the solve order follows creation.
+	island->next = NULL;
+	island->prev = NULL;
+	if (m_islandList)
+	{
+		b2PersistentIsland* last = m_islandList->prev;
+		last->next = island;
+		island->prev = last;
+	}
+	else
+	{
+		m_islandList = island;
+	}
+	// The head keeps a pointer to the tail.
+	m_islandList->prev = island;
+	++m_islandCount;
+	return island;
+}
+
+void b2IslandManager::DestroyIsland(b2PersistentIsland* island)
+{
+	b2Assert(island->bodyCount == 0);
+	b2Assert(island->contactCount == 0);
+	b2Assert(island->jointCount == 0);
+
+	if (island == m_islandList)
+	{
+		m_islandList = island->next;
+		if (m_islandList)
+		{
+			m_islandList->prev = island->prev;
+		}
+	}
+	else
+	{
+		island->prev->next = island->next;
+		if (island->next)
+		{
+			island->next->prev = island->prev;
+		}
+		else
+		{
+			m_islandList->prev = island->prev;
+		}
+	}
+
+	--m_islandCount;
+	m_allocator->Free(island, sizeof(b2PersistentIsland));
+}
+
+b2PersistentIsland* b2IslandManager::Merge(b2PersistentIsland* a, b2PersistentIsland* b)
+{
+	if (a == b)
+	{
+		return a;
+	}
+
+	b2PersistentIsland* larger = a;
+	b2PersistentIsland* smaller = b;
+	if (a->bodyCount < b->bodyCount)
+	{
+		larger = b;
+		smaller = a;
+	}
+
+	while (smaller->bodyList)
+	{
+		b2Body* body = smaller->bodyList;
+		Remove(&smaller->bodyList, &smaller->bodyTail, body);
+		Append(&larger->bodyList, &larger->bodyTail, body);
+		body->m_persistentIsland = larger;
+	}
+
+	while (smaller->contactList)
+	{
+		b2Contact* contact = smaller->contactList;
+		Remove(&smaller->contactList, &smaller->contactTail, contact);
+		Append(&larger->contactList, &larger->contactTail, contact);
+		contact->m_persistentIsland = larger;
+	}
+
+	while (smaller->jointList)
+	{
+		b2Joint* joint = smaller->jointList;
+		Remove(&smaller->jointList, &smaller->jointTail, joint);
+		Append(&larger->jointList, &larger->jointTail, joint);
+		joint->m_persistentIsland = larger;
+	}
+
+	larger->bodyCount += smaller->bodyCount;
+	larger->contactCount += smaller->contactCount;
+	larger->jointCount += smaller->jointCount;
+	larger->constraintRemoveCount += smaller->constraintRemoveCount;
+	larger->awake = larger->awake || smaller->awake;
+
+	smaller->bodyCount = 0;
+	smaller->contactCount = 0;
+	smaller->jointCount = 0;
+	DestroyIsland(smaller);
+	return larger;
+}
+
+void b2IslandManager::AddBody(b2Body* body)
+{
+	b2Assert(body->m_persistentIsland == NULL);
+	b2Assert(body->GetType() != b2_staticBody && body->IsActive());
+
+	b2PersistentIsland* island = CreateIsland();
+	Append(&island->bodyList, &island->bodyTail, body);
+	island->bodyCount = 1;
+	island->awake = body->IsAwake();
+	body->m_persistentIsland = island;
+
+	RelinkJoints(body);
+}
+
+void b2IslandManager::RemoveBody(b2Body* body)
+{
+	b2PersistentIsland* island = body->m_persistentIsland;
+	if (island == NULL)
+	{
+		return;
+	}
+
+	Remove(&island->bodyList, &island->bodyTail, body);
+	--island->bodyCount;
+	++island->constraintRemoveCount;
+	body->m_persistentIsland = NULL;
+
+	RelinkJoints(body);
+
+	if (island->bodyCount == 0)
+	{
+		DestroyIsland(island);
+	}
+}
+
+void b2IslandManager::RelinkJoints(b2Body* body)
+{
+	for (b2JointEdge* je = body->m_jointList; je; je = je->next)
+	{
+		b2Joint* joint = je->joint;
+		b2PersistentIsland* island = joint->m_persistentIsland;
+		if (island)
+		{
+			Remove(&island->jointList, &island->jointTail, joint);
+			--island->jointCount;
+			joint->m_persistentIsland = NULL;
+		}
+		LinkJoint(joint);
+	}
+}
+
+void b2IslandManager::LinkContact(b2Contact* contact)
+{
+	b2Assert(contact->m_persistentIsland == NULL);
+	b2PersistentIsland* islandA = contact->m_fixtureA->GetBody()->m_persistentIsland;
+	b2PersistentIsland* islandB = contact->m_fixtureB->GetBody()->m_persistentIsland;
+
+	b2PersistentIsland* island = islandA ? islandA : islandB;
+	if (islandA && islandB)
+	{
+		island = Merge(islandA, islandB);
+	}
+
+	if (island == NULL)
+	{
+		return;
+	}
+
+	Append(&island->contactList, &island->contactTail, contact);
+	++island->contactCount;
+	contact->m_persistentIsland = island;
+}
+
+void b2IslandManager::UnlinkContact(b2Contact* contact)
+{
+	b2PersistentIsland* island = contact->m_persistentIsland;
+	if (island == NULL)
+	{
+		return;
+	}
+
+	Remove(&island->contactList, &island->contactTail, contact);
+	--island->contactCount;
+	++island->constraintRemoveCount;
+	contact->m_persistentIsland = NULL;
+}
+
+void b2IslandManager::LinkJoint(b2Joint* joint)
+{
+	b2Assert(joint->m_persistentIsland == NULL);
+	b2PersistentIsland* islandA = joint->m_bodyA->m_persistentIsland;
+	b2PersistentIsland* islandB = joint->m_bodyB->m_persistentIsland;
+
+	b2PersistentIsland* island = islandA ? islandA : islandB;
+	if (islandA && islandB)
+	{
+		island = Merge(islandA, islandB);
+	}
+
+	if (island == NULL)
+	{
+		return;
+	}
+
+	Append(&island->jointList, &island->jointTail, joint);
+	++island->jointCount;
+	joint->m_persistentIsland = island;
+}
+
+void b2IslandManager::UnlinkJoint(b2Joint* joint)
+{
+	b2PersistentIsland* island = joint->m_persistentIsland;
+	if (island == NULL)
+	{
+		return;
+	}
+
+	Remove(&island->jointList, &island->jointTail, joint);
+	--island->jointCount;
+	++island->constraintRemoveCount;
+	joint->m_persistentIsland = NULL;
+}
+
+// Flood fill over the linked contacts and joints. Each piece becomes a new
+// island, in the order of the old body list.
+void b2IslandManager::Split(b2PersistentIsland* island, b2StackAllocator* stackAllocator)
+{
+	b2Assert(island->bodyCount > 0);
+
+	for (b2Body* b = island->bodyList; b; b = b->m_islandNext)
+	{
+		b->m_state->flags &= ~b2Body::e_islandFlag;
+	}
+
+	int32 stackSize = island->bodyCount;
+	b2Body** stack = (b2Body**)stackAllocator->Allocate(stackSize * sizeof(b2Body*));
+
+	while (island->bodyList)
+	{
+		b2PersistentIsland* piece = CreateIsland();
+		piece->awake = island->awake;
+
+		int32 stackCount = 0;
+		stack[stackCount++] = island->bodyList;
+		island->bodyList->m_state->flags |= b2Body::e_islandFlag;
+
+		while (stackCount > 0)
+		{
+			b2Body* b = stack[--stackCount];
+			Remove(&island->bodyList, &island->bodyTail, b);
+			--island->bodyCount;
+			Append(&piece->bodyList, &piece->bodyTail, b);
+			++piece->bodyCount;
+			b->m_persistentIsland = piece;
+
+			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
+			{
+				b2Contact* contact = ce->contact;
+				if (contact->m_persistentIsland != island)
+				{
+					continue;
+				}
+
+				Remove(&island->contactList, &island->contactTail, contact);
+				--island->contactCount;
+				Append(&piece->contactList, &piece->contactTail, contact);
+				++piece->contactCount;
+				contact->m_persistentIsland = piece;
+
+				b2Body* other = ce->other;
+				if (other->m_persistentIsland == island &&
+					(other->m_state->flags & b2Body::e_islandFlag) == 0)
+				{
+					b2Assert(stackCount < stackSize);
+					stack[stackCount++] = other;
+					other->m_state->flags |= b2Body::e_islandFlag;
+				}
+			}
+
+			for (b2JointEdge* je = b->m_jointList; je; je = je->next)
+			{
+				b2Joint* joint = je->joint;
+				if (joint->m_persistentIsland != island)
+				{
+					continue;
+				}
+
+				Remove(&island->jointList, &island->jointTail, joint);
+				--island->jointCount;
+				Append(&piece->jointList, &piece->jointTail, joint);
+				++piece->jointCount;
+				joint->m_persistentIsland = piece;
+
+				b2Body* other = je->other;
+				if (other->m_persistentIsland == island &&
+					(other->m_state->flags & b2Body::e_islandFlag) == 0)
+				{
+					b2Assert(stackCount < stackSize);
+					stack[stackCount++] = other;
+					other->m_state->flags |= b2Body::e_islandFlag;
+				}
+			}
+		}
+	}
+
+	stackAllocator->Free(stack);
+	DestroyIsland(island);
+}
@@ -0,0 +1,108 @@
+/*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_ISLAND_MANAGER_H
+#define B2_ISLAND_MANAGER_H
+
+#include <Box2D/Common/b2Settings.h>
+
+class b2Body;
+class b2Contact;
+class b2Joint;
+class b2BlockAllocator;
+class b2StackAllocator;
+
+/// A set of active non-static bodies together with the touching contacts
+/// and joints between them, kept across steps. Islands merge as soon as a
+/// contact starts touching or a joint is created. They are not split when
+/// constraints go away, so an island may hold several pieces that are no
+/// longer connected; it is split when part of it is ready to sleep.
+struct b2PersistentIsland
+{
+	b2PersistentIsland* prev;
+	b2PersistentIsland* next;
+
+	b2Body* bodyList;
+	b2Body* bodyTail;
+	b2Contact* contactList;
+	b2Contact* contactTail;
+	b2Joint* jointList;
+	b2Joint* jointTail;
+
+	int32 bodyCount;
+	int32 contactCount;
+	int32 jointCount;
+
+	/// Contacts, joints and bodies removed since the island was built.
+	/// Only islands with removals can fall apart.
+	int32 constraintRemoveCount;
+
+	/// Set when any body of the island is woken.
+	bool awake;
+};
+
+/// Delegate of b2World that keeps the persistent islands up to date.
+class b2IslandManager
+{
+public:
+	b2IslandManager();
+
+	/// Put a body that became active and non-static in its own island and
+	/// merge it with the islands of its joints.
+	void AddBody(b2Body* body);
+
+	/// Take a body out of its island when it is destroyed, deactivated or
+	/// made static.
+	void RemoveBody(b2Body* body);
+
+	/// Link a contact that started touching, merging the islands of its
+	/// bodies.
+	void LinkContact(b2Contact* contact);
+
+	/// Unlink a contact that stopped touching or is destroyed.
+	void UnlinkContact(b2Contact* contact);
+
+	/// Link a new joint, merging the islands of its bodies.
+	void LinkJoint(b2Joint* joint);
+
+	/// Unlink a joint that is destroyed.
+	void UnlinkJoint(b2Joint* joint);
+
+	/// Split an island into its connected pieces.
+	void Split(b2PersistentIsland* island, b2StackAllocator* stackAllocator);
+
+	b2PersistentIsland* m_islandList;
+	int32 m_islandCount;
+	b2BlockAllocator* m_allocator;
+
+private:
+	b2PersistentIsland* CreateIsland();
+	void DestroyIsland(b2PersistentIsland* island);
+
+	/// Move the smaller island into the larger one and return the larger.
+	b2PersistentIsland* Merge(b2PersistentIsland* a, b2PersistentIsland* b);
+
+	/// Unlink and link the joints of a body after its island changed.
+	void RelinkJoints(b2Body* body);
+
+	template <typename T>
+	static void Append(T** head, T** tail, T* item);
+
+	template <typename T>
+	static void Remove(T** head, T** tail, T* item);
+};
+
+#endif
@@ -33,6 +33,11 @@ struct b2Profile
 	float32 solvePosition;
 	float32 broadphase;
 	float32 solveTOI;
+	float32 solveParticles;
+	int32 particleIterations;
+	int32 toiCandidates;	// time of impact computations
+	int32 toiEvents;		// sub-steps solved
+	int32 toiMaxBodyEvents;	// most sub-steps for a single body
 };
 
 /// This is an internal structure.
@@ -45,6 +50,7 @@ struct b2TimeStep
 	int32 positionIterations;
 	int32 particleIterations;
 	bool warmStarting;
+	bool wideContactSolver;	// solve contact velocities in colored SIMD batches
 };
 
 /// This is an internal structure.
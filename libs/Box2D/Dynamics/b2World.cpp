@@ -31,10 +31,71 @@
 #include <Box2D/Collision/Shapes/b2ChainShape.h>
 #include <Box2D/Collision/Shapes/b2PolygonShape.h>
 #include <Box2D/Collision/b2TimeOfImpact.h>
+#include <Box2D/Common/b2BatchMath.h>
 #include <Box2D/Common/b2Draw.h>
+#include <Box2D/Common/b2ThreadPool.h>
 #include <Box2D/Common/b2Timer.h>
+#include <algorithm>
 #include <new>
 
+// Initial size of the body state array.
+static const int32 b2_minBodyStateCapacity = 64;
+
+// Fewest active contacts for which the first TOI pass of a step runs on
+// the thread pool.
+static const int32 b2_minParallelTOICount = 64;
+
+// A queued TOI event. Entries go stale when the contact's TOI is computed
+// again and are skipped when popped.
+struct b2TOIEvent
+{
+	float32 alpha;
+	int32 index;
+	b2Contact* contact;
+};
+
+// Orders the queue as a min-heap on alpha. Ties go to the lower active
+// contact index so the order doesn't depend on the heap layout.
+static bool b2TOIEventLater(const b2TOIEvent& a, const b2TOIEvent& b)
+{
+	if (a.alpha != b.alpha)
+	{
+		return a.alpha > b.alpha;
+	}
+	return a.index > b.index;
+}
+
+// Map the TOI of the remaining interval of the sweeps back to the step.
+static float32 b2GetTOI(const b2TOIInput* input, const b2TOIOutput* output)
+{
+	if (output->state != b2TOIOutput::e_touching)
+	{
+		return 1.0f;
+	}
+
+	// Beta is the fraction of the remaining portion of the sweep.
+	float32 alpha0 = input->sweepA.alpha0;
+	return b2Min(alpha0 + (1.0f - alpha0) * output->t, 1.0f);
+}
+
+// Computes the TOIs of a batch of prepared contacts across the threads.
+struct b2TOITask : public b2ThreadTask
+{
+	const b2TOIInput* inputs;
+	b2TOIOutput* outputs;
+	int32 count;
+
+	void Execute(int32 threadIndex, int32 threadCount)
+	{
+		int32 begin = count * threadIndex / threadCount;
+		int32 end = count * (threadIndex + 1) / threadCount;
+		for (int32 i = begin; i < end; ++i)
+		{
+			b2TimeOfImpact(outputs + i, inputs + i);
+		}
+	}
+};
+
 b2World::b2World(const b2Vec2& gravity)
 {
 	Init(gravity);
@@ -65,6 +126,15 @@ b2World::~b2World()
 		DestroyParticleSystem(m_particleSystemList);
 	}
 
+	SetThreadCount(1);
+
+	if (m_bodyStates)
+	{
+		m_blockAllocator.Free(m_bodyStates, sizeof(b2BodyState) * m_bodyStateCapacity);
+	}
+	b2Free(m_awakeBodies);
+	b2Free(m_toiQueue);
+
 	// Even though the block allocator frees them for us, for safety,
 	// we should ensure that all buffers have been freed.
 	b2Assert(m_blockAllocator.GetNumGiantAllocations() == 0);
@@ -98,8 +168,9 @@ b2Body* b2World::CreateBody(const b2BodyDef* def)
 		return NULL;
 	}
 
+	b2BodyState* state = CreateBodyState();
 	void* mem = m_blockAllocator.Allocate(sizeof(b2Body));
-	b2Body* b = new (mem) b2Body(def, this);
+	b2Body* b = new (mem) b2Body(def, this, state);
 
 	// Add to world doubly linked list.
 	b->m_prev = NULL;
@@ -111,6 +182,16 @@ b2Body* b2World::CreateBody(const b2BodyDef* def)
 	m_bodyList = b;
 	++m_bodyCount;
 
+	if (b->m_type != b2_staticBody && b->IsActive())
+	{
+		m_islandManager.AddBody(b);
+	}
+
+	if (b->IsAwake())
+	{
+		AddAwakeBody(b);
+	}
+
 	return b;
 }
 
@@ -141,16 +222,34 @@ void b2World::DestroyBody(b2Body* b)
 	}
 	b->m_jointList = NULL;
 
-	// Delete the attached contacts.
+	// Delete the attached contacts. Keyed bodies leave their impulses
+	// behind for a re-created body.
 	b2ContactEdge* ce = b->m_contactList;
 	while (ce)
 	{
 		b2ContactEdge* ce0 = ce;
 		ce = ce->next;
+		if (b->m_cacheKey != 0)
+		{
+			m_contactManager.Cache(ce0->contact);
+		}
 		m_contactManager.Destroy(ce0->contact);
 	}
 	b->m_contactList = NULL;
 
+	// Entries matched by address would go to the next body allocated here.
+	if (b->m_cacheKey == 0 && m_contactManager.m_contactCacheCount > 0)
+	{
+		m_contactManager.Uncache(b);
+	}
+
+	// The particle systems read last step's body contacts before they
+	// are rebuilt.
+	for (b2ParticleSystem* p = m_particleSystemList; p; p = p->GetNext())
+	{
+		p->DestroyBodyContacts(b);
+	}
+
 	// Delete the attached fixtures. This destroys broad-phase proxies.
 	b2Fixture* f = b->m_fixtureList;
 	while (f)
@@ -174,6 +273,9 @@ void b2World::DestroyBody(b2Body* b)
 	b->m_fixtureList = NULL;
 	b->m_fixtureCount = 0;
 
+	m_islandManager.RemoveBody(b);
+	RemoveAwakeBody(b);
+
 	// Remove world body list.
 	if (b->m_prev)
 	{
@@ -190,11 +292,217 @@ void b2World::DestroyBody(b2Body* b)
 		m_bodyList = b->m_next;
 	}
 
+	DestroyBodyState(b->m_state);
 	--m_bodyCount;
 	b->~b2Body();
 	m_blockAllocator.Free(b, sizeof(b2Body));
 }
 
+b2Body* b2World::GetBody(int32 index)
+{
+	b2Assert(0 <= index && index < m_bodyCount);
+	return m_bodyStates[index].body;
+}
+
+const b2Body* b2World::GetBody(int32 index) const
+{
+	b2Assert(0 <= index && index < m_bodyCount);
+	return m_bodyStates[index].body;
+}
+
+void b2World::AddAwakeBody(b2Body* b)
+{
+	if (b->m_type == b2_staticBody)
+	{
+		return;
+	}
+
+	if (b->m_awakeIndex == -1)
+	{
+		if (m_awakeBodyCount == m_awakeBodyCapacity)
+		{
+			b2Body** oldBuffer = m_awakeBodies;
+			m_awakeBodyCapacity *= 2;
+			m_awakeBodies = (b2Body**)b2Alloc(m_awakeBodyCapacity * sizeof(b2Body*));
+			memcpy(m_awakeBodies, oldBuffer, m_awakeBodyCount * sizeof(b2Body*));
+			b2Free(oldBuffer);
+		}
+
+		b->m_awakeIndex = m_awakeBodyCount;
+		m_awakeBodies[m_awakeBodyCount++] = b;
+	}
+
+	// Contacts of an awake body are always active.
+	for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
+	{
+		m_contactManager.AddActiveContact(ce->contact);
+	}
+}
+
+void b2World::RemoveAwakeBody(b2Body* b)
+{
+	int32 index = b->m_awakeIndex;
+	if (index == -1)
+	{
+		return;
+	}
+
+	b2Body* last = m_awakeBodies[--m_awakeBodyCount];
+	m_awakeBodies[index] = last;
+	last->m_awakeIndex = index;
+	b->m_awakeIndex = -1;
+}
+
+void b2World::ResetTOIBody(b2Body* b)
+{
+	if (b->m_toiStamp != m_toiStamp)
+	{
+		b->m_toiStamp = m_toiStamp;
+		b->m_toiEventCount = 0;
+		b->m_state->flags &= ~b2Body::e_islandFlag;
+		b->m_state->sweep.alpha0 = 0.0f;
+	}
+}
+
+bool b2World::PrepareTOI(b2Contact* c, b2TOIInput* input)
+{
+	b2Fixture* fA = c->GetFixtureA();
+	b2Fixture* fB = c->GetFixtureB();
+
+	// Is there a sensor?
+	if (fA->IsSensor() || fB->IsSensor())
+	{
+		return false;
+	}
+
+	b2Body* bA = fA->GetBody();
+	b2Body* bB = fB->GetBody();
+
+	b2BodyType typeA = bA->m_type;
+	b2BodyType typeB = bB->m_type;
+	b2Assert(typeA == b2_dynamicBody || typeB == b2_dynamicBody);
+
+	bool activeA = bA->IsAwake() && typeA != b2_staticBody;
+	bool activeB = bB->IsAwake() && typeB != b2_staticBody;
+
+	// Is at least one body active (awake and dynamic or kinematic)?
+	if (activeA == false && activeB == false)
+	{
+		return false;
+	}
+
+	bool collideA = bA->IsBullet() || typeA != b2_dynamicBody;
+	bool collideB = bB->IsBullet() || typeB != b2_dynamicBody;
+
+	// Are these two non-bullet dynamic bodies?
+	if (collideA == false && collideB == false)
+	{
+		return false;
+	}
+
+	ResetTOIBody(bA);
+	ResetTOIBody(bB);
+
+	// Put the sweeps onto the same time interval.
+	if (bA->m_state->sweep.alpha0 < bB->m_state->sweep.alpha0)
+	{
+		bA->m_state->sweep.Advance(bB->m_state->sweep.alpha0);
+	}
+	else if (bB->m_state->sweep.alpha0 < bA->m_state->sweep.alpha0)
+	{
+		bB->m_state->sweep.Advance(bA->m_state->sweep.alpha0);
+	}
+
+	b2Assert(bA->m_state->sweep.alpha0 < 1.0f);
+
+	// Compute the time of impact in interval [0, minTOI]
+	input->proxyA.Set(fA->GetShape(), c->GetChildIndexA());
+	input->proxyB.Set(fB->GetShape(), c->GetChildIndexB());
+	input->sweepA = bA->m_state->sweep;
+	input->sweepB = bB->m_state->sweep;
+	input->tMax = 1.0f;
+	return true;
+}
+
+void b2World::QueueTOI(b2Contact* c)
+{
+	// Is this contact disabled? Prevent excessive sub-stepping.
+	if (c->IsEnabled() == false || c->m_toiCount > b2_maxSubSteps)
+	{
+		return;
+	}
+
+	if ((c->m_flags & b2Contact::e_toiFlag) == 0)
+	{
+		b2TOIInput input;
+		if (PrepareTOI(c, &input) == false)
+		{
+			return;
+		}
+
+		b2TOIOutput output;
+		b2TimeOfImpact(&output, &input);
+		c->m_toi = b2GetTOI(&input, &output);
+		c->m_flags |= b2Contact::e_toiFlag;
+		++m_profile.toiCandidates;
+	}
+
+	PushTOI(c);
+}
+
+void b2World::PushTOI(b2Contact* c)
+{
+	if (m_toiQueueCount == m_toiQueueCapacity)
+	{
+		b2TOIEvent* oldBuffer = m_toiQueue;
+		m_toiQueueCapacity *= 2;
+		m_toiQueue = (b2TOIEvent*)b2Alloc(m_toiQueueCapacity * sizeof(b2TOIEvent));
+		memcpy(m_toiQueue, oldBuffer, m_toiQueueCount * sizeof(b2TOIEvent));
+		b2Free(oldBuffer);
+	}
+
+	b2TOIEvent* event = m_toiQueue + m_toiQueueCount++;
+	event->alpha = c->m_toi;
+	event->index = c->m_activeIndex;
+	event->contact = c;
+	std::push_heap(m_toiQueue, m_toiQueue + m_toiQueueCount, b2TOIEventLater);
+}
+
+// Grow the state array by doubling and point the bodies at their new state.
+b2BodyState* b2World::CreateBodyState()
+{
+	if (m_bodyCount == m_bodyStateCapacity)
+	{
+		int32 capacity = m_bodyStateCapacity ? 2 * m_bodyStateCapacity : b2_minBodyStateCapacity;
+		b2BodyState* states = (b2BodyState*)m_blockAllocator.Allocate(sizeof(b2BodyState) * capacity);
+		if (m_bodyStates)
+		{
+			memcpy(states, m_bodyStates, sizeof(b2BodyState) * m_bodyCount);
+			m_blockAllocator.Free(m_bodyStates, sizeof(b2BodyState) * m_bodyStateCapacity);
+		}
+		m_bodyStates = states;
+		m_bodyStateCapacity = capacity;
+
+		for (int32 i = 0; i < m_bodyCount; ++i)
+		{
+			m_bodyStates[i].body->m_state = m_bodyStates + i;
+		}
+	}
+
+	return m_bodyStates + m_bodyCount;
+}
+
+// Move the last state into the hole so the array stays dense.
+void b2World::DestroyBodyState(b2BodyState* state)
+{
+	b2BodyState* last = m_bodyStates + m_bodyCount - 1;
+	if (state != last)
+	{
+		*state = *last;
+		state->body->m_state = state;
+	}
+}
+
 b2Joint* b2World::CreateJoint(const b2JointDef* def)
 {
 	b2Assert(IsLocked() == false);
@@ -230,6 +538,8 @@ b2Joint* b2World::CreateJoint(const b2JointDef* def)
 	if (j->m_bodyB->m_jointList) j->m_bodyB->m_jointList->prev = &j->m_edgeB;
 	j->m_bodyB->m_jointList = &j->m_edgeB;
 
+	m_islandManager.LinkJoint(j);
+
 	b2Body* bodyA = def->bodyA;
 	b2Body* bodyB = def->bodyB;
 
@@ -284,6 +594,7 @@ void b2World::DestroyJoint(b2Joint* j)
 	// Disconnect from island graph.
 	b2Body* bodyA = j->m_bodyA;
 	b2Body* bodyB = j->m_bodyB;
+	m_islandManager.UnlinkJoint(j);
 
 	// Wake up connected bodies.
 	bodyA->SetAwake(true);
@@ -413,9 +724,9 @@ void b2World::SetAllowSleeping(bool flag)
 	m_allowSleep = flag;
 	if (m_allowSleep == false)
 	{
-		for (b2Body* b = m_bodyList; b; b = b->m_next)
+		for (int32 i = 0; i < m_bodyCount; ++i)
 		{
-			b->SetAwake(true);
+			m_bodyStates[i].body->SetAwake(true);
 		}
 	}
 }
@@ -433,9 +744,27 @@ void b2World::Init(const b2Vec2& gravity)
 	m_bodyCount = 0;
 	m_jointCount = 0;
 
+	m_bodyStates = NULL;
+	m_bodyStateCapacity = 0;
+
+	m_awakeBodyCapacity = 16;
+	m_awakeBodyCount = 0;
+	m_awakeBodies = (b2Body**)b2Alloc(m_awakeBodyCapacity * sizeof(b2Body*));
+	m_toiStamp = 0;
+
+	m_toiQueueCapacity = 16;
+	m_toiQueueCount = 0;
+	m_toiQueue = (b2TOIEvent*)b2Alloc(m_toiQueueCapacity * sizeof(b2TOIEvent));
+
 	m_warmStarting = true;
 	m_continuousPhysics = true;
 	m_subStepping = false;
+	m_wideContactSolver = false;
+	m_speculativeContacts = false;
+	m_speculativeTimeStep = 0.0f;
+
+	m_threadPool = NULL;
+	m_parallelIslandThreshold = 256;
 
 	m_stepComplete = true;
 
@@ -447,6 +776,7 @@ void b2World::Init(const b2Vec2& gravity)
 	m_inv_dt0 = 0.0f;
 
 	m_contactManager.m_allocator = &m_blockAllocator;
+	m_islandManager.m_allocator = &m_blockAllocator;
 
 	m_liquidFunVersion = &b2_liquidFunVersion;
 	m_liquidFunVersionString = b2_liquidFunVersionString;
@@ -454,200 +784,198 @@ void b2World::Init(const b2Vec2& gravity)
 	memset(&m_profile, 0, sizeof(b2Profile));
 }
 
-// Find islands, integrate and solve constraints, solve position constraints
+// Solve the awake persistent islands. Pieces of an island that are ready
+// to sleep but held awake by the rest are split off at the end of the step.
 void b2World::Solve(const b2TimeStep& step)
 {
-	// update previous transforms
-	for (b2Body* b = m_bodyList; b; b = b->m_next)
-	{
-		b->m_xf0 = b->m_xf;
+	// Update previous transforms and drop the bodies that went to sleep
+	// or became static. Those keep xf0 equal to xf until they move again.
+	int32 awakeIndex = 0;
+	while (awakeIndex < m_awakeBodyCount)
+	{
+		b2Body* b = m_awakeBodies[awakeIndex];
+		b->m_state->xf0 = b->m_state->xf;
+		if (b->IsAwake() == false || b->m_type == b2_staticBody)
+		{
+			RemoveAwakeBody(b);
+			continue;
+		}
+		++awakeIndex;
 	}
 
 	m_profile.solveInit = 0.0f;
 	m_profile.solveVelocity = 0.0f;
 	m_profile.solvePosition = 0.0f;
 
-	// Size the island for the worst case.
-	b2Island island(m_bodyCount,
-					m_contactManager.m_contactCount,
-					m_jointCount,
+	// Size the solver island for the largest awake island. Static bodies
+	// are only reached through contacts and joints.
+	int32 bodyCapacity = 0;
+	int32 contactCapacity = 0;
+	int32 jointCapacity = 0;
+	for (b2PersistentIsland* pi = m_islandManager.m_islandList; pi; pi = pi->next)
+	{
+		if (pi->awake)
+		{
+			int32 bodies = pi->bodyCount + pi->contactCount + pi->jointCount;
+			bodyCapacity = b2Max(bodyCapacity, b2Min(bodies, m_bodyCount));
+			contactCapacity = b2Max(contactCapacity, pi->contactCount);
+			jointCapacity = b2Max(jointCapacity, pi->jointCount);
+		}
+	}
+
+	b2Island island(bodyCapacity,
+					contactCapacity,
+					jointCapacity,
 					&m_stackAllocator,
 					m_contactManager.m_contactListener);
 
-	// Clear all the island flags.
-	for (b2Body* b = m_bodyList; b; b = b->m_next)
-	{
-		b->m_flags &= ~b2Body::e_islandFlag;
-	}
-	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
-	{
-		c->m_flags &= ~b2Contact::e_islandFlag;
-	}
-	for (b2Joint* j = m_jointList; j; j = j->m_next)
-	{
-		j->m_islandFlag = false;
-	}
+	float32 synchronizeTime = 0.0f;
+	b2PersistentIsland* splitCandidate = NULL;
+	float32 splitSleepTime = 0.0f;
 
-	// Build and simulate all awake islands.
-	int32 stackSize = m_bodyCount;
-	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
-	for (b2Body* seed = m_bodyList; seed; seed = seed->m_next)
+	for (b2PersistentIsland* pi = m_islandManager.m_islandList; pi; pi = pi->next)
 	{
-		if (seed->m_flags & b2Body::e_islandFlag)
+		if (pi->awake == false)
 		{
 			continue;
 		}
 
-		if (seed->IsAwake() == false || seed->IsActive() == false)
+		// The island may have been put to sleep body by body.
+		bool awake = false;
+		for (b2Body* b = pi->bodyList; b; b = b->m_islandNext)
 		{
-			continue;
+			if (b->IsAwake())
+			{
+				awake = true;
+				break;
+			}
 		}
 
-		// The seed can be dynamic or kinematic.
-		if (seed->GetType() == b2_staticBody)
+		if (awake == false)
 		{
+			pi->awake = false;
 			continue;
 		}
 
-		// Reset island and stack.
 		island.Clear();
-		int32 stackCount = 0;
-		stack[stackCount++] = seed;
-		seed->m_flags |= b2Body::e_islandFlag;
-
-		// Perform a depth first search (DFS) on the constraint graph.
-		while (stackCount > 0)
+		for (b2Body* b = pi->bodyList; b; b = b->m_islandNext)
 		{
-			// Grab the next body off the stack and add it to the island.
-			b2Body* b = stack[--stackCount];
 			b2Assert(b->IsActive() == true);
 			island.Add(b);
 
 			// Make sure the body is awake.
 			b->SetAwake(true);
+		}
 
-			// To keep islands as small as possible, we don't
-			// propagate islands across static bodies.
-			if (b->GetType() == b2_staticBody)
+		for (b2Contact* contact = pi->contactList; contact; contact = contact->m_islandNext)
+		{
+			// Is this contact solid and touching?
+			if (contact->IsEnabled() == false ||
+				contact->IsTouching() == false)
 			{
 				continue;
 			}
 
-			// Search all contacts connected to this body.
-			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
+			// Skip sensors.
+			bool sensorA = contact->m_fixtureA->m_isSensor;
+			bool sensorB = contact->m_fixtureB->m_isSensor;
+			if (sensorA || sensorB)
 			{
-				b2Contact* contact = ce->contact;
-
-				// Has this contact already been added to an island?
-				if (contact->m_flags & b2Contact::e_islandFlag)
-				{
-					continue;
-				}
-
-				// Is this contact solid and touching?
-				if (contact->IsEnabled() == false ||
-					contact->IsTouching() == false)
-				{
-					continue;
-				}
-
-				// Skip sensors.
-				bool sensorA = contact->m_fixtureA->m_isSensor;
-				bool sensorB = contact->m_fixtureB->m_isSensor;
-				if (sensorA || sensorB)
-				{
-					continue;
-				}
-
-				island.Add(contact);
-				contact->m_flags |= b2Contact::e_islandFlag;
+				continue;
+			}
 
-				b2Body* other = ce->other;
+			island.Add(contact);
 
-				// Was the other body already added to this island?
-				if (other->m_flags & b2Body::e_islandFlag)
+			// Static bodies are added once per island.
+			b2Body* bodies[2] = { contact->m_fixtureA->m_body, contact->m_fixtureB->m_body };
+			for (int32 i = 0; i < 2; ++i)
+			{
+				b2Body* other = bodies[i];
+				b2Assert(other->m_persistentIsland == NULL || other->m_persistentIsland == pi);
+				if (other->m_persistentIsland == NULL &&
+					(other->m_state->flags & b2Body::e_islandFlag) == 0)
 				{
-					continue;
+					island.Add(other);
+					other->m_state->flags |= b2Body::e_islandFlag;
 				}
-
-				b2Assert(stackCount < stackSize);
-				stack[stackCount++] = other;
-				other->m_flags |= b2Body::e_islandFlag;
 			}
+		}
 
-			// Search all joints connect to this body.
-			for (b2JointEdge* je = b->m_jointList; je; je = je->next)
+		for (b2Joint* joint = pi->jointList; joint; joint = joint->m_islandNext)
+		{
+			// Don't simulate joints connected to inactive bodies.
+			b2Body* bodies[2] = { joint->m_bodyA, joint->m_bodyB };
+			if (bodies[0]->IsActive() == false || bodies[1]->IsActive() == false)
 			{
-				if (je->joint->m_islandFlag == true)
-				{
-					continue;
-				}
-
-				b2Body* other = je->other;
-
-				// Don't simulate joints connected to inactive bodies.
-				if (other->IsActive() == false)
-				{
-					continue;
-				}
+				continue;
+			}
 
-				island.Add(je->joint);
-				je->joint->m_islandFlag = true;
+			island.Add(joint);
 
-				if (other->m_flags & b2Body::e_islandFlag)
+			for (int32 i = 0; i < 2; ++i)
+			{
+				b2Body* other = bodies[i];
+				b2Assert(other->m_persistentIsland == NULL || other->m_persistentIsland == pi);
+				if (other->m_persistentIsland == NULL &&
+					(other->m_state->flags & b2Body::e_islandFlag) == 0)
 				{
-					continue;
+					island.Add(other);
+					other->m_state->flags |= b2Body::e_islandFlag;
 				}
-
-				b2Assert(stackCount < stackSize);
-				stack[stackCount++] = other;
-				other->m_flags |= b2Body::e_islandFlag;
 			}
 		}
 
 		b2Profile profile;
-		island.Solve(&profile, step, m_gravity, m_allowSleep);
+		bool parallel = (m_threadPool || m_wideContactSolver) &&
+			island.m_bodyCount >= m_parallelIslandThreshold;
+		island.Solve(&profile, step, m_gravity, m_allowSleep, parallel, parallel ? m_threadPool : NULL);
 		m_profile.solveInit += profile.solveInit;
 		m_profile.solveVelocity += profile.solveVelocity;
 		m_profile.solvePosition += profile.solvePosition;
 
 		// Post solve cleanup.
+		b2Timer timer;
+		float32 maxSleepTime = 0.0f;
 		for (int32 i = 0; i < island.m_bodyCount; ++i)
 		{
-			// Allow static bodies to participate in other islands.
 			b2Body* b = island.m_bodies[i];
 			if (b->GetType() == b2_staticBody)
 			{
-				b->m_flags &= ~b2Body::e_islandFlag;
-			}
-		}
-	}
-
-	m_stackAllocator.Free(stack);
-
-	{
-		b2Timer timer;
-		// Synchronize fixtures, check for out of range bodies.
-		for (b2Body* b = m_bodyList; b; b = b->GetNext())
-		{
-			// If a body was not in an island then it did not move.
-			if ((b->m_flags & b2Body::e_islandFlag) == 0)
-			{
+				// Allow static bodies to participate in other islands.
+				b->m_state->flags &= ~b2Body::e_islandFlag;
 				continue;
 			}
 
-			if (b->GetType() == b2_staticBody)
-			{
-				continue;
-			}
+			maxSleepTime = b2Max(maxSleepTime, b->m_sleepTime);
 
 			// Update fixtures (for broad-phase).
 			b->SynchronizeFixtures();
 		}
+		synchronizeTime += timer.GetMilliseconds();
 
+		if (pi->bodyList->IsAwake() == false)
+		{
+			pi->awake = false;
+		}
+		else if (pi->constraintRemoveCount > 0 &&
+				 maxSleepTime >= b2_timeToSleep && maxSleepTime > splitSleepTime)
+		{
+			// Part of the island wants to sleep, it may be a separate piece.
+			splitCandidate = pi;
+			splitSleepTime = maxSleepTime;
+		}
+	}
+
+	if (splitCandidate)
+	{
+		m_islandManager.Split(splitCandidate, &m_stackAllocator);
+	}
+
+	{
+		b2Timer timer;
 		// Look for new contacts.
 		m_contactManager.FindNewContacts();
-		m_profile.broadphase = timer.GetMilliseconds();
+		m_profile.broadphase = synchronizeTime + timer.GetMilliseconds();
 	}
 }
 
@@ -658,14 +986,16 @@ void b2World::SolveTOI(const b2TimeStep& step)
 
 	if (m_stepComplete)
 	{
-		for (b2Body* b = m_bodyList; b; b = b->m_next)
-		{
-			b->m_flags &= ~b2Body::e_islandFlag;
-			b->m_sweep.alpha0 = 0.0f;
-		}
+		// Bodies are reset lazily by ResetTOIBody. Inactive contacts are
+		// reset when they rejoin the active set.
+		++m_toiStamp;
+		m_profile.toiCandidates = 0;
+		m_profile.toiEvents = 0;
+		m_profile.toiMaxBodyEvents = 0;
 
-		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+		for (int32 i = 0; i < m_contactManager.m_activeContactCount; ++i)
 		{
+			b2Contact* c = m_contactManager.m_activeContacts[i];
 			// Invalidate TOI
 			c->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
 			c->m_toiCount = 0;
@@ -673,121 +1003,90 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		}
 	}
 
-	// Find TOI events and solve them.
-	for (;;)
+	// Queue the TOI of every candidate. Later only the contacts of bodies
+	// moved by a sub-step and new contacts are computed again.
+	m_toiQueueCount = 0;
+	int32 scanCount = 0;
+	if (m_stepComplete && m_threadPool &&
+		m_contactManager.m_activeContactCount >= b2_minParallelTOICount)
 	{
-		// Find the first TOI.
-		b2Contact* minContact = NULL;
-		float32 minAlpha = 1.0f;
+		// No body has been advanced yet this step, so the sweeps need no
+		// alignment and the TOIs are independent.
+		int32 count = m_contactManager.m_activeContactCount;
+		b2Contact** contacts = (b2Contact**)m_stackAllocator.Allocate(count * sizeof(b2Contact*));
+		b2TOIInput* inputs = (b2TOIInput*)m_stackAllocator.Allocate(count * sizeof(b2TOIInput));
+		b2TOIOutput* outputs = (b2TOIOutput*)m_stackAllocator.Allocate(count * sizeof(b2TOIOutput));
 
-		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+		int32 candidateCount = 0;
+		for (int32 i = 0; i < count; ++i)
 		{
-			// Is this contact disabled?
-			if (c->IsEnabled() == false)
-			{
-				continue;
-			}
-
-			// Prevent excessive sub-stepping.
-			if (c->m_toiCount > b2_maxSubSteps)
-			{
-				continue;
-			}
-
-			float32 alpha = 1.0f;
-			if (c->m_flags & b2Contact::e_toiFlag)
+			b2Contact* c = m_contactManager.m_activeContacts[i];
+			if (c->IsEnabled() && PrepareTOI(c, inputs + candidateCount))
 			{
-				// This contact has a valid cached TOI.
-				alpha = c->m_toi;
+				contacts[candidateCount++] = c;
 			}
-			else
-			{
-				b2Fixture* fA = c->GetFixtureA();
-				b2Fixture* fB = c->GetFixtureB();
-
-				// Is there a sensor?
-				if (fA->IsSensor() || fB->IsSensor())
-				{
-					continue;
-				}
-
-				b2Body* bA = fA->GetBody();
-				b2Body* bB = fB->GetBody();
-
-				b2BodyType typeA = bA->m_type;
-				b2BodyType typeB = bB->m_type;
-				b2Assert(typeA == b2_dynamicBody || typeB == b2_dynamicBody);
-
-				bool activeA = bA->IsAwake() && typeA != b2_staticBody;
-				bool activeB = bB->IsAwake() && typeB != b2_staticBody;
-
-				// Is at least one body active (awake and dynamic or kinematic)?
-				if (activeA == false && activeB == false)
-				{
-					continue;
-				}
-
-				bool collideA = bA->IsBullet() || typeA != b2_dynamicBody;
-				bool collideB = bB->IsBullet() || typeB != b2_dynamicBody;
-
-				// Are these two non-bullet dynamic bodies?
-				if (collideA == false && collideB == false)
-				{
-					continue;
-				}
-
-				// Compute the TOI for this contact.
-				// Put the sweeps onto the same time interval.
-				float32 alpha0 = bA->m_sweep.alpha0;
-
-				if (bA->m_sweep.alpha0 < bB->m_sweep.alpha0)
-				{
-					alpha0 = bB->m_sweep.alpha0;
-					bA->m_sweep.Advance(alpha0);
-				}
-				else if (bB->m_sweep.alpha0 < bA->m_sweep.alpha0)
-				{
-					alpha0 = bA->m_sweep.alpha0;
-					bB->m_sweep.Advance(alpha0);
-				}
-
-				b2Assert(alpha0 < 1.0f);
-
-				int32 indexA = c->GetChildIndexA();
-				int32 indexB = c->GetChildIndexB();
+		}
 
-				// Compute the time of impact in interval [0, minTOI]
-				b2TOIInput input;
-				input.proxyA.Set(fA->GetShape(), indexA);
-				input.proxyB.Set(fB->GetShape(), indexB);
-				input.sweepA = bA->m_sweep;
-				input.sweepB = bB->m_sweep;
-				input.tMax = 1.0f;
+		b2TOITask task;
+		task.inputs = inputs;
+		task.outputs = outputs;
+		task.count = candidateCount;
+		m_threadPool->Run(&task);
 
-				b2TOIOutput output;
-				b2TimeOfImpact(&output, &input);
+		for (int32 i = 0; i < candidateCount; ++i)
+		{
+			b2Contact* c = contacts[i];
+			c->m_toi = b2GetTOI(inputs + i, outputs + i);
+			c->m_flags |= b2Contact::e_toiFlag;
+			PushTOI(c);
+		}
+		m_profile.toiCandidates += candidateCount;
 
-				// Beta is the fraction of the remaining portion of the .
-				float32 beta = output.t;
-				if (output.state == b2TOIOutput::e_touching)
-				{
-					alpha = b2Min(alpha0 + (1.0f - alpha0) * beta, 1.0f);
-				}
-				else
-				{
-					alpha = 1.0f;
-				}
+		m_stackAllocator.Free(outputs);
+		m_stackAllocator.Free(inputs);
+		m_stackAllocator.Free(contacts);
+		scanCount = count;
+	}
+	else
+	{
+		for (; scanCount < m_contactManager.m_activeContactCount; ++scanCount)
+		{
+			QueueTOI(m_contactManager.m_activeContacts[scanCount]);
+		}
+	}
 
-				c->m_toi = alpha;
-				c->m_flags |= b2Contact::e_toiFlag;
+	// Find TOI events and solve them.
+	for (;;)
+	{
+		// Contacts created by the last sub-step.
+		for (; scanCount < m_contactManager.m_activeContactCount; ++scanCount)
+		{
+			b2Contact* c = m_contactManager.m_activeContacts[scanCount];
+			if ((c->m_flags & b2Contact::e_toiFlag) == 0)
+			{
+				QueueTOI(c);
 			}
+		}
+
+		// Find the first TOI, skipping entries that went stale.
+		b2Contact* minContact = NULL;
+		float32 minAlpha = 1.0f;
+		while (m_toiQueueCount > 0)
+		{
+			b2TOIEvent event = m_toiQueue[0];
+			std::pop_heap(m_toiQueue, m_toiQueue + m_toiQueueCount, b2TOIEventLater);
+			--m_toiQueueCount;
 
-			if (alpha < minAlpha)
+			b2Contact* c = event.contact;
+			if ((c->m_flags & b2Contact::e_toiFlag) == 0 || c->m_toi != event.alpha ||
+				c->IsEnabled() == false || c->m_toiCount > b2_maxSubSteps)
 			{
-				// This is the minimum TOI found so far.
-				minContact = c;
-				minAlpha = alpha;
+				continue;
 			}
+
+			minContact = c;
+			minAlpha = event.alpha;
+			break;
 		}
 
 		if (minContact == NULL || 1.0f - 10.0f * b2_epsilon < minAlpha)
@@ -803,8 +1102,8 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		b2Body* bA = fA->GetBody();
 		b2Body* bB = fB->GetBody();
 
-		b2Sweep backup1 = bA->m_sweep;
-		b2Sweep backup2 = bB->m_sweep;
+		b2Sweep backup1 = bA->m_state->sweep;
+		b2Sweep backup2 = bB->m_state->sweep;
 
 		bA->Advance(minAlpha);
 		bB->Advance(minAlpha);
@@ -819,8 +1118,8 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		{
 			// Restore the sweeps.
 			minContact->SetEnabled(false);
-			bA->m_sweep = backup1;
-			bB->m_sweep = backup2;
+			bA->m_state->sweep = backup1;
+			bB->m_state->sweep = backup2;
 			bA->SynchronizeTransform();
 			bB->SynchronizeTransform();
 			continue;
@@ -829,14 +1128,25 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		bA->SetAwake(true);
 		bB->SetAwake(true);
 
+		++m_profile.toiEvents;
+		b2Body* eventBodies[2] = {bA, bB};
+		for (int32 i = 0; i < 2; ++i)
+		{
+			if (eventBodies[i]->m_type != b2_staticBody)
+			{
+				int32 eventCount = ++eventBodies[i]->m_toiEventCount;
+				m_profile.toiMaxBodyEvents = b2Max(m_profile.toiMaxBodyEvents, eventCount);
+			}
+		}
+
 		// Build the island
 		island.Clear();
 		island.Add(bA);
 		island.Add(bB);
 		island.Add(minContact);
 
-		bA->m_flags |= b2Body::e_islandFlag;
-		bB->m_flags |= b2Body::e_islandFlag;
+		bA->m_state->flags |= b2Body::e_islandFlag;
+		bB->m_state->flags |= b2Body::e_islandFlag;
 		minContact->m_flags |= b2Contact::e_islandFlag;
 
 		// Get contacts on bodyA and bodyB.
@@ -883,8 +1193,9 @@ void b2World::SolveTOI(const b2TimeStep& step)
 					}
 
 					// Tentatively advance the body to the TOI.
-					b2Sweep backup = other->m_sweep;
-					if ((other->m_flags & b2Body::e_islandFlag) == 0)
+					ResetTOIBody(other);
+					b2Sweep backup = other->m_state->sweep;
+					if ((other->m_state->flags & b2Body::e_islandFlag) == 0)
 					{
 						other->Advance(minAlpha);
 					}
@@ -895,7 +1206,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 					// Was the contact disabled by the user?
 					if (contact->IsEnabled() == false)
 					{
-						other->m_sweep = backup;
+						other->m_state->sweep = backup;
 						other->SynchronizeTransform();
 						continue;
 					}
@@ -903,7 +1214,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 					// Are there contact points?
 					if (contact->IsTouching() == false)
 					{
-						other->m_sweep = backup;
+						other->m_state->sweep = backup;
 						other->SynchronizeTransform();
 						continue;
 					}
@@ -913,13 +1224,13 @@ void b2World::SolveTOI(const b2TimeStep& step)
 					island.Add(contact);
 
 					// Has the other body already been added to the island?
-					if (other->m_flags & b2Body::e_islandFlag)
+					if (other->m_state->flags & b2Body::e_islandFlag)
 					{
 						continue;
 					}
 
 					// Add the other body to the island.
-					other->m_flags |= b2Body::e_islandFlag;
+					other->m_state->flags |= b2Body::e_islandFlag;
 
 					if (other->m_type != b2_staticBody)
 					{
@@ -939,13 +1250,14 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		subStep.velocityIterations = step.velocityIterations;
 		subStep.particleIterations = step.particleIterations;
 		subStep.warmStarting = false;
+		subStep.wideContactSolver = false;
 		island.SolveTOI(subStep, bA->m_islandIndex, bB->m_islandIndex);
 
 		// Reset island flags and synchronize broad-phase proxies.
 		for (int32 i = 0; i < island.m_bodyCount; ++i)
 		{
 			b2Body* body = island.m_bodies[i];
-			body->m_flags &= ~b2Body::e_islandFlag;
+			body->m_state->flags &= ~b2Body::e_islandFlag;
 
 			if (body->m_type != b2_dynamicBody)
 			{
@@ -965,6 +1277,24 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		// Also, some contacts can be destroyed.
 		m_contactManager.FindNewContacts();
 
+		// Queue the TOIs invalidated above.
+		for (int32 i = 0; i < island.m_bodyCount; ++i)
+		{
+			b2Body* body = island.m_bodies[i];
+			if (body->m_type != b2_dynamicBody)
+			{
+				continue;
+			}
+
+			for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
+			{
+				if ((ce->contact->m_flags & b2Contact::e_toiFlag) == 0)
+				{
+					QueueTOI(ce->contact);
+				}
+			}
+		}
+
 		if (m_subStepping)
 		{
 			m_stepComplete = false;
@@ -1007,6 +1337,8 @@ void b2World::Step(
 	step.dtRatio = m_inv_dt0 * dt;
 
 	step.warmStarting = m_warmStarting;
+	step.wideContactSolver = m_wideContactSolver;
+	m_speculativeTimeStep = dt;
 
 	// Update contacts. This is where some contacts are destroyed.
 	{
@@ -1019,10 +1351,14 @@ void b2World::Step(
 	if (m_stepComplete && step.dt > 0.0f)
 	{
 		b2Timer timer;
+		m_profile.particleIterations = 0;
 		for (b2ParticleSystem* p = m_particleSystemList; p; p = p->GetNext())
 		{
 			p->Solve(step); // Particle Simulation
+			m_profile.particleIterations = b2Max(m_profile.particleIterations,
+												 p->GetIterationCount());
 		}
+		m_profile.solveParticles = timer.GetMilliseconds();
 		Solve(step);
 		m_profile.solve = timer.GetMilliseconds();
 	}
@@ -1045,6 +1381,8 @@ void b2World::Step(
 		ClearForces();
 	}
 
+	m_contactManager.AgeCache();
+
 	m_flags &= ~e_locked;
 
 	m_profile.step = stepTimer.GetMilliseconds();
@@ -1052,10 +1390,12 @@ void b2World::Step(
 
 void b2World::ClearForces()
 {
-	for (b2Body* body = m_bodyList; body; body = body->GetNext())
+	// Sleeping bodies have no forces.
+	for (int32 i = 0; i < m_awakeBodyCount; ++i)
 	{
-		body->m_force.SetZero();
-		body->m_torque = 0.0f;
+		b2BodyState* s = m_awakeBodies[i]->m_state;
+		s->force.SetZero();
+		s->torque = 0.0f;
 	}
 }
 
@@ -1186,11 +1526,7 @@ void b2World::DrawShape(b2Fixture* fixture, const b2Transform& xf, const b2Color
 			int32 vertexCount = poly->m_count;
 			b2Assert(vertexCount <= b2_maxPolygonVertices);
 			b2Vec2 vertices[b2_maxPolygonVertices];
-
-			for (int32 i = 0; i < vertexCount; ++i)
-			{
-				vertices[i] = b2Mul(xf, poly->m_vertices[i]);
-			}
+			b2TransformPoints(vertices, xf, poly->m_vertices, vertexCount);
 
 			m_debugDraw->DrawSolidPolygon(vertices, vertexCount, color);
 		}
@@ -1417,6 +1753,41 @@ float32 b2World::GetTreeQuality() const
 	return m_contactManager.m_broadPhase.GetTreeQuality();
 }
 
+void b2World::SetBroadPhaseType(b2BroadPhase::Type type, float32 cellSize)
+{
+	b2Assert(IsLocked() == false);
+	b2Assert(m_contactManager.m_broadPhase.GetProxyCount() == 0);
+	m_contactManager.m_broadPhase.SetType(type, cellSize);
+}
+
+void b2World::SetThreadCount(int32 threadCount)
+{
+	b2Assert(IsLocked() == false);
+	b2Assert(threadCount >= 1);
+	if (threadCount == GetThreadCount())
+	{
+		return;
+	}
+
+	if (m_threadPool)
+	{
+		m_threadPool->~b2ThreadPool();
+		b2Free(m_threadPool);
+		m_threadPool = NULL;
+	}
+
+	if (threadCount > 1)
+	{
+		void* mem = b2Alloc(sizeof(b2ThreadPool));
+		m_threadPool = new (mem) b2ThreadPool(threadCount);
+	}
+}
+
+int32 b2World::GetThreadCount() const
+{
+	return m_threadPool ? m_threadPool->GetThreadCount() : 1;
+}
+
 void b2World::ShiftOrigin(const b2Vec2& newOrigin)
 {
 	b2Assert((m_flags & e_locked) == 0);
@@ -1425,11 +1796,12 @@ void b2World::ShiftOrigin(const b2Vec2& newOrigin)
 		return;
 	}
 
-	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	for (int32 i = 0; i < m_bodyCount; ++i)
 	{
-		b->m_xf.p -= newOrigin;
-		b->m_sweep.c0 -= newOrigin;
-		b->m_sweep.c -= newOrigin;
+		b2BodyState* s = m_bodyStates + i;
+		s->xf.p -= newOrigin;
+		s->sweep.c0 -= newOrigin;
+		s->sweep.c -= newOrigin;
 	}
 
 	for (b2Joint* j = m_jointList; j; j = j->m_next)
@@ -1440,6 +1812,47 @@ void b2World::ShiftOrigin(const b2Vec2& newOrigin)
 	m_contactManager.m_broadPhase.ShiftOrigin(newOrigin);
 }
 
+// 64-bit FNV-1a, folded over the raw bytes of each value so that the hash
+// reflects bit-level differences (e.g. -0.0f vs 0.0f) between runs.
+static const uint64 b2_fnvOffsetBasis = 14695981039346656037ULL;
+static const uint64 b2_fnvPrime = 1099511628211ULL;
+
+static inline uint64 b2HashBytes(uint64 hash, const void* data, int32 size)
+{
+	const uint8* bytes = (const uint8*)data;
+	for (int32 i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= b2_fnvPrime;
+	}
+	return hash;
+}
+
+uint64 b2World::ComputeStateHash() const
+{
+	uint64 hash = b2_fnvOffsetBasis;
+	hash = b2HashBytes(hash, &m_bodyCount, sizeof(m_bodyCount));
+	for (const b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		hash = b2HashBytes(hash, &b->m_state->xf, sizeof(b->m_state->xf));
+		hash = b2HashBytes(hash, &b->m_state->linearVelocity,
+						   sizeof(b->m_state->linearVelocity));
+		hash = b2HashBytes(hash, &b->m_state->angularVelocity,
+						   sizeof(b->m_state->angularVelocity));
+	}
+	for (const b2ParticleSystem* p = m_particleSystemList; p;
+		 p = p->GetNext())
+	{
+		const int32 count = p->GetParticleCount();
+		hash = b2HashBytes(hash, &count, sizeof(count));
+		hash = b2HashBytes(hash, p->GetPositionBuffer(),
+						   sizeof(b2Vec2) * count);
+		hash = b2HashBytes(hash, p->GetVelocityBuffer(),
+						   sizeof(b2Vec2) * count);
+	}
+	return hash;
+}
+
 void b2World::Dump()
 {
 	if ((m_flags & e_locked) == e_locked)
@@ -24,12 +24,16 @@
 #include <Box2D/Common/b2BlockAllocator.h>
 #include <Box2D/Common/b2StackAllocator.h>
 #include <Box2D/Dynamics/b2ContactManager.h>
+#include <Box2D/Dynamics/b2IslandManager.h>
 #include <Box2D/Dynamics/b2WorldCallbacks.h>
 #include <Box2D/Dynamics/b2TimeStep.h>
 #include <Box2D/Particle/b2ParticleSystem.h>
 
 struct b2AABB;
 struct b2BodyDef;
+struct b2BodyState;
+struct b2TOIEvent;
+struct b2TOIInput;
 struct b2Color;
 struct b2JointDef;
 class b2Body;
@@ -37,6 +41,7 @@ class b2Draw;
 class b2Fixture;
 class b2Joint;
 class b2ParticleGroup;
+class b2ThreadPool;
 
 /// The world class manages all physics entities, dynamic simulation,
 /// and asynchronous queries. The world also contains efficient memory
@@ -174,6 +179,12 @@ public:
 	b2Body* GetBodyList();
 	const b2Body* GetBodyList() const;
 
+	/// Get a body by its dense index, from 0 to GetBodyCount() - 1. This is
+	/// cheaper to walk than the body list. Destroying a body moves the last
+	/// body into its index.
+	b2Body* GetBody(int32 index);
+	const b2Body* GetBody(int32 index) const;
+
 	/// Get the world joint list. With the returned joint, use b2Joint::GetNext to get
 	/// the next joint in the world list. A NULL joint indicates the end of the list.
 	/// @return the head of the world joint list.
@@ -203,6 +214,36 @@ public:
 	void SetWarmStarting(bool flag) { m_warmStarting = flag; }
 	bool GetWarmStarting() const { return m_warmStarting; }
 
+	/// Enable/disable the wide contact solver. Contacts are colored so
+	/// that no two contacts in a batch share a dynamic body and their
+	/// velocities are solved B2_SIMD_WIDTH at a time. Two point manifolds
+	/// are solved point by point instead of with the block solver, so
+	/// results differ slightly from the scalar solver. Off by default.
+	void SetWideContactSolver(bool flag) { m_wideContactSolver = flag; }
+	bool GetWideContactSolver() const { return m_wideContactSolver; }
+
+	/// Solve islands of at least GetParallelIslandThreshold() bodies on
+	/// threadCount threads, the calling thread included. Contacts and
+	/// joints are split into colors that share no dynamic body and each
+	/// color is solved across the threads with the wide contact solver.
+	/// With the wide solver enabled large islands take the colored path
+	/// on 1 thread too, so results do not depend on the thread count. With
+	/// 1 thread (the default) and the wide solver off every island uses
+	/// the scalar solver.
+	void SetThreadCount(int32 threadCount);
+	int32 GetThreadCount() const;
+
+	/// Smallest island, in bodies, that is solved in parallel. Smaller
+	/// islands always use the serial solver.
+	void SetParallelIslandThreshold(int32 bodyCount) { m_parallelIslandThreshold = bodyCount; }
+	int32 GetParallelIslandThreshold() const { return m_parallelIslandThreshold; }
+
+	/// Enable/disable speculative contacts for every body, see
+	/// b2Body::SetSpeculative. Cheaper than continuous physics for many
+	/// medium speed bodies. Off by default.
+	void SetSpeculativeContacts(bool flag) { m_speculativeContacts = flag; }
+	bool GetSpeculativeContacts() const { return m_speculativeContacts; }
+
 	/// Enable/disable continuous physics. For testing.
 	void SetContinuousPhysics(bool flag) { m_continuousPhysics = flag; }
 	bool GetContinuousPhysics() const { return m_continuousPhysics; }
@@ -223,6 +264,11 @@ public:
 	/// Get the number of contacts (each may have 0 or more contact points).
 	int32 GetContactCount() const;
 
+	/// Get the number of persistent islands. Islands are merged right away
+	/// and split lazily, so this can be lower than the number of connected
+	/// groups of bodies.
+	int32 GetIslandCount() const;
+
 	/// Get the height of the dynamic tree.
 	int32 GetTreeHeight() const;
 
@@ -233,6 +279,15 @@ public:
 	/// The minimum is 1.
 	float32 GetTreeQuality() const;
 
+	/// Select the broad-phase backend: the dynamic tree (default) or a
+	/// uniform spatial hash with the given cell size, which is faster for
+	/// swarms of similarly sized bodies. Must be called before any fixture
+	/// is created.
+	void SetBroadPhaseType(b2BroadPhase::Type type, float32 cellSize = 1.0f);
+
+	/// Get the broad-phase backend.
+	b2BroadPhase::Type GetBroadPhaseType() const;
+
 	/// Change the global gravity vector.
 	void SetGravity(const b2Vec2& gravity);
 
@@ -248,6 +303,25 @@ public:
 	/// Get the flag that controls automatic clearing of forces after each time step.
 	bool GetAutoClearForces() const;
 
+	/// Enable/disable deterministic mode. The sorts that feed the solver
+	/// (the radix sorts of proxies and body contacts, the stable sorts of
+	/// pairs and triads) give the same order on every standard library
+	/// already. The flag only makes SolveLifetimes() destroy particles
+	/// with equal expiration times in insertion order; otherwise their
+	/// order is up to std::sort. The contact listener sets are unaffected.
+	void SetDeterministic(bool flag);
+
+	/// Is deterministic mode enabled?
+	bool GetDeterministic() const;
+
+	/// Compute a 64-bit FNV-1a hash of the simulation state: body
+	/// transforms and velocities, followed by the position and velocity
+	/// buffers of each particle system. Two worlds that were fed the same
+	/// inputs in deterministic mode produce the same hash, so comparing it
+	/// once per step is a cheap way to detect desyncs between machines.
+	/// @warning this should be called outside of a time step.
+	uint64 ComputeStateHash() const;
+
 	/// Shift the world origin. Useful for large worlds.
 	/// The body shift formula is: position -= newOrigin
 	/// @param newOrigin the new origin with respect to the old origin
@@ -289,12 +363,14 @@ private:
 	{
 		e_newFixture	= 0x0001,
 		e_locked		= 0x0002,
-		e_clearForces	= 0x0004
+		e_clearForces	= 0x0004,
+		e_deterministic	= 0x0008
 	};
 
 	friend class b2Body;
 	friend class b2Fixture;
 	friend class b2ContactManager;
+	friend class b2Contact;
 	friend class b2Controller;
 	friend class b2ParticleSystem;
 
@@ -308,12 +384,31 @@ private:
 
 	void DrawParticleSystem(const b2ParticleSystem& system);
 
+	b2BodyState* CreateBodyState();
+	void DestroyBodyState(b2BodyState* state);
+
+	// Add a body that woke up to the awake set, with its contacts.
+	void AddAwakeBody(b2Body* b);
+	void RemoveAwakeBody(b2Body* b);
+
+	// Reset the TOI state of a body the first time SolveTOI sees it in a
+	// step.
+	void ResetTOIBody(b2Body* b);
+
+	// Filter a TOI candidate, align its sweeps and fill the TOI input.
+	bool PrepareTOI(b2Contact* c, b2TOIInput* input);
+
+	// Compute the TOI of a contact if it isn't cached and queue it.
+	void QueueTOI(b2Contact* c);
+	void PushTOI(b2Contact* c);
+
 	b2BlockAllocator m_blockAllocator;
 	b2StackAllocator m_stackAllocator;
 
 	int32 m_flags;
 
 	b2ContactManager m_contactManager;
+	b2IslandManager m_islandManager;
 
 	b2Body* m_bodyList;
 	b2Joint* m_jointList;
@@ -322,6 +417,24 @@ private:
 	int32 m_bodyCount;
 	int32 m_jointCount;
 
+	// Dense hot body state, m_bodyCount in use.
+	b2BodyState* m_bodyStates;
+	int32 m_bodyStateCapacity;
+
+	// Awake non-static bodies. Bodies that go to sleep or become static
+	// are dropped lazily at the start of Solve.
+	b2Body** m_awakeBodies;
+	int32 m_awakeBodyCount;
+	int32 m_awakeBodyCapacity;
+
+	// Bumped when a step's SolveTOI starts, see ResetTOIBody.
+	uint32 m_toiStamp;
+
+	// Min-heap of pending TOI events, rebuilt by each SolveTOI.
+	b2TOIEvent* m_toiQueue;
+	int32 m_toiQueueCount;
+	int32 m_toiQueueCapacity;
+
 	b2Vec2 m_gravity;
 	bool m_allowSleep;
 
@@ -337,6 +450,15 @@ private:
 	bool m_continuousPhysics;
 	bool m_subStepping;
 
+	bool m_wideContactSolver;
+
+	bool m_speculativeContacts;
+	// Time step the speculative distances are computed for.
+	float32 m_speculativeTimeStep;
+
+	b2ThreadPool* m_threadPool;
+	int32 m_parallelIslandThreshold;
+
 	bool m_stepComplete;
 
 	b2Profile m_profile;
@@ -402,6 +524,11 @@ inline int32 b2World::GetContactCount() const
 	return m_contactManager.m_contactCount;
 }
 
+inline int32 b2World::GetIslandCount() const
+{
+	return m_islandManager.m_islandCount;
+}
+
 inline void b2World::SetGravity(const b2Vec2& gravity)
 {
 	m_gravity = gravity;
@@ -435,6 +562,28 @@ inline bool b2World::GetAutoClearForces() const
 	return (m_flags & e_clearForces) == e_clearForces;
 }
 
+inline void b2World::SetDeterministic(bool flag)
+{
+	if (flag)
+	{
+		m_flags |= e_deterministic;
+	}
+	else
+	{
+		m_flags &= ~e_deterministic;
+	}
+}
+
+inline bool b2World::GetDeterministic() const
+{
+	return (m_flags & e_deterministic) == e_deterministic;
+}
+
+inline b2BroadPhase::Type b2World::GetBroadPhaseType() const
+{
+	return m_contactManager.m_broadPhase.GetType();
+}
+
 inline const b2ContactManager& b2World::GetContactManager() const
 {
 	return m_contactManager;
@@ -342,6 +342,127 @@ public:
 	int32 Find(const ParticlePair& pair) const;
 };
 
+// Stable LSD radix sort of 'count' items on the 32-bit key returned by
+// 'key', one byte per pass. 'scratch' must have room for 'count' items.
+// Input that is already in order costs a single scan, input with only a
+// few items out of place is finished with an insertion sort, and passes
+// over bytes that are the same for every key are skipped.
+template <typename T, typename KeyFunction>
+static void RadixSort(T* items, int32 count, T* scratch, KeyFunction key)
+{
+	int32 descents = 0;
+	for (int32 i = 1; i < count; i++)
+	{
+		descents += key(items[i]) < key(items[i - 1]);
+	}
+	if (descents == 0)
+	{
+		return;
+	}
+
+	// Particles only move a fraction of a cell per iteration, so most of
+	// the time only a handful of proxies change place. Give up on the
+	// insertion sort once it has shifted as many items as the radix sort
+	// would have copied; the partially sorted array is still a valid input.
+	if (descents < count / 64)
+	{
+		int32 budget = 8 * count;
+		int32 i = 1;
+		for (; i < count && budget > 0; i++)
+		{
+			T item = items[i];
+			uint32 itemKey = key(item);
+			int32 j = i;
+			for (; j > 0 && itemKey < key(items[j - 1]); j--)
+			{
+				items[j] = items[j - 1];
+			}
+			items[j] = item;
+			budget -= i - j;
+		}
+		if (i == count)
+		{
+			return;
+		}
+	}
+
+	int32 histogram[4][256];
+	memset(histogram, 0, sizeof(histogram));
+	for (int32 i = 0; i < count; i++)
+	{
+		uint32 k = key(items[i]);
+		histogram[0][k & 0xff]++;
+		histogram[1][(k >> 8) & 0xff]++;
+		histogram[2][(k >> 16) & 0xff]++;
+		histogram[3][k >> 24]++;
+	}
+
+	T* source = items;
+	T* destination = scratch;
+	for (int32 pass = 0; pass < 4; pass++)
+	{
+		int32* offsets = histogram[pass];
+		const uint32 shift = pass * 8;
+		if (offsets[(key(source[0]) >> shift) & 0xff] == count)
+		{
+			continue;
+		}
+		int32 sum = 0;
+		for (int32 digit = 0; digit < 256; digit++)
+		{
+			int32 n = offsets[digit];
+			offsets[digit] = sum;
+			sum += n;
+		}
+		for (int32 i = 0; i < count; i++)
+		{
+			destination[offsets[(key(source[i]) >> shift) & 0xff]++] =
+				source[i];
+		}
+		b2Swap(source, destination);
+	}
+	if (source != items)
+	{
+		memcpy(items, source, sizeof(T) * count);
+	}
+}
+
+// Maps a float onto an unsigned integer with the same ordering.
+static inline uint32 OrderedFloatBits(float32 f)
+{
+	union { float32 f; uint32 u; } bits;
+	bits.f = f;
+	return bits.u ^ ((bits.u >> 31) ? 0xffffffff : 0x80000000);
+}
+
+// Sort keys for RadixSort.
+struct ProxyTagKey
+{
+	template <typename T>
+	uint32 operator()(const T& proxy) const { return proxy.tag; }
+};
+
+struct BodyContactWeightKey
+{
+	// Decreasing weight.
+	uint32 operator()(const b2ParticleBodyContact& contact) const
+	{
+		return ~OrderedFloatBits(contact.weight);
+	}
+};
+
+struct BodyContactIndexKey
+{
+	uint32 operator()(const b2ParticleBodyContact& contact) const
+	{
+		return (uint32) contact.index ^ 0x80000000;
+	}
+};
+
+// Longest stretch of particle iterations without the contact candidate
+// cache. See FindContactsWithCandidates().
+static const int32 k_maxContactCandidateBackoff = 63;
+
 static inline uint32 computeTag(float32 x, float32 y)
 {
 	return ((uint32)(y + yOffset) << yShift) + (uint32)(xScale * x + xOffset);
@@ -389,10 +510,15 @@ b2ParticleSystem::b2ParticleSystem(const b2ParticleSystemDef* def,
 	m_stuckParticleBuffer(world->m_blockAllocator),
 	m_proxyBuffer(world->m_blockAllocator),
 	m_contactBuffer(world->m_blockAllocator),
+	m_contactCandidateBuffer(world->m_blockAllocator),
+	m_contactCandidateProxyBuffer(world->m_blockAllocator),
+	m_contactCandidatePositionBuffer(world->m_blockAllocator),
 	m_bodyContactBuffer(world->m_blockAllocator),
 	m_pairBuffer(world->m_blockAllocator),
 	m_triadBuffer(world->m_blockAllocator)
 {
+	m_sortScratchBuffer = NULL;
+	m_sortScratchCapacity = 0;
 	b2Assert(def);
 	m_paused = false;
 	m_timestamp = 0;
@@ -402,11 +528,18 @@ b2ParticleSystem::b2ParticleSystem(const b2ParticleSystemDef* def,
 	m_needsUpdateAllGroupFlags = false;
 	m_hasForce = false;
 	m_iterationIndex = 0;
+	m_iterationCount = 0;
+	m_stepsSinceReorder = 0;
+	m_contactCandidatesValid = false;
+	m_contactCandidateReuseCount = 0;
+	m_contactCandidateBackoff = 0;
+	m_contactCandidateSkipCount = 0;
 
 	SetStrictContactCheck(def->strictContactCheck);
 	SetDensity(def->density);
 	SetGravityScale(def->gravityScale);
 	SetRadius(def->radius);
+	SetContactSkin(def->contactSkin);
 	SetMaxParticleCount(def->maxCount);
 
 	m_count = 0;
@@ -414,6 +547,8 @@ b2ParticleSystem::b2ParticleSystem(const b2ParticleSystemDef* def,
 	m_forceBuffer = NULL;
 	m_weightBuffer = NULL;
 	m_staticPressureBuffer = NULL;
+	m_sleepTimeBuffer = NULL;
+	m_sleepingCount = 0;
 	m_accumulationBuffer = NULL;
 	m_accumulation2Buffer = NULL;
 	m_depthBuffer = NULL;
@@ -456,10 +591,12 @@ b2ParticleSystem::~b2ParticleSystem()
 	FreeBuffer(&m_forceBuffer, m_internalAllocatedCapacity);
 	FreeBuffer(&m_weightBuffer, m_internalAllocatedCapacity);
 	FreeBuffer(&m_staticPressureBuffer, m_internalAllocatedCapacity);
+	FreeBuffer(&m_sleepTimeBuffer, m_internalAllocatedCapacity);
 	FreeBuffer(&m_accumulationBuffer, m_internalAllocatedCapacity);
 	FreeBuffer(&m_accumulation2Buffer, m_internalAllocatedCapacity);
 	FreeBuffer(&m_depthBuffer, m_internalAllocatedCapacity);
 	FreeBuffer(&m_groupBuffer, m_internalAllocatedCapacity);
+	FreeBuffer((uint8**) &m_sortScratchBuffer, m_sortScratchCapacity);
 }
 
 template <typename T> void b2ParticleSystem::FreeBuffer(T** b, int capacity)
@@ -610,6 +747,9 @@ void b2ParticleSystem::ReallocateInternalAllocatedBuffers(int32 capacity)
 		m_staticPressureBuffer = ReallocateBuffer(
 			m_staticPressureBuffer, 0, m_internalAllocatedCapacity, capacity,
 			true);
+		m_sleepTimeBuffer = ReallocateBuffer(
+			m_sleepTimeBuffer, 0, m_internalAllocatedCapacity, capacity,
+			true);
 		m_accumulationBuffer = ReallocateBuffer(
 			m_accumulationBuffer, 0, m_internalAllocatedCapacity, capacity,
 			false);
@@ -686,6 +826,10 @@ int32 b2ParticleSystem::CreateParticle(const b2ParticleDef& def)
 	{
 		m_staticPressureBuffer[index] = 0;
 	}
+	if (m_sleepTimeBuffer)
+	{
+		m_sleepTimeBuffer[index] = 0;
+	}
 	if (m_depthBuffer)
 	{
 		m_depthBuffer[index] = 0;
@@ -705,6 +849,7 @@ int32 b2ParticleSystem::CreateParticle(const b2ParticleDef& def)
 		m_handleIndexBuffer.data[index] = NULL;
 	}
 	Proxy& proxy = m_proxyBuffer.Append();
+	m_contactCandidatesValid = false;
 
 	// If particle lifetimes are enabled or the lifetime is set in the particle
 	// definition, initialize the lifetime.
@@ -744,6 +889,44 @@ int32 b2ParticleSystem::CreateParticle(const b2ParticleDef& def)
 	return index;
 }
 
+int32 b2ParticleSystem::CreateParticles(const b2ParticleDef* defs,
+										int32 count)
+{
+	b2Assert(m_world->IsLocked() == false);
+	if (m_world->IsLocked())
+	{
+		return 0;
+	}
+
+	if (m_count + count > m_internalAllocatedCapacity)
+	{
+		int32 capacity =
+			m_count ? 2 * m_count : b2_minParticleSystemBufferCapacity;
+		ReallocateInternalAllocatedBuffers(b2Max(capacity, m_count + count));
+	}
+	const int32 overflow = b2Min(m_count + count - m_internalAllocatedCapacity,
+								 m_count);
+	if (overflow > 0 && m_def.destroyByAge &&
+		m_indexByExpirationTimeBuffer.data)
+	{
+		for (int32 i = 0; i < overflow; i++)
+		{
+			DestroyOldestParticle(i, false);
+		}
+		SolveZombie();
+	}
+
+	int32 created = 0;
+	for (; created < count; created++)
+	{
+		if (CreateParticle(defs[created]) == b2_invalidParticleIndex)
+		{
+			break;
+		}
+	}
+	return created;
+}
+
 /// Retrieve a handle to the particle at the specified index.
 const b2ParticleHandle* b2ParticleSystem::GetParticleHandleFromIndex(
 	const int32 index)
@@ -776,6 +959,88 @@ void b2ParticleSystem::DestroyParticle(
 	SetParticleFlags(index, m_flagsBuffer.data[index] | flags);
 }
 
+int32 b2ParticleSystem::DestroyParticles(
+	const int32* indices, int32 count, bool callDestructionListener)
+{
+	uint32 flags = b2_zombieParticle;
+	if (callDestructionListener)
+	{
+		flags |= b2_destructionListenerParticle;
+	}
+	int32 destroyed = 0;
+	for (int32 i = 0; i < count; i++)
+	{
+		b2Assert(ValidateParticleIndex(indices[i]));
+		uint32& particleFlags = m_flagsBuffer.data[indices[i]];
+		destroyed += (particleFlags & b2_zombieParticle) == 0;
+		particleFlags |= flags;
+	}
+	// Adding flags never needs the per particle bookkeeping of
+	// SetParticleFlags(); zombies are removed by SolveZombie().
+	m_allParticleFlags |= flags;
+	return destroyed;
+}
+
+void b2ParticleSystem::DestroyAllParticles(bool callDestructionListener)
+{
+	b2Assert(m_world->IsLocked() == false);
+	if (m_world->IsLocked())
+	{
+		return;
+	}
+
+	b2DestructionListener * const destructionListener =
+		m_world->m_destructionListener;
+	for (int32 i = 0; i < m_count; i++)
+	{
+		if (destructionListener &&
+			(callDestructionListener ||
+			 (m_flagsBuffer.data[i] & b2_destructionListenerParticle)))
+		{
+			destructionListener->SayGoodbye(this, i);
+		}
+		if (m_handleIndexBuffer.data)
+		{
+			b2ParticleHandle * const handle = m_handleIndexBuffer.data[i];
+			if (handle)
+			{
+				handle->SetIndex(b2_invalidParticleIndex);
+				m_handleIndexBuffer.data[i] = NULL;
+				m_handleAllocator.Free(handle);
+			}
+		}
+	}
+
+	m_count = 0;
+	m_proxyBuffer.SetCount(0);
+	m_contactBuffer.SetCount(0);
+	m_bodyContactBuffer.SetCount(0);
+	m_pairBuffer.SetCount(0);
+	m_triadBuffer.SetCount(0);
+	m_stuckParticleBuffer.SetCount(0);
+	m_contactCandidatesValid = false;
+	m_sleepingCount = 0;
+	m_allParticleFlags = 0;
+	m_needsUpdateAllParticleFlags = false;
+
+	for (b2ParticleGroup* group = m_groupList; group;)
+	{
+		b2ParticleGroup* next = group->GetNext();
+		if (group->m_groupFlags & b2_particleGroupCanBeEmpty)
+		{
+			group->m_firstIndex = 0;
+			group->m_lastIndex = 0;
+		}
+		else
+		{
+			// DestroyParticleGroup() clears the group's slots of the group
+			// buffer, so it has to see the old range.
+			DestroyParticleGroup(group);
+		}
+		group = next;
+	}
+}
+
 void b2ParticleSystem::DestroyOldestParticle(
 	const int32 index, const bool callDestructionListener)
 {
@@ -1665,6 +1930,43 @@ void b2ParticleSystem::ComputeWeight()
 {
 	// calculates the sum of contact-weights for each particle
 	// that means dimensionless density
+	if (m_sleepingCount > 0)
+	{
+		// Sleeping particles keep the weight they fell asleep with, the
+		// contacts between them are gone.
+		for (int32 i = 0; i < m_count; i++)
+		{
+			if (!IsParticleAsleep(i))
+			{
+				m_weightBuffer[i] = 0;
+			}
+		}
+		for (int32 k = 0; k < m_bodyContactBuffer.GetCount(); k++)
+		{
+			const b2ParticleBodyContact& contact = m_bodyContactBuffer[k];
+			int32 a = contact.index;
+			if (!IsParticleAsleep(a))
+			{
+				m_weightBuffer[a] += contact.weight;
+			}
+		}
+		for (int32 k = 0; k < m_contactBuffer.GetCount(); k++)
+		{
+			const b2ParticleContact& contact = m_contactBuffer[k];
+			int32 a = contact.GetIndexA();
+			int32 b = contact.GetIndexB();
+			float32 w = contact.GetWeight();
+			if (!IsParticleAsleep(a))
+			{
+				m_weightBuffer[a] += w;
+			}
+			if (!IsParticleAsleep(b))
+			{
+				m_weightBuffer[b] += w;
+			}
+		}
+		return;
+	}
 	memset(m_weightBuffer, 0, sizeof(*m_weightBuffer) * m_count);
 	for (int32 k = 0; k < m_bodyContactBuffer.GetCount(); k++)
 	{
@@ -1809,6 +2111,10 @@ b2ParticleSystem::GetInsideBoundsEnumerator(const b2AABB& aabb) const
 inline void b2ParticleSystem::AddContact(int32 a, int32 b,
 	b2GrowableBuffer<b2ParticleContact>& contacts) const
 {
+	if (IsParticleAsleep(a) && IsParticleAsleep(b))
+	{
+		return;
+	}
 	b2Vec2 d = m_positionBuffer.data[b] - m_positionBuffer.data[a];
 	float32 distBtParticlesSq = b2Dot(d, d);
 	if (distBtParticlesSq < m_squaredDiameter)
@@ -2003,6 +2309,156 @@ void b2ParticleSystem::FindContacts(
 	#endif // defined(LIQUIDFUN_SIMD_TEST_VS_REFERENCE)
 }
 
+// The candidates stay valid as long as no particle has moved more than half
+// the skin since they were computed: two particles closing in on each other
+// can then have covered at most the whole skin.
+bool b2ParticleSystem::ContactCandidatesNeedUpdate() const
+{
+	if (!m_contactCandidatesValid ||
+		m_contactCandidatePositionBuffer.GetCount() != m_count)
+	{
+		return true;
+	}
+	const float32 halfSkin = 0.5f * m_def.contactSkin;
+	const float32 maxDisplacementSquared = halfSkin * halfSkin;
+	const b2Vec2* positions = m_positionBuffer.data;
+	const b2Vec2* candidatePositions = m_contactCandidatePositionBuffer.Data();
+	for (int32 i = 0; i < m_count; i++)
+	{
+		if (b2DistanceSquared(positions[i], candidatePositions[i]) >
+			maxDisplacementSquared)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+inline void b2ParticleSystem::AddContactCandidate(int32 a, int32 b,
+	float32 squaredRange, b2GrowableBuffer<b2ParticleContact>& contacts)
+{
+	if (b2DistanceSquared(m_positionBuffer.data[a], m_positionBuffer.data[b]) <
+		squaredRange)
+	{
+		ContactCandidate& candidate = m_contactCandidateBuffer.Append();
+		candidate.indexA = a;
+		candidate.indexB = b;
+		AddContact(a, b, contacts);
+	}
+}
+
+// Same sweep as FindContacts_Reference, over proxies tagged with cells as
+// wide as the particle diameter plus the skin. Contacts are found along
+// the way, in candidate order.
+void b2ParticleSystem::UpdateContactCandidates(
+	b2GrowableBuffer<b2ParticleContact>& contacts)
+{
+	const float32 range = m_particleDiameter + m_def.contactSkin;
+	const float32 inverseRange = 1 / range;
+	const float32 squaredRange = range * range;
+	const b2Vec2* positions = m_positionBuffer.data;
+
+	// The candidate proxies are kept between rebuilds so that, like the
+	// main proxies, they are nearly sorted already. Any change of particle
+	// indices keeps them a permutation of [0, m_count) as long as the count
+	// is the same.
+	if (m_contactCandidateProxyBuffer.GetCount() != m_count)
+	{
+		m_contactCandidateProxyBuffer.Reserve(m_count);
+		m_contactCandidateProxyBuffer.SetCount(m_count);
+		for (int32 i = 0; i < m_count; i++)
+		{
+			m_contactCandidateProxyBuffer[i].index = i;
+		}
+	}
+	Proxy* proxies = m_contactCandidateProxyBuffer.Data();
+	for (int32 i = 0; i < m_count; i++)
+	{
+		const b2Vec2& p = positions[proxies[i].index];
+		proxies[i].tag = computeTag(inverseRange * p.x, inverseRange * p.y);
+	}
+	Proxy* scratch = (Proxy*) GetSortScratchBuffer(sizeof(Proxy) * m_count);
+	RadixSort(proxies, m_count, scratch, ProxyTagKey());
+
+	m_contactCandidateBuffer.SetCount(0);
+	contacts.SetCount(0);
+	const Proxy* beginProxy = proxies;
+	const Proxy* endProxy = proxies + m_count;
+	for (const Proxy *a = beginProxy, *c = beginProxy; a < endProxy; a++)
+	{
+		uint32 rightTag = computeRelativeTag(a->tag, 1, 0);
+		for (const Proxy* b = a + 1; b < endProxy; b++)
+		{
+			if (rightTag < b->tag) break;
+			AddContactCandidate(a->index, b->index, squaredRange, contacts);
+		}
+		uint32 bottomLeftTag = computeRelativeTag(a->tag, -1, 1);
+		for (; c < endProxy; c++)
+		{
+			if (bottomLeftTag <= c->tag) break;
+		}
+		uint32 bottomRightTag = computeRelativeTag(a->tag, 1, 1);
+		for (const Proxy* b = c; b < endProxy; b++)
+		{
+			if (bottomRightTag < b->tag) break;
+			AddContactCandidate(a->index, b->index, squaredRange, contacts);
+		}
+	}
+	m_contactCandidatePositionBuffer.Reserve(m_count);
+	m_contactCandidatePositionBuffer.SetCount(m_count);
+	memcpy(m_contactCandidatePositionBuffer.Data(), positions,
+		   sizeof(b2Vec2) * m_count);
+	m_contactCandidatesValid = true;
+}
+
+void b2ParticleSystem::FindContactsFromCandidates(
+	b2GrowableBuffer<b2ParticleContact>& contacts) const
+{
+	contacts.SetCount(0);
+	const ContactCandidate* endCandidate = m_contactCandidateBuffer.End();
+	for (const ContactCandidate* candidate = m_contactCandidateBuffer.Begin();
+		 candidate < endCandidate; ++candidate)
+	{
+		AddContact(candidate->indexA, candidate->indexB, contacts);
+	}
+}
+
+// A list that has to be rebuilt after fewer than two reuses costs more than
+// the regular search, as the sweep over wider cells tests more pairs. While
+// that keeps happening (fast flows, splashes) the regular search is used
+// instead, for exponentially longer stretches of iterations.
+void b2ParticleSystem::FindContactsWithCandidates(
+	b2GrowableBuffer<b2ParticleContact>& contacts)
+{
+	if (m_contactCandidateSkipCount > 0)
+	{
+		m_contactCandidateSkipCount--;
+		FindContacts(contacts);
+		return;
+	}
+	if (!ContactCandidatesNeedUpdate())
+	{
+		m_contactCandidateReuseCount++;
+		FindContactsFromCandidates(contacts);
+		return;
+	}
+	if (m_contactCandidatesValid && m_contactCandidateReuseCount < 2)
+	{
+		m_contactCandidateBackoff = b2Min(2 * m_contactCandidateBackoff + 1,
+										  k_maxContactCandidateBackoff);
+		m_contactCandidateSkipCount = m_contactCandidateBackoff;
+		m_contactCandidatesValid = false;
+		FindContacts(contacts);
+		return;
+	}
+	if (m_contactCandidatesValid)
+	{
+		m_contactCandidateBackoff = 0;
+	}
+	m_contactCandidateReuseCount = 0;
+	UpdateContactCandidates(contacts);
+}
+
 static inline bool b2ParticleContactIsZombie(const b2ParticleContact& contact)
 {
 	return (contact.GetFlags() & b2_zombieParticle) == b2_zombieParticle;
@@ -2153,12 +2609,30 @@ void b2ParticleSystem::UpdateProxies(
 // immediately above and below it. This ordering makes collision computation
 // tractable.
 //
-// TODO OPT: The sort is a hot spot on the profiles. We could use SIMD to
-// speed this up. See http://www.vldb.org/pvldb/1/1454171.pdf for an excellent
-// explanation of a SIMD mergesort algorithm.
+// Proxies barely move between particle iterations, so the radix sort usually
+// returns after checking that the array is still in order. The sort is
+// stable, which keeps the order of particles sharing a tag reproducible.
 void b2ParticleSystem::SortProxies(b2GrowableBuffer<Proxy>& proxies) const
 {
-	std::sort(proxies.Begin(), proxies.End());
+	const int32 count = proxies.GetCount();
+	Proxy* scratch = (Proxy*) GetSortScratchBuffer(sizeof(Proxy) * count);
+	RadixSort(proxies.Begin(), count, scratch, ProxyTagKey());
+}
+
+void* b2ParticleSystem::GetSortScratchBuffer(int32 size) const
+{
+	if (size > m_sortScratchCapacity)
+	{
+		if (m_sortScratchBuffer)
+		{
+			m_world->m_blockAllocator.Free(m_sortScratchBuffer,
+										   m_sortScratchCapacity);
+		}
+		m_sortScratchCapacity = b2Max(size, 2 * m_sortScratchCapacity);
+		m_sortScratchBuffer =
+			m_world->m_blockAllocator.Allocate(m_sortScratchCapacity);
+	}
+	return m_sortScratchBuffer;
 }
 
 class b2ParticleContactRemovePredicate
@@ -2263,7 +2737,14 @@ void b2ParticleSystem::UpdateContacts(bool exceptZombie)
 	b2ParticlePairSet particlePairs(&m_world->m_stackAllocator);
 	NotifyContactListenerPreContact(&particlePairs);
 
-	FindContacts(m_contactBuffer);
+	if (m_def.contactSkin > 0)
+	{
+		FindContactsWithCandidates(m_contactBuffer);
+	}
+	else
+	{
+		FindContacts(m_contactBuffer);
+	}
 	FilterContacts(m_contactBuffer);
 
 	NotifyContactListenerPostContact(particlePairs);
@@ -2605,6 +3086,20 @@ void b2ParticleSystem::NotifyBodyContactListenerPostContact(
 }
 
 
+void b2ParticleSystem::DestroyBodyContacts(const b2Body* body)
+{
+	int32 count = 0;
+	for (int32 k = 0; k < m_bodyContactBuffer.GetCount(); k++)
+	{
+		const b2ParticleBodyContact& contact = m_bodyContactBuffer[k];
+		if (contact.body != body)
+		{
+			m_bodyContactBuffer[count++] = contact;
+		}
+	}
+	m_bodyContactBuffer.SetCount(count);
+}
+
 void b2ParticleSystem::UpdateBodyContacts()
 {
 	// If the particle contact listener is enabled, generate a set of
@@ -2652,6 +3147,13 @@ void b2ParticleSystem::UpdateBodyContacts()
 		void ReportFixtureAndParticle(
 								b2Fixture* fixture, int32 childIndex, int32 a)
 		{
+			// Sleeping particles keep their weight, only contacts that can
+			// wake them are needed.
+			if (m_system->IsParticleAsleep(a) &&
+				fixture->GetBody()->GetType() == b2_staticBody)
+			{
+				return;
+			}
 			b2Vec2 ap = m_system->m_positionBuffer.data[a];
 			float32 d;
 			b2Vec2 n;
@@ -2726,8 +3228,12 @@ void b2ParticleSystem::RemoveSpuriousBodyContacts()
 	//         it, otherwise discard as impossible
 	//      - repeat for up to n nearest contacts, currently we get good results
 	//        from n=3.
-	std::sort(m_bodyContactBuffer.Begin(), m_bodyContactBuffer.End(),
-				b2ParticleSystem::BodyContactCompare);
+	// Two stable passes: by decreasing weight, then by particle.
+	const int32 count = m_bodyContactBuffer.GetCount();
+	b2ParticleBodyContact* scratch = (b2ParticleBodyContact*)
+		GetSortScratchBuffer(sizeof(b2ParticleBodyContact) * count);
+	RadixSort(m_bodyContactBuffer.Begin(), count, scratch, BodyContactWeightKey());
+	RadixSort(m_bodyContactBuffer.Begin(), count, scratch, BodyContactIndexKey());
 
 	int32 discarded = 0;
 	std::remove_if(m_bodyContactBuffer.Begin(),
@@ -2737,18 +3243,6 @@ void b2ParticleSystem::RemoveSpuriousBodyContacts()
 	m_bodyContactBuffer.SetCount(m_bodyContactBuffer.GetCount() - discarded);
 }
 
-bool b2ParticleSystem::BodyContactCompare(const b2ParticleBodyContact &lhs,
-										  const b2ParticleBodyContact &rhs)
-{
-	if (lhs.index == rhs.index)
-	{
-		// Subsort by weight, decreasing.
-		return lhs.weight > rhs.weight;
-	}
-	return lhs.index < rhs.index;
-}
-
-
 void b2ParticleSystem::SolveCollision(const b2TimeStep& step)
 {
 	// This function detects particles which are crossing boundary of bodies
@@ -2789,6 +3283,11 @@ void b2ParticleSystem::SolveCollision(const b2TimeStep& step)
 		void ReportFixtureAndParticle(
 								b2Fixture* fixture, int32 childIndex, int32 a)
 		{
+			// Sleeping particles don't move.
+			if (m_system->IsParticleAsleep(a))
+			{
+				return;
+			}
 			if (ShouldCollide(fixture, a)) {
 				b2Body* body = fixture->GetBody();
 				b2Vec2 ap = m_system->m_positionBuffer.data[a];
@@ -2798,21 +3297,21 @@ void b2ParticleSystem::SolveCollision(const b2TimeStep& step)
 				if (m_system->m_iterationIndex == 0)
 				{
 					// Put 'ap' in the local space of the previous frame
-					b2Vec2 p1 = b2MulT(body->m_xf0, ap);
+					b2Vec2 p1 = b2MulT(body->m_state->xf0, ap);
 					if (fixture->GetShape()->GetType() == b2Shape::e_circle)
 					{
 						// Make relative to the center of the circle
 						p1 -= body->GetLocalCenter();
 						// Re-apply rotation about the center of the
 						// circle
-						p1 = b2Mul(body->m_xf0.q, p1);
+						p1 = b2Mul(body->m_state->xf0.q, p1);
 						// Subtract rotation of the current frame
-						p1 = b2MulT(body->m_xf.q, p1);
+						p1 = b2MulT(body->m_state->xf.q, p1);
 						// Return to local space
 						p1 += body->GetLocalCenter();
 					}
 					// Return to global space and apply rotation of current frame
-					input.p1 = b2Mul(body->m_xf, p1);
+					input.p1 = b2Mul(body->m_state->xf, p1);
 				}
 				else
 				{
@@ -2972,6 +3471,7 @@ void b2ParticleSystem::SolveBarrier(const b2TimeStep& step)
 
 void b2ParticleSystem::Solve(const b2TimeStep& step)
 {
+	m_iterationCount = 0;
 	if (m_count == 0)
 	{
 		return;
@@ -2997,14 +3497,34 @@ void b2ParticleSystem::Solve(const b2TimeStep& step)
 	{
 		return;
 	}
-	for (m_iterationIndex = 0;
-		m_iterationIndex < step.particleIterations;
+	if (m_def.reorderInterval > 0 &&
+		++m_stepsSinceReorder >= m_def.reorderInterval)
+	{
+		ReorderBuffers();
+	}
+	if (m_def.sleepVelocity > 0)
+	{
+		UpdateSleep(step);
+	}
+	else if (m_sleepingCount > 0)
+	{
+		WakeParticles();
+	}
+	if (m_sleepingCount == m_count)
+	{
+		// Everything is asleep, nothing to solve.
+		return;
+	}
+	m_iterationCount = m_def.maxAdaptiveIterations > 0 ?
+		ComputeAdaptiveIterations(step) : step.particleIterations;
+	for (m_iterationIndex = 0;
+		m_iterationIndex < m_iterationCount;
 		m_iterationIndex++)
 	{
 		++m_timestamp;
 		b2TimeStep subStep = step;
-		subStep.dt /= step.particleIterations;
-		subStep.inv_dt *= step.particleIterations;
+		subStep.dt /= m_iterationCount;
+		subStep.inv_dt *= m_iterationCount;
 		UpdateContacts(false);
 		UpdateBodyContacts();
 		ComputeWeight();
@@ -3086,6 +3606,10 @@ void b2ParticleSystem::Solve(const b2TimeStep& step)
 		{
 			SolveWall();
 		}
+		if (m_sleepingCount > 0)
+		{
+			ResetSleepingVelocities();
+		}
 		// The particle positions can be updated only at the end of substep.
 		for (int32 i = 0; i < m_count; i++)
 		{
@@ -3115,6 +3639,127 @@ void b2ParticleSystem::UpdateAllGroupFlags()
 	m_needsUpdateAllGroupFlags = false;
 }
 
+int32 b2ParticleSystem::ComputeAdaptiveIterations(
+	const b2TimeStep& step) const
+{
+	float32 maxSpeedSquared = 0;
+	for (int32 i = 0; i < m_count; i++)
+	{
+		maxSpeedSquared = b2Max(maxSpeedSquared,
+								m_velocityBuffer.data[i].LengthSquared());
+	}
+	// The fastest particle may also gain a full step of gravity.
+	float32 gravity = m_def.gravityScale * m_world->GetGravity().Length();
+	float32 travel = (b2Sqrt(maxSpeedSquared) + gravity * step.dt) * step.dt;
+	// Clamp before the cast, a runaway speed would overflow int32. NaN
+	// also ends up at the maximum.
+	float32 iterations = ceilf(
+		travel / (m_def.courantNumber * m_particleDiameter));
+	return (int32) b2Clamp(iterations, 1.0f,
+						   (float32) m_def.maxAdaptiveIterations);
+}
+
+void b2ParticleSystem::UpdateSleep(const b2TimeStep& step)
+{
+	m_sleepTimeBuffer = RequestBuffer(m_sleepTimeBuffer);
+	const float32 sleepVelocitySquared =
+		m_def.sleepVelocity * m_def.sleepVelocity;
+	const float32 sleepTime = m_def.sleepTime;
+	const uint32 noSleepGroupFlags =
+		b2_rigidParticleGroup | b2_solidParticleGroup;
+
+	// Slow particles doze, the others are awake.
+	for (int32 i = 0; i < m_count; i++)
+	{
+		float32& t = m_sleepTimeBuffer[i];
+		const b2ParticleGroup* group = m_groupBuffer[i];
+		if ((m_flagsBuffer.data[i] & k_noSleepFlags) ||
+			(group && (group->m_groupFlags & noSleepGroupFlags)) ||
+			m_velocityBuffer.data[i].LengthSquared() > sleepVelocitySquared)
+		{
+			t = 0;
+		}
+		else
+		{
+			t = b2Min(t + step.dt, sleepTime);
+		}
+	}
+	if (m_hasForce)
+	{
+		for (int32 i = 0; i < m_count; i++)
+		{
+			if (m_forceBuffer[i] != b2Vec2_zero)
+			{
+				m_sleepTimeBuffer[i] = 0;
+			}
+		}
+	}
+
+	// Moving particles keep their neighbors awake. Only the speed counts,
+	// a particle woken here does not wake its own neighbors before it
+	// moves.
+	for (int32 k = 0; k < m_contactBuffer.GetCount(); k++)
+	{
+		const b2ParticleContact& contact = m_contactBuffer[k];
+		int32 a = contact.GetIndexA();
+		int32 b = contact.GetIndexB();
+		if (m_velocityBuffer.data[a].LengthSquared() > sleepVelocitySquared)
+		{
+			m_sleepTimeBuffer[b] = 0;
+		}
+		if (m_velocityBuffer.data[b].LengthSquared() > sleepVelocitySquared)
+		{
+			m_sleepTimeBuffer[a] = 0;
+		}
+	}
+
+	// Awake bodies wake the particles they touch. While every particle
+	// sleeps the solver is skipped, so refresh the body contacts here to
+	// notice bodies that came close since.
+	if (m_sleepingCount == m_count)
+	{
+		UpdateBodyContacts();
+	}
+	for (int32 k = 0; k < m_bodyContactBuffer.GetCount(); k++)
+	{
+		const b2ParticleBodyContact& contact = m_bodyContactBuffer[k];
+		const b2Body* body = contact.body;
+		if (body->GetType() != b2_staticBody && body->IsAwake())
+		{
+			m_sleepTimeBuffer[contact.index] = 0;
+		}
+	}
+
+	m_sleepingCount = 0;
+	for (int32 i = 0; i < m_count; i++)
+	{
+		if (m_sleepTimeBuffer[i] >= sleepTime)
+		{
+			m_sleepingCount++;
+		}
+	}
+}
+
+void b2ParticleSystem::ResetSleepingVelocities()
+{
+	for (int32 i = 0; i < m_count; i++)
+	{
+		if (IsParticleAsleep(i))
+		{
+			m_velocityBuffer.data[i] = b2Vec2_zero;
+		}
+	}
+}
+
+void b2ParticleSystem::WakeParticles()
+{
+	if (m_sleepTimeBuffer)
+	{
+		memset(m_sleepTimeBuffer, 0, sizeof(*m_sleepTimeBuffer) * m_count);
+	}
+	m_sleepingCount = 0;
+}
+
 void b2ParticleSystem::LimitVelocity(const b2TimeStep& step)
 {
 	float32 criticalVelocitySquared = GetCriticalVelocitySquared(step);
@@ -3798,15 +4443,18 @@ void b2ParticleSystem::SolveColorMixing()
 void b2ParticleSystem::SolveZombie()
 {
 	// removes particles with zombie flag
+	m_contactCandidatesValid = false;
 	int32 newCount = 0;
 	int32* newIndices = (int32*) m_world->m_stackAllocator.Allocate(
 		sizeof(int32) * m_count);
 	uint32 allParticleFlags = 0;
+	bool destroyedSleepingParticle = false;
 	for (int32 i = 0; i < m_count; i++)
 	{
 		int32 flags = m_flagsBuffer.data[i];
 		if (flags & b2_zombieParticle)
 		{
+			destroyedSleepingParticle |= IsParticleAsleep(i);
 			b2DestructionListener * const destructionListener =
 				m_world->m_destructionListener;
 			if ((flags & b2_destructionListenerParticle) &&
@@ -3868,6 +4516,10 @@ void b2ParticleSystem::SolveZombie()
 					m_staticPressureBuffer[newCount] =
 						m_staticPressureBuffer[i];
 				}
+				if (m_sleepTimeBuffer)
+				{
+					m_sleepTimeBuffer[newCount] = m_sleepTimeBuffer[i];
+				}
 				if (m_depthBuffer)
 				{
 					m_depthBuffer[newCount] = m_depthBuffer[i];
@@ -4023,6 +4675,13 @@ void b2ParticleSystem::SolveZombie()
 	m_allParticleFlags = allParticleFlags;
 	m_needsUpdateAllParticleFlags = false;
 
+	// The neighbors of a sleeping particle are not known (their contacts
+	// are not generated), wake everything so they can fill the gap.
+	if (destroyedSleepingParticle)
+	{
+		WakeParticles();
+	}
+
 	// destroy bodies with no particles
 	for (b2ParticleGroup* group = m_groupList; group;)
 	{
@@ -4054,9 +4713,20 @@ void b2ParticleSystem::SolveLifetimes(const b2TimeStep& step)
 	{
 		const ExpirationTimeComparator expirationTimeComparator(
 			expirationTimes);
-		std::sort(expirationTimeIndices,
-				  expirationTimeIndices + particleCount,
-				  expirationTimeComparator);
+		if (m_world->GetDeterministic())
+		{
+			// Particles with equal expiration times must be destroyed in
+			// the same order on every run.
+			std::stable_sort(expirationTimeIndices,
+							 expirationTimeIndices + particleCount,
+							 expirationTimeComparator);
+		}
+		else
+		{
+			std::sort(expirationTimeIndices,
+					  expirationTimeIndices + particleCount,
+					  expirationTimeComparator);
+		}
 		m_expirationTimeBufferRequiresSorting = false;
 	}
 
@@ -4083,6 +4753,7 @@ void b2ParticleSystem::RotateBuffer(int32 start, int32 mid, int32 end)
 		return;
 	}
 	b2Assert(mid >= start && mid <= end);
+	m_contactCandidatesValid = false;
 	struct NewIndices
 	{
 		int32 operator[](int32 i) const
@@ -4147,6 +4818,11 @@ void b2ParticleSystem::RotateBuffer(int32 start, int32 mid, int32 end)
 					m_staticPressureBuffer + mid,
 					m_staticPressureBuffer + end);
 	}
+	if (m_sleepTimeBuffer)
+	{
+		std::rotate(m_sleepTimeBuffer + start, m_sleepTimeBuffer + mid,
+					m_sleepTimeBuffer + end);
+	}
 	if (m_depthBuffer)
 	{
 		std::rotate(m_depthBuffer + start, m_depthBuffer + mid,
@@ -4238,6 +4914,175 @@ void b2ParticleSystem::RotateBuffer(int32 start, int32 mid, int32 end)
 	}
 }
 
+void b2ParticleSystem::ReorderParticles()
+{
+	b2Assert(m_world->IsLocked() == false);
+	if (m_world->IsLocked())
+	{
+		return;
+	}
+	UpdateProxies(m_proxyBuffer);
+	SortProxies(m_proxyBuffer);
+	ReorderBuffers();
+}
+
+// Moves buffer[i] to buffer[newIndices[i]] for every particle.
+template <typename T> void b2ParticleSystem::PermuteBuffer(
+	T* buffer, const int32* newIndices)
+{
+	if (buffer == NULL)
+	{
+		return;
+	}
+	T* scratch = (T*) GetSortScratchBuffer(sizeof(T) * m_count);
+	for (int32 i = 0; i < m_count; i++)
+	{
+		scratch[newIndices[i]] = buffer[i];
+	}
+	memcpy(buffer, scratch, sizeof(T) * m_count);
+}
+
+// Permute the particle buffers into the order of the proxies, which are
+// sorted by tag (rows of cells, left-to-right, top-to-bottom). Particles are
+// only moved within their group's range, or within a run of particles that
+// have no group, so group ranges do not change.
+void b2ParticleSystem::ReorderBuffers()
+{
+	m_stepsSinceReorder = 0;
+	b2Assert(m_proxyBuffer.GetCount() == m_count);
+	if (m_count < 2)
+	{
+		return;
+	}
+
+	int32* segments = (int32*) m_world->m_stackAllocator.Allocate(
+		sizeof(int32) * m_count);
+	int32* cursors = (int32*) m_world->m_stackAllocator.Allocate(
+		sizeof(int32) * m_count);
+	int32* newIndices = (int32*) m_world->m_stackAllocator.Allocate(
+		sizeof(int32) * m_count);
+	int32 segment = 0;
+	for (int32 i = 0; i < m_count; i++)
+	{
+		const b2ParticleGroup* group = m_groupBuffer[i];
+		if (group)
+		{
+			segment = group->m_firstIndex;
+		}
+		else if (i > 0 && m_groupBuffer[i - 1])
+		{
+			segment = i;
+		}
+		segments[i] = segment;
+		cursors[i] = i;
+	}
+	bool moved = false;
+	for (const Proxy* proxy = m_proxyBuffer.Begin();
+		 proxy < m_proxyBuffer.End(); ++proxy)
+	{
+		const int32 i = proxy->index;
+		newIndices[i] = cursors[segments[i]]++;
+		moved |= newIndices[i] != i;
+	}
+
+	if (moved)
+	{
+		m_contactCandidatesValid = false;
+		PermuteBuffer(m_flagsBuffer.data, newIndices);
+		PermuteBuffer(m_lastBodyContactStepBuffer.data, newIndices);
+		PermuteBuffer(m_bodyContactCountBuffer.data, newIndices);
+		PermuteBuffer(m_consecutiveContactStepsBuffer.data, newIndices);
+		PermuteBuffer(m_positionBuffer.data, newIndices);
+		PermuteBuffer(m_velocityBuffer.data, newIndices);
+		PermuteBuffer(m_groupBuffer, newIndices);
+		if (m_hasForce)
+		{
+			PermuteBuffer(m_forceBuffer, newIndices);
+		}
+		PermuteBuffer(m_weightBuffer, newIndices);
+		PermuteBuffer(m_staticPressureBuffer, newIndices);
+		PermuteBuffer(m_sleepTimeBuffer, newIndices);
+		PermuteBuffer(m_depthBuffer, newIndices);
+		PermuteBuffer(m_colorBuffer.data, newIndices);
+		PermuteBuffer(m_userDataBuffer.data, newIndices);
+		PermuteBuffer(m_expirationTimeBuffer.data, newIndices);
+
+		// Update handle indices.
+		if (m_handleIndexBuffer.data)
+		{
+			PermuteBuffer(m_handleIndexBuffer.data, newIndices);
+			for (int32 i = 0; i < m_count; i++)
+			{
+				b2ParticleHandle * const handle = m_handleIndexBuffer.data[i];
+				if (handle) handle->SetIndex(i);
+			}
+		}
+
+		// Update expiration time buffer indices.
+		if (m_indexByExpirationTimeBuffer.data)
+		{
+			int32* const indexByExpirationTime =
+				m_indexByExpirationTimeBuffer.data;
+			for (int32 i = 0; i < m_count; i++)
+			{
+				indexByExpirationTime[i] = newIndices[indexByExpirationTime[i]];
+			}
+		}
+
+		// update proxies
+		for (int32 k = 0; k < m_proxyBuffer.GetCount(); k++)
+		{
+			Proxy& proxy = m_proxyBuffer.Begin()[k];
+			proxy.index = newIndices[proxy.index];
+		}
+
+		// update contacts
+		for (int32 k = 0; k < m_contactBuffer.GetCount(); k++)
+		{
+			b2ParticleContact& contact = m_contactBuffer[k];
+			contact.SetIndices(newIndices[contact.GetIndexA()],
+							   newIndices[contact.GetIndexB()]);
+		}
+
+		// update particle-body contacts
+		for (int32 k = 0; k < m_bodyContactBuffer.GetCount(); k++)
+		{
+			b2ParticleBodyContact& contact = m_bodyContactBuffer[k];
+			contact.index = newIndices[contact.index];
+		}
+
+		// update stuck particle candidates
+		for (int32 k = 0; k < m_stuckParticleBuffer.GetCount(); k++)
+		{
+			int32& particle = m_stuckParticleBuffer[k];
+			particle = newIndices[particle];
+		}
+
+		// update pairs and triads, keeping them sorted by index
+		for (int32 k = 0; k < m_pairBuffer.GetCount(); k++)
+		{
+			b2ParticlePair& pair = m_pairBuffer[k];
+			pair.indexA = newIndices[pair.indexA];
+			pair.indexB = newIndices[pair.indexB];
+		}
+		std::sort(m_pairBuffer.Begin(), m_pairBuffer.End(),
+				  ComparePairIndices);
+		for (int32 k = 0; k < m_triadBuffer.GetCount(); k++)
+		{
+			b2ParticleTriad& triad = m_triadBuffer[k];
+			triad.indexA = newIndices[triad.indexA];
+			triad.indexB = newIndices[triad.indexB];
+			triad.indexC = newIndices[triad.indexC];
+		}
+		std::sort(m_triadBuffer.Begin(), m_triadBuffer.End(),
+				  CompareTriadIndices);
+	}
+
+	m_world->m_stackAllocator.Free(newIndices);
+	m_world->m_stackAllocator.Free(cursors);
+	m_world->m_stackAllocator.Free(segments);
+}
+
 /// Set the lifetime (in seconds) of a particle relative to the current
 /// time.
 void b2ParticleSystem::SetParticleLifetime(const int32 index,
@@ -4601,6 +5446,215 @@ void b2ParticleSystem::RayCast(b2RayCastCallback* callback,
 	}
 }
 
+/// Collects the particles inside an AABB for the bulk QueryAABB.
+class b2ParticleIndexWriter
+{
+public:
+	b2ParticleIndexWriter(const b2AABB& aabb, const b2Vec2* positions,
+						  int32* indices, int32 capacity)
+	{
+		m_aabb = aabb;
+		m_positions = positions;
+		m_indices = indices;
+		m_capacity = capacity;
+		m_count = 0;
+	}
+
+	bool Visit(int32 i)
+	{
+		const b2Vec2& p = m_positions[i];
+		if (m_aabb.lowerBound.x < p.x && p.x < m_aabb.upperBound.x &&
+			m_aabb.lowerBound.y < p.y && p.y < m_aabb.upperBound.y)
+		{
+			if (m_count < m_capacity)
+			{
+				m_indices[m_count] = i;
+			}
+			m_count++;
+		}
+		return true;
+	}
+
+	int32 GetCount() const { return m_count; }
+
+private:
+	b2AABB m_aabb;
+	const b2Vec2* m_positions;
+	int32* m_indices;
+	int32 m_capacity;
+	int32 m_count;
+};
+
+/// Collects the particles hit by a segment for the bulk RayCast.
+class b2ParticleRayCastWriter
+{
+public:
+	b2ParticleRayCastWriter(const b2Vec2& point1, const b2Vec2& point2,
+							const b2Vec2* positions, float32 squaredDiameter,
+							int32* indices, float32* fractions,
+							int32 capacity)
+	{
+		m_point1 = point1;
+		m_v = point2 - point1;
+		m_v2 = b2Dot(m_v, m_v);
+		m_positions = positions;
+		m_squaredDiameter = squaredDiameter;
+		m_indices = indices;
+		m_fractions = fractions;
+		m_capacity = capacity;
+		m_count = 0;
+	}
+
+	bool Visit(int32 i)
+	{
+		// Same intersection as the callback version of RayCast.
+		b2Vec2 p = m_point1 - m_positions[i];
+		float32 pv = b2Dot(p, m_v);
+		float32 p2 = b2Dot(p, p);
+		float32 determinant = pv * pv - m_v2 * (p2 - m_squaredDiameter);
+		if (determinant < 0)
+		{
+			return true;
+		}
+		float32 sqrtDeterminant = b2Sqrt(determinant);
+		float32 t = (-pv - sqrtDeterminant) / m_v2;
+		if (t > 1)
+		{
+			return true;
+		}
+		if (t < 0)
+		{
+			t = (-pv + sqrtDeterminant) / m_v2;
+			if (t < 0 || t > 1)
+			{
+				return true;
+			}
+		}
+		if (m_count < m_capacity)
+		{
+			m_indices[m_count] = i;
+			if (m_fractions)
+			{
+				m_fractions[m_count] = t;
+			}
+		}
+		m_count++;
+		return true;
+	}
+
+	int32 GetCount() const { return m_count; }
+
+private:
+	b2Vec2 m_point1;
+	b2Vec2 m_v;
+	float32 m_v2;
+	const b2Vec2* m_positions;
+	float32 m_squaredDiameter;
+	int32* m_indices;
+	float32* m_fractions;
+	int32 m_capacity;
+	int32 m_count;
+};
+
+template <typename T>
+void b2ParticleSystem::VisitParticlesNearAABB(const b2AABB& aabb,
+											  T* visitor) const
+{
+	if (m_proxyBuffer.GetCount() == 0)
+	{
+		return;
+	}
+	// The proxies were tagged at the start of the last step, so include the
+	// neighbouring cells as GetInsideBoundsEnumerator does.
+	uint32 lowerTag = computeTag(m_inverseDiameter * aabb.lowerBound.x - 1,
+								 m_inverseDiameter * aabb.lowerBound.y - 1);
+	uint32 upperTag = computeTag(m_inverseDiameter * aabb.upperBound.x + 1,
+								 m_inverseDiameter * aabb.upperBound.y + 1);
+	const Proxy* beginProxy = m_proxyBuffer.Begin();
+	const Proxy* endProxy = m_proxyBuffer.End();
+	const Proxy* firstProxy = std::lower_bound(beginProxy, endProxy, lowerTag);
+	const Proxy* lastProxy = std::upper_bound(firstProxy, endProxy, upperTag);
+	uint32 xLower = lowerTag & xMask;
+	uint32 xUpper = upperTag & xMask;
+	uint32 yLower = lowerTag & yMask;
+	uint32 yUpper = upperTag & yMask;
+	int32 rowCount = (int32)((yUpper - yLower) >> yShift) + 1;
+
+	if (rowCount * 16 > lastProxy - firstProxy)
+	{
+		// Few proxies per row, a linear scan beats a search per row.
+		for (const Proxy* proxy = firstProxy; proxy < lastProxy; ++proxy)
+		{
+			uint32 xTag = proxy->tag & xMask;
+			if (xLower <= xTag && xTag <= xUpper &&
+				!visitor->Visit(proxy->index))
+			{
+				return;
+			}
+		}
+		return;
+	}
+
+	const uint32 rowStep = 1u << yShift;
+	for (uint32 row = yLower; ; row += rowStep)
+	{
+		const Proxy* rowFirst =
+			std::lower_bound(firstProxy, lastProxy, row + xLower);
+		const Proxy* rowLast =
+			std::upper_bound(rowFirst, lastProxy, row + xUpper);
+		for (const Proxy* proxy = rowFirst; proxy < rowLast; ++proxy)
+		{
+			if (!visitor->Visit(proxy->index))
+			{
+				return;
+			}
+		}
+		firstProxy = rowLast;
+		if (row == yUpper)
+		{
+			break;
+		}
+	}
+}
+
+int32 b2ParticleSystem::QueryAABB(const b2AABB& aabb, int32* indices,
+								  int32 capacity) const
+{
+	b2Assert(indices || capacity == 0);
+	b2ParticleIndexWriter writer(aabb, m_positionBuffer.data, indices,
+								 capacity);
+	VisitParticlesNearAABB(aabb, &writer);
+	return writer.GetCount();
+}
+
+int32 b2ParticleSystem::QueryShapeAABB(const b2Shape& shape,
+									   const b2Transform& xf,
+									   int32* indices, int32 capacity) const
+{
+	b2AABB aabb;
+	shape.ComputeAABB(&aabb, xf, 0);
+	return QueryAABB(aabb, indices, capacity);
+}
+
+int32 b2ParticleSystem::RayCast(const b2Vec2& point1, const b2Vec2& point2,
+								int32* indices, float32* fractions,
+								int32 capacity) const
+{
+	b2Assert(indices || capacity == 0);
+	if (point1 == point2)
+	{
+		return 0;
+	}
+	b2AABB aabb;
+	aabb.lowerBound = b2Min(point1, point2);
+	aabb.upperBound = b2Max(point1, point2);
+	b2ParticleRayCastWriter writer(point1, point2, m_positionBuffer.data,
+								   m_squaredDiameter, indices, fractions,
+								   capacity);
+	VisitParticlesNearAABB(aabb, &writer);
+	return writer.GetCount();
+}
+
 float32 b2ParticleSystem::ComputeCollisionEnergy() const
 {
 	float32 sum_v2 = 0;
@@ -178,6 +178,12 @@ struct b2ParticleSystemDef
 		colorMixingStrength = 0.5f;
 		destroyByAge = true;
 		lifetimeGranularity = 1.0f / 60.0f;
+		reorderInterval = 0;
+		contactSkin = 0.0f;
+		maxAdaptiveIterations = 0;
+		courantNumber = 0.5f;
+		sleepVelocity = 0.0f;
+		sleepTime = 0.5f;
 	}
 
 	/// Enable strict Particle/Body contact check.
@@ -275,6 +281,31 @@ struct b2ParticleSystemDef
 	/// With the value set to 1/60 the maximum lifetime or age of a particle is
 	/// 2.27 years.
 	float32 lifetimeGranularity;
+
+	/// Reorder the particle buffers spatially every this many steps.
+	/// 0 disables reordering. See SetReorderInterval for details.
+	int32 reorderInterval;
+
+	/// Extra distance, in Box2D units, added to the particle diameter when
+	/// caching neighbor candidates. 0 disables the cache.
+	/// See SetContactSkin for details.
+	float32 contactSkin;
+
+	/// Upper bound of the particle iterations chosen every step from the
+	/// fastest particle. 0 uses the count passed to b2World::Step.
+	/// See SetAdaptiveIterations for details.
+	int32 maxAdaptiveIterations;
+
+	/// Fraction of the particle diameter the fastest particle may travel
+	/// per adaptive iteration. See SetAdaptiveIterations for details.
+	float32 courantNumber;
+
+	/// Speed, in Box2D units per second, below which particles may fall
+	/// asleep. 0 disables sleeping. See SetSleepVelocity for details.
+	float32 sleepVelocity;
+
+	/// Seconds a particle has to stay slow before it falls asleep.
+	float32 sleepTime;
 };
 
 
@@ -290,6 +321,15 @@ public:
 	/// @return the index of the particle.
 	int32 CreateParticle(const b2ParticleDef& def);
 
+	/// Create several particles at once, for example a frame's worth of
+	/// particles from an emitter. The buffers grow at most once and, when
+	/// the system is full and destruction by age is enabled, room is made
+	/// for all of the particles with a single compaction instead of one per
+	/// particle.
+	/// @warning This function is locked during callbacks.
+	/// @return the number of particles created.
+	int32 CreateParticles(const b2ParticleDef* defs, int32 count);
+
 	/// Retrieve a handle to the particle at the specified index.
 	/// Please see #b2ParticleHandle for why you might want a handle.
 	const b2ParticleHandle* GetParticleHandleFromIndex(const int32 index);
@@ -309,6 +349,33 @@ public:
 	/// particle is destroyed.
 	void DestroyParticle(int32 index, bool callDestructionListener);
 
+	/// Destroy a list of particles.
+	/// The particles are removed after the next step, all in the same pass.
+	/// Cheaper than calling DestroyParticle() for each of them.
+	/// @param Indices of the particles to destroy.
+	/// @param Number of indices.
+	/// @param Whether to call the destruction listener just before the
+	/// particles are destroyed.
+	/// @return Number of particles that were not already being destroyed.
+	int32 DestroyParticles(const int32* indices, int32 count,
+						   bool callDestructionListener);
+	int32 DestroyParticles(const int32* indices, int32 count)
+	{
+		return DestroyParticles(indices, count, false);
+	}
+
+	/// Destroy every particle immediately. Groups that cannot be empty
+	/// (see b2_particleGroupCanBeEmpty) are destroyed too. Much cheaper
+	/// than destroying the particles one at a time since nothing has to be
+	/// compacted.
+	/// @param Whether to call the destruction listener for each particle.
+	/// @warning This function is locked during callbacks.
+	void DestroyAllParticles(bool callDestructionListener);
+	void DestroyAllParticles()
+	{
+		DestroyAllParticles(false);
+	}
+
 	/// Destroy the Nth oldest particle in the system.
 	/// The particle is removed after the next b2World::Step().
 	/// @param Index of the Nth oldest particle to destroy, 0 will destroy the
@@ -610,6 +677,87 @@ public:
 	/// when the maximum number of particles are present in the system.
 	bool GetDestructionByAge() const;
 
+	/// Periodically permute the particle buffers so that particles close to
+	/// each other in the world are close to each other in memory, which
+	/// makes the contact and solver loops walk the buffers mostly in order.
+	/// Particles only move within their group's index range (or within a
+	/// run of particles without a group), and handles stay valid. Indices
+	/// returned before a reorder are not; use b2ParticleHandle to track
+	/// particles across steps. 0 (the default) disables reordering.
+	void SetReorderInterval(int32 steps);
+	/// Get the number of steps between reorders, 0 if disabled.
+	int32 GetReorderInterval() const;
+
+	/// Reorder the particle buffers now. See SetReorderInterval().
+	void ReorderParticles();
+
+	/// Cache particle neighbor candidates (a Verlet list) found within the
+	/// particle diameter plus 'skin', and compute contacts from the cache
+	/// until some particle has moved more than half the skin. Larger skins
+	/// rebuild less often but test more candidates per iteration. This
+	/// pays off for slow particles (settled liquid, powder, soft bodies);
+	/// while particles move fast the regular search is used instead.
+	/// 0 (the default) finds contacts from scratch every iteration.
+	void SetContactSkin(float32 skin);
+	/// Get the contact skin. See SetContactSkin().
+	float32 GetContactSkin() const;
+
+	/// Choose the number of particle iterations every step instead of using
+	/// the count passed to b2World::Step. The count is picked so that the
+	/// fastest particle, including what gravity adds during the step,
+	/// travels at most courantNumber particle diameters per iteration
+	/// (a CFL condition), clamped to [1, maxIterations]. Calm scenes then
+	/// run a single iteration while violent ones get as many as the budget
+	/// allows. 0 (the default) disables adaptive iterations.
+	void SetAdaptiveIterations(int32 maxIterations);
+	/// Get the adaptive iteration budget, 0 if disabled.
+	int32 GetAdaptiveIterations() const;
+
+	/// Set the fraction of the particle diameter the fastest particle may
+	/// travel per adaptive iteration. Smaller is more stable and more
+	/// expensive. The default is 0.5.
+	void SetCourantNumber(float32 courantNumber);
+	/// Get the courant number. See SetCourantNumber().
+	float32 GetCourantNumber() const;
+
+	/// Get the number of particle iterations run by the last step.
+	/// b2Profile::particleIterations reports the largest count of all
+	/// the particle systems of the world.
+	int32 GetIterationCount() const;
+
+	/// Let particles that stayed slower than 'speed' for the sleep time,
+	/// with no moving neighbor, fall asleep. Sleeping particles are frozen:
+	/// they keep the weight they had and act as static obstacles for the
+	/// awake ones, contacts between two sleeping particles are not
+	/// generated and once the whole system sleeps the particle solver is
+	/// skipped. A particle is woken by a neighbor moving faster than
+	/// 'speed', by an awake dynamic body touching it, by a force or by
+	/// setting its velocity above 'speed'.
+	/// Particles with pair or triad behaviors, static pressure, tensile
+	/// particles and particles of rigid or solid groups never sleep.
+	/// Destroying a sleeping particle wakes the whole system. Contacts
+	/// between sleeping particles are not reported to the contact
+	/// listener. 0 (the default) disables sleeping.
+	void SetSleepVelocity(float32 speed);
+	/// Get the sleep velocity, 0 if sleeping is disabled.
+	float32 GetSleepVelocity() const;
+
+	/// Set how many seconds a particle has to stay slow before it falls
+	/// asleep. The default is 0.5 seconds.
+	void SetSleepTime(float32 seconds);
+	/// Get the sleep time. See SetSleepTime().
+	float32 GetSleepTime() const;
+
+	/// Wake all the particles. Call this after moving particles directly
+	/// or changing the world gravity.
+	void WakeParticles();
+
+	/// Get the number of particles asleep during the last step.
+	int32 GetSleepingParticleCount() const;
+
+	/// Is the particle asleep? See SetSleepVelocity().
+	bool IsParticleAsleep(int32 index) const;
+
 	/// Get the array of particle expiration times indexed by particle index.
 	/// GetParticleCount() items are in the returned array.
 	const int32* GetExpirationTimeBuffer();
@@ -691,6 +839,38 @@ public:
 	void RayCast(b2RayCastCallback* callback, const b2Vec2& point1,
 				 const b2Vec2& point2) const;
 
+	/// Write the indices of the particles inside the provided AABB to a
+	/// caller owned buffer. Unlike the callback version there is no virtual
+	/// call per particle and the sorted proxies are searched one row of
+	/// cells at a time, so only the particles near the AABB are visited.
+	/// @param aabb the query box.
+	/// @param indices buffer receiving the particle indices, in no
+	/// particular order.
+	/// @param capacity the number of indices the buffer can hold.
+	/// @return the number of particles inside the AABB. This can be larger
+	/// than capacity, in which case only the first capacity indices are
+	/// written.
+	int32 QueryAABB(const b2AABB& aabb, int32* indices, int32 capacity) const;
+
+	/// Write the indices of the particles inside the provided shape's AABB
+	/// to a caller owned buffer. See QueryAABB.
+	int32 QueryShapeAABB(const b2Shape& shape, const b2Transform& xf,
+						 int32* indices, int32 capacity) const;
+
+	/// Write the indices of all the particles in the path of the ray to a
+	/// caller owned buffer, in no particular order. Hits are found as in the
+	/// callback version.
+	/// @param point1 the ray starting point
+	/// @param point2 the ray ending point
+	/// @param indices buffer receiving the particle indices.
+	/// @param fractions optional buffer receiving the fraction along the
+	/// ray of each hit, may be NULL.
+	/// @param capacity the number of entries the buffers can hold.
+	/// @return the number of particles hit. This can be larger than
+	/// capacity, in which case only the first capacity hits are written.
+	int32 RayCast(const b2Vec2& point1, const b2Vec2& point2,
+				  int32* indices, float32* fractions, int32 capacity) const;
+
 	/// Compute the axis-aligned bounding box for all particles contained
 	/// within this particle system.
 	/// @param aabb Returns the axis-aligned bounding box of the system.
@@ -760,6 +940,12 @@ private:
 		int32 userSuppliedCapacity;
 	};
 
+	/// Pair of particles close enough to become a contact.
+	struct ContactCandidate
+	{
+		int32 indexA, indexB;
+	};
+
 	/// Used for detecting particle contacts
 	struct Proxy
 	{
@@ -844,6 +1030,15 @@ private:
 		int32 index;
 	};
 
+	/// All particle types that never sleep, their behavior depends on
+	/// every neighbor. See SetSleepVelocity().
+	static const int32 k_noSleepFlags =
+		b2_springParticle |
+		b2_elasticParticle |
+		b2_barrierParticle |
+		b2_reactiveParticle |
+		b2_staticPressureParticle |
+		b2_tensileParticle;
 	/// All particle types that require creating pairs
 	static const int32 k_pairFlags =
 		b2_springParticle |
@@ -929,6 +1124,13 @@ private:
 
 	InsideBoundsEnumerator GetInsideBoundsEnumerator(const b2AABB& aabb) const;
 
+	/// Call visitor->Visit(index) for the particles whose proxy lies within
+	/// a cell of aabb, until Visit returns false. Large boxes are walked one
+	/// row of cells at a time so the proxies left and right of the box are
+	/// skipped.
+	template <typename T>
+	void VisitParticlesNearAABB(const b2AABB& aabb, T* visitor) const;
+
 	void UpdateAllParticleFlags();
 	void UpdateAllGroupFlags();
 	void AddContact(int32 a, int32 b,
@@ -948,6 +1150,15 @@ private:
 		b2GrowableBuffer<b2ParticleContact>& contacts) const;
 	void FindContacts(
 		b2GrowableBuffer<b2ParticleContact>& contacts) const;
+	bool ContactCandidatesNeedUpdate() const;
+	void AddContactCandidate(int32 a, int32 b, float32 squaredRange,
+		b2GrowableBuffer<b2ParticleContact>& contacts);
+	void UpdateContactCandidates(
+		b2GrowableBuffer<b2ParticleContact>& contacts);
+	void FindContactsFromCandidates(
+		b2GrowableBuffer<b2ParticleContact>& contacts) const;
+	void FindContactsWithCandidates(
+		b2GrowableBuffer<b2ParticleContact>& contacts);
 	static void UpdateProxyTags(
 		const uint32* const tags,
 		b2GrowableBuffer<Proxy>& proxies);
@@ -961,6 +1172,7 @@ private:
 	void UpdateProxies_Simd(b2GrowableBuffer<Proxy>& proxies) const;
 	void UpdateProxies(b2GrowableBuffer<Proxy>& proxies) const;
 	void SortProxies(b2GrowableBuffer<Proxy>& proxies) const;
+	void* GetSortScratchBuffer(int32 size) const;
 	void FilterContacts(b2GrowableBuffer<b2ParticleContact>& contacts);
 	void NotifyContactListenerPreContact(
 		b2ParticlePairSet* particlePairs) const;
@@ -970,8 +1182,14 @@ private:
 		FixtureParticleSet* fixtureSet) const;
 	void NotifyBodyContactListenerPostContact(FixtureParticleSet& fixtureSet);
 	void UpdateBodyContacts();
+	/// Drop the particle / body contacts of a body that is being destroyed,
+	/// so nothing reads it before the next UpdateBodyContacts().
+	void DestroyBodyContacts(const b2Body* body);
 
 	void Solve(const b2TimeStep& step);
+	int32 ComputeAdaptiveIterations(const b2TimeStep& step) const;
+	void UpdateSleep(const b2TimeStep& step);
+	void ResetSleepingVelocities();
 	void SolveCollision(const b2TimeStep& step);
 	void LimitVelocity(const b2TimeStep& step);
 	void SolveGravity(const b2TimeStep& step);
@@ -998,6 +1216,9 @@ private:
 	/// SetParticleLifetime().
 	void SolveLifetimes(const b2TimeStep& step);
 	void RotateBuffer(int32 start, int32 mid, int32 end);
+	void ReorderBuffers();
+	template <typename T> void PermuteBuffer(T* buffer,
+											 const int32* newIndices);
 
 	float32 GetCriticalVelocity(const b2TimeStep& step) const;
 	float32 GetCriticalVelocitySquared(const b2TimeStep& step) const;
@@ -1028,8 +1249,6 @@ private:
 	void SetGroupFlags(b2ParticleGroup* group, uint32 flags);
 
 	void RemoveSpuriousBodyContacts();
-	static bool BodyContactCompare(const b2ParticleBodyContact& lhs,
-								   const b2ParticleBodyContact& rhs);
 
 	void DetectStuckParticle(int32 particle);
 
@@ -1073,6 +1292,8 @@ private:
 	bool m_needsUpdateAllGroupFlags;
 	bool m_hasForce;
 	int32 m_iterationIndex;
+	int32 m_iterationCount;
+	int32 m_stepsSinceReorder;
 	float32 m_inverseDensity;
 	float32 m_particleDiameter;
 	float32 m_inverseDiameter;
@@ -1104,6 +1325,11 @@ private:
 	/// as a temporary buffer for vector values.  It will be reallocated on
 	/// subsequent CreateParticle() calls.
 	b2Vec2* m_accumulation2Buffer;
+	/// Seconds each particle has been slow, see SetSleepVelocity(). A
+	/// particle is asleep once this reaches sleepTime.
+	float32* m_sleepTimeBuffer;
+	/// Number of particles asleep since the last Solve().
+	int32 m_sleepingCount;
 	/// When any particle groups have the flag b2_solidParticleGroup,
 	/// m_depthBuffer is first allocated and populated in ComputeDepth() and
 	/// used in SolveSolid(). It will be reallocated on subsequent
@@ -1120,7 +1346,20 @@ private:
 	UserOverridableBuffer<int32> m_consecutiveContactStepsBuffer;
 	b2GrowableBuffer<int32> m_stuckParticleBuffer;
 	b2GrowableBuffer<Proxy> m_proxyBuffer;
+	/// Scratch space for the radix sorts, kept between steps so that large
+	/// systems do not allocate on every particle iteration.
+	mutable void* m_sortScratchBuffer;
+	mutable int32 m_sortScratchCapacity;
 	b2GrowableBuffer<b2ParticleContact> m_contactBuffer;
+	/// Neighbor candidates and the positions they were computed from.
+	/// See SetContactSkin().
+	b2GrowableBuffer<ContactCandidate> m_contactCandidateBuffer;
+	b2GrowableBuffer<Proxy> m_contactCandidateProxyBuffer;
+	b2GrowableBuffer<b2Vec2> m_contactCandidatePositionBuffer;
+	bool m_contactCandidatesValid;
+	int32 m_contactCandidateReuseCount;
+	int32 m_contactCandidateBackoff;
+	int32 m_contactCandidateSkipCount;
 	b2GrowableBuffer<b2ParticleBodyContact> m_bodyContactBuffer;
 	b2GrowableBuffer<b2ParticlePair> m_pairBuffer;
 	b2GrowableBuffer<b2ParticleTriad> m_triadBuffer;
@@ -1280,8 +1519,92 @@ inline bool b2ParticleSystem::GetStrictContactCheck() const
 	return m_def.strictContactCheck;
 }
 
+inline void b2ParticleSystem::SetReorderInterval(int32 steps)
+{
+	b2Assert(steps >= 0);
+	m_def.reorderInterval = steps;
+}
+
+inline int32 b2ParticleSystem::GetReorderInterval() const
+{
+	return m_def.reorderInterval;
+}
+
+inline void b2ParticleSystem::SetContactSkin(float32 skin)
+{
+	b2Assert(skin >= 0.0f);
+	m_def.contactSkin = skin;
+	m_contactCandidatesValid = false;
+}
+
+inline float32 b2ParticleSystem::GetContactSkin() const
+{
+	return m_def.contactSkin;
+}
+
+inline void b2ParticleSystem::SetAdaptiveIterations(int32 maxIterations)
+{
+	b2Assert(maxIterations >= 0);
+	m_def.maxAdaptiveIterations = maxIterations;
+}
+
+inline int32 b2ParticleSystem::GetAdaptiveIterations() const
+{
+	return m_def.maxAdaptiveIterations;
+}
+
+inline void b2ParticleSystem::SetCourantNumber(float32 courantNumber)
+{
+	b2Assert(courantNumber > 0.0f);
+	m_def.courantNumber = courantNumber;
+}
+
+inline float32 b2ParticleSystem::GetCourantNumber() const
+{
+	return m_def.courantNumber;
+}
+
+inline int32 b2ParticleSystem::GetIterationCount() const
+{
+	return m_iterationCount;
+}
+
+inline void b2ParticleSystem::SetSleepVelocity(float32 speed)
+{
+	b2Assert(speed >= 0.0f);
+	m_def.sleepVelocity = speed;
+}
+
+inline float32 b2ParticleSystem::GetSleepVelocity() const
+{
+	return m_def.sleepVelocity;
+}
+
+inline void b2ParticleSystem::SetSleepTime(float32 seconds)
+{
+	b2Assert(seconds > 0.0f);
+	m_def.sleepTime = seconds;
+}
+
+inline float32 b2ParticleSystem::GetSleepTime() const
+{
+	return m_def.sleepTime;
+}
+
+inline int32 b2ParticleSystem::GetSleepingParticleCount() const
+{
+	return m_sleepingCount;
+}
+
+inline bool b2ParticleSystem::IsParticleAsleep(int32 index) const
+{
+	return m_sleepingCount > 0 &&
+		m_sleepTimeBuffer[index] >= m_def.sleepTime;
+}
+
 inline void b2ParticleSystem::SetRadius(float32 radius)
 {
+	m_contactCandidatesValid = false;
 	m_particleDiameter = 2 * radius;
 	m_squaredDiameter = m_particleDiameter * m_particleDiameter;
 	m_inverseDiameter = 1 / m_particleDiameter;
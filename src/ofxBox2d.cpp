@@ -41,6 +41,8 @@ ofxBox2d::ofxBox2d() {
     enableContactEvents = false;
 	world = NULL;
 	m_bomb = NULL;
+	bDeterministic = false;
+	stateHash = 0;
 	
 	ground = NULL;
 	mainBody = NULL;
@@ -101,7 +103,7 @@ int ofxBox2d::calculateParticleIterations(float32 gravity, float32 radius, float
 
 // init
 // ------------------------------------------------------
-void ofxBox2d::init(float _hz, float _gx, float _gy) {
+void ofxBox2d::init(float _hz, float _gx, float _gy, bool _deterministic) {
 	
 	// settings
 	bHasContactListener = false;
@@ -128,6 +130,11 @@ void ofxBox2d::init(float _hz, float _gx, float _gy) {
 	world = new b2World(b2Vec2(gravity.x, gravity.y));
     world->SetAllowSleeping(doSleep);
 	
+	// determinism
+	bDeterministic = _deterministic;
+	world->SetDeterministic(bDeterministic);
+	stateHash = world->ComputeStateHash();
+	
 	// set the hz and interaction cycles
 	hz = _hz;
 	velocityIterations = 8;
@@ -303,15 +310,15 @@ int	ofxBox2d::getJointCount() {
 void ofxBox2d::wakeupShapes() {
 	VERIFY_WORLD_INITED();
 	
-    b2Body* bodies = world->GetBodyList();
-    while(bodies) {
-        b2Body* b = bodies;
-        if(b) {
-            if( !b->IsAwake() ) b->SetAwake(true);
-        }
-        bodies = bodies->GetNext();
+    for (int i=0; i<world->GetBodyCount(); i++) {
+        b2Body* b = world->GetBody(i);
+        if( !b->IsAwake() ) b->SetAwake(true);
     }
     
+    // sleeping particles too
+    for (b2ParticleSystem* p = world->GetParticleSystemList(); p; p = p->GetNext()) {
+        p->WakeParticles();
+    }
 }
 
 // ------------------------------------------------------
@@ -448,6 +455,30 @@ void ofxBox2d::update() {
 	VERIFY_WORLD_INITED();
 	
 	world->Step(getTimeStep(), velocityIterations, positionIterations, particleIterations);
+	if (bDeterministic) {
+		stateHash = world->ComputeStateHash();
+	}
+}
+
+// ------------------------------------------------------
+bool ofxBox2d::bakeScene(string path) {
+	if (!world) {
+		ofLogWarning(__FUNCTION__) << "World not inited";
+		return false;
+	}
+	return ofxBox2dScene::bake(world, path);
+}
+
+// ------------------------------------------------------
+bool ofxBox2d::loadScene(string path) {
+	if (!world) {
+		ofLogWarning(__FUNCTION__) << "World not inited";
+		return false;
+	}
+	ofxBox2dScene scene;
+	if (!scene.load(path)) return false;
+	scene.create(world);
+	return true;
 }
 
 // ------------------------------------------------------
@@ -455,6 +486,81 @@ float ofxBox2d::getTimeStep() {
     return hz > 0.0f ? 1.0f / hz : 0.0f;
 }
 
+// ------------------------------------------------------
+uint64 ofxBox2d::getStateHash() {
+	if (!world) {
+		ofLogWarning(__FUNCTION__) << "World not inited";
+		return 0;
+	}
+	// in deterministic mode the hash is taken once per update()
+	return bDeterministic ? stateHash : world->ComputeStateHash();
+}
+
+// ------------------------------------------------------ 
+void ofxBox2d::setGridBroadPhase(float cellSize) {
+	VERIFY_WORLD_INITED();
+	if (world->GetProxyCount() > 0) {
+		ofLogWarning(__FUNCTION__) << "Broad-phase can only be changed before shapes are added";
+		return;
+	}
+	world->SetBroadPhaseType(b2BroadPhase::e_spatialHash, toB2d(cellSize));
+}
+
+// ------------------------------------------------------ 
+bool ofxBox2d::isGridBroadPhase() {
+	if (!world) {
+		ofLogWarning(__FUNCTION__) << "World not inited";
+		return false;
+	}
+	return world->GetBroadPhaseType() == b2BroadPhase::e_spatialHash;
+}
+
+// ------------------------------------------------------ 
+void ofxBox2d::setWideContactSolver(bool wide) {
+	VERIFY_WORLD_INITED();
+	world->SetWideContactSolver(wide);
+}
+
+// ------------------------------------------------------ 
+bool ofxBox2d::isWideContactSolver() {
+	if (!world) {
+		ofLogWarning(__FUNCTION__) << "World not inited";
+		return false;
+	}
+	return world->GetWideContactSolver();
+}
+
+// ------------------------------------------------------ 
+void ofxBox2d::setSpeculativeContacts(bool speculative) {
+	VERIFY_WORLD_INITED();
+	world->SetSpeculativeContacts(speculative);
+}
+
+// ------------------------------------------------------ 
+bool ofxBox2d::isSpeculativeContacts() {
+	if (!world) {
+		ofLogWarning(__FUNCTION__) << "World not inited";
+		return false;
+	}
+	return world->GetSpeculativeContacts();
+}
+
+// ------------------------------------------------------ 
+void ofxBox2d::setSolverThreads(int threads, int islandSize) {
+	VERIFY_WORLD_INITED();
+	world->SetThreadCount(MAX(threads, 1));
+	world->SetParallelIslandThreshold(islandSize);
+}
+
+// ------------------------------------------------------ 
+int ofxBox2d::getSolverThreads() {
+	if (!world) {
+		ofLogWarning(__FUNCTION__) << "World not inited";
+		return 1;
+	}
+	return world->GetThreadCount();
+}
+
 // ------------------------------------------------------ 
 void ofxBox2d::drawGround() {
 	if(ground == NULL) return;
@@ -474,4 +580,19 @@ void ofxBox2d::draw() {
 	drawGround();
 }
 
+// ------------------------------------------------------
+void ofxBox2d::drawDebug() {
+	VERIFY_WORLD_INITED();
+	debugRender.setScale(scale);
+	world->SetDebugDraw(&debugRender);
+	world->DrawDebugData();
+	debugRender.flush();
+}
+
+// ------------------------------------------------------
+void ofxBox2d::drawVisible(const ofRectangle & viewport) {
+	VERIFY_WORLD_INITED();
+	viewRender.draw(world, viewport);
+}
+
 #undef VERIFY_WORLD_INITED
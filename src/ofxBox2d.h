@@ -11,7 +11,9 @@
 
 #include "ofxBox2dJoint.h"
 #include "ofxBox2dRender.h"
+#include "ofxBox2dViewRender.h"
 #include "ofxBox2dContactListener.h"
+#include "ofxBox2dScene.h"
 
 class ofxBox2dContactArgs : public ofEventArgs {
 public:
@@ -29,6 +31,8 @@ private:
 	int					velocityIterations;
 	int					positionIterations;
 	int					particleIterations;
+	bool				bDeterministic;
+	uint64				stateHash;
 	ofPoint				gravity;
 	static float		scale;
 	
@@ -54,6 +58,7 @@ public:
 	// b2AABB				worldAABB;
 	b2World *			world;
 	ofxBox2dRender		debugRender;
+	ofxBox2dViewRender	viewRender;
 
 	bool				doSleep;
 	bool				bEnableGrabbing;
@@ -80,7 +85,9 @@ public:
 	~ofxBox2d();
 	
 	// init box2d with hz (fps) gravity x/y
-	void init(float _hz=60.0f, float _gx=0.0f, float _gy=10.0f);
+	// deterministic enforces stable orderings inside the solver so that
+	// identical inputs give bit-identical results (replays, lockstep sync).
+	void init(float _hz=60.0f, float _gx=0.0f, float _gy=10.0f, bool _deterministic=false);
 	
 	// clear all bodies, joints
 	void clear();
@@ -140,6 +147,11 @@ public:
     // get timestep
     float getTimeStep();
     
+	// hash of all body and particle positions/velocities after the last
+	// update(). compare between machines to catch desyncs in deterministic mode.
+	uint64 getStateHash();
+	bool isDeterministic() { return bDeterministic; }
+    
 	// grabbing of shapes
 	void enableGrabbing()  { bEnableGrabbing = true;  };
 	void disableGrabbing() { bEnableGrabbing = false; };
@@ -153,6 +165,28 @@ public:
 	// set iterations for vel, and pos
 	void setIterations(int velocityTimes, int positionTimes);
 	
+	// switch the broad-phase to a uniform grid. cellSize is in pixels, about the
+	// size of a typical shape. call right after init(), before creating shapes.
+	void setGridBroadPhase(float cellSize);
+	bool isGridBroadPhase();
+	
+	// solve contacts in simd batches. faster on big stacks, results differ
+	// slightly from the default solver
+	void setWideContactSolver(bool wide);
+	bool isWideContactSolver();
+	
+	// keep fast shapes from tunneling with speculative contacts instead of
+	// sub-stepping. cheaper for lots of medium speed shapes, contacts begin
+	// a little early and bounces lose some restitution.
+	// use ofxBox2dBaseShape::setSpeculative for single shapes
+	void setSpeculativeContacts(bool speculative);
+	bool isSpeculativeContacts();
+	
+	// solve big islands (over islandSize bodies) on several threads.
+	// 1 thread turns it off
+	void setSolverThreads(int threads, int islandSize = 256);
+	int getSolverThreads();
+	
 	// gravity
 	void setGravityX(float x);
 	void setGravityY(float y);
@@ -170,9 +204,23 @@ public:
 	void createGround(float x1=0, float y1=ofGetHeight(), float x2=ofGetWidth(), float y2=ofGetHeight());
 	void checkBounds(bool b);
 	
+	// binary scenes, bake the current world to a file or
+	// create the bodies/joints of a baked file in this world
+	bool bakeScene(string path);
+	bool loadScene(string path);
+	
 	// main box2d cycle
 	void update();
 	void draw();
 	void drawGround();
+	
+	// draw only the fixtures inside the viewport (OF coordinates).
+	// static/sleeping bodies are cached in a static vbo.
+	void drawVisible(const ofRectangle & viewport);
+	void drawVisible() { drawVisible(ofRectangle(0, 0, ofGetWidth(), ofGetHeight())); }
+	
+	// batched b2World::DrawDebugData, pick what to draw with
+	// debugRender.SetFlags(b2Draw::e_shapeBit | b2Draw::e_jointBit ...)
+	void drawDebug();
         
 };
@@ -10,6 +10,10 @@
 #include "ofxBox2dBaseShape.h"
 #include "ofxBox2d.h"
 
+// every shape gets its own key so a re-created body warm starts
+// from the contacts of the one it replaces
+static uint32 nextCacheKey = 0;
+
 //----------------------------------------
 ofxBox2dBaseShape::ofxBox2dBaseShape() {
 	
@@ -21,6 +25,32 @@ ofxBox2dBaseShape::ofxBox2dBaseShape() {
 	bounce		= 0.0;
 	friction	= 0.0;
 	bodyDef.allowSleep = true;
+	bodyDef.cacheKey   = ++nextCacheKey;
+}
+
+//----------------------------------------
+ofxBox2dBaseShape::ofxBox2dBaseShape(const ofxBox2dBaseShape & other) {
+	*this = other;
+	bodyDef.cacheKey = ++nextCacheKey;
+}
+
+//----------------------------------------
+ofxBox2dBaseShape & ofxBox2dBaseShape::operator=(const ofxBox2dBaseShape & other) {
+	if (this == &other) return *this;
+	
+	// the cache key stays with this shape
+	uint32 cacheKey = bodyDef.cacheKey;
+	fixture  = other.fixture;
+	bodyDef  = other.bodyDef;
+	body     = other.body;
+	name     = other.name;
+	alive    = other.alive;
+	setMassFromShape = other.setMassFromShape;
+	density  = other.density;
+	bounce   = other.bounce;
+	friction = other.friction;
+	bodyDef.cacheKey = cacheKey;
+	return *this;
 }
 
 //----------------------------------------
@@ -68,6 +98,19 @@ bool ofxBox2dBaseShape::isFixed() {
 	return density == 0.f ? true : false;
 }
 
+bool ofxBox2dBaseShape::isInViewport(const ofRectangle & viewport) {
+	if(!isBody()) return false;
+	b2AABB view;
+	view.lowerBound = toB2d(ofVec2f(viewport.getMinX(), viewport.getMinY()));
+	view.upperBound = toB2d(ofVec2f(viewport.getMaxX(), viewport.getMaxY()));
+	for(b2Fixture* f = body->GetFixtureList(); f; f = f->GetNext()) {
+		for(int i=0; i<f->GetShape()->GetChildCount(); i++) {
+			if(b2TestOverlap(f->GetAABB(i), view)) return true;
+		}
+	}
+	return false;
+}
+
 bool ofxBox2dBaseShape::isSleeping() {
     if(isBody()) {
         return !body->IsAwake();
@@ -183,6 +226,24 @@ void ofxBox2dBaseShape::setFixedRotation(bool b) {
     }
 }
 
+//------------------------------------------------ 
+void ofxBox2dBaseShape::setSpeculative(bool b) {
+	if(body) {
+        body->SetSpeculative(b);
+    }
+    else {
+        bodyDef.speculative = b;
+    }
+}
+
+//------------------------------------------------ 
+bool ofxBox2dBaseShape::isSpeculative() {
+	if(body) {
+        return body->IsSpeculative();
+    }
+    return bodyDef.speculative;
+}
+
 //------------------------------------------------
 float ofxBox2dBaseShape::getRotation() {
 	if(body != NULL) {
@@ -20,6 +20,11 @@ public:
 	float			friction;
 	ofxBox2dBaseShape();	
 	
+	// copies keep the settings but get their own cache key, bodies sharing
+	// one would warm start from each other's contacts
+	ofxBox2dBaseShape(const ofxBox2dBaseShape & other);
+	ofxBox2dBaseShape & operator=(const ofxBox2dBaseShape & other);
+	
 	//----------------------------------------
 	~ofxBox2dBaseShape();
 	
@@ -31,6 +36,10 @@ public:
     static bool shouldRemoveOffScreen(shared_ptr<ofxBox2dBaseShape> shape);
 	bool isFixed();
 	bool isSleeping();
+	
+	// true if any fixture's broad-phase AABB overlaps the viewport (in
+	// OF coordinates), use it to skip draw() for off-screen shapes.
+	bool isInViewport(const ofRectangle & viewport);
     
 	//----------------------------------------
 	b2World* getWorld();
@@ -65,6 +74,12 @@ public:
 	
 	//------------------------------------------------ 
 	virtual void setFixedRotation(bool b);
+	
+	//------------------------------------------------ 
+	// stop this shape tunneling with speculative contacts, much cheaper
+	// than bullets. see ofxBox2d::setSpeculativeContacts
+	virtual void setSpeculative(bool b);
+	bool isSpeculative();
 	float getRotation();
 	void setRotation(float angle);
 	
@@ -40,6 +40,8 @@ void ofxBox2dEdge::create(b2World * b2dworld) {
 	// create the body from the world (1)
 	b2BodyDef		bd;
 	bd.type			= density <= 0.0 ? b2_staticBody : b2_dynamicBody;
+	bd.cacheKey		= bodyDef.cacheKey;
+	bd.speculative	= bodyDef.speculative;
 	body			= b2dworld->CreateBody(&bd);
     
     vector<ofDefaultVertexType>&pts = ofPolyline::getVertices();
@@ -45,9 +45,28 @@ vector <string> ParticleSystem::particleTypesNames = {
 	"repulsiveParticle"
 };
 
+//--------------------------------------------------------------
+Emitter::Emitter() {
+	pending   = 0;
+	rate      = 100;
+	direction = -90;
+	spread    = 20;
+	speed     = 300;
+	lifetime  = 0;
+	flags     = b2_waterParticle;
+	color     = ofColor::white;
+	enabled   = true;
+}
+
+//--------------------------------------------------------------
 ParticleSystem::ParticleSystem() {
 	world = NULL;
 	particleSystem = NULL;
+	vboCapacity = 0;
+	vboCount = 0;
+	streamFlags = 0;
+	indexCapacity = 0;
+	indexCount = 0;
 }
 
 //--------------------------------------------------------------
@@ -73,10 +92,14 @@ void ParticleSystem::init(b2World * _world, int _maxParticles) {
 	// density
 	particleSystem->SetDensity(1.2f);
 	
+	// drop the oldest particles when full so emit keeps streaming,
+	// getParticleSystem()->SetDestructionByAge(false) turns this off
+	particleSystem->SetDestructionByAge(true);
+	
 	// default particle flag
 	particleFlag = b2_waterParticle;
 	
-	// set max particles this will allocate the mesh
+	// set max particles this will allocate the vbo
 	// and setup the b2dparticles systems
 	setMaxParticles(_maxParticles);
 }
@@ -118,29 +141,67 @@ void ParticleSystem::addParticleGroup(float x, float y, uint32 flags, float rad)
 	particleSystem->CreateParticleGroup(pg);
 }
 
+//--------------------------------------------------------------
+int ParticleSystem::emit(Emitter & emitter, float dt) {
+	if (!emitter.enabled || dt <= 0) return 0;
+	
+	emitter.pending += emitter.rate * dt;
+	int count = (int)emitter.pending;
+	emitter.pending -= count;
+	if (count == 0) return 0;
+	
+	// no point creating more than the system can hold
+	int maxCount = particleSystem->GetMaxParticleCount();
+	if (maxCount > 0) count = MIN(count, maxCount);
+	
+	emitDefs.resize(count);
+	emitAngles.resize(count);
+	emitDirs.resize(count);
+	for (int i=0; i<count; i++) {
+		emitAngles[i] = ofDegToRad(emitter.direction + ofRandom(-0.5f, 0.5f) * emitter.spread);
+	}
+	b2ComputeRotations(&emitDirs[0], &emitAngles[0], count);
+	
+	b2Vec2 origin = toB2d(emitter.position);
+	float  speed  = ofxBox2d::toB2d(emitter.speed);
+	float  jitter = particleSystem->GetRadius() * 0.5f;
+	b2ParticleColor color(emitter.color.r, emitter.color.g, emitter.color.b, emitter.color.a);
+	for (int i=0; i<count; i++) {
+		b2Vec2 dir(emitDirs[i].c, emitDirs[i].s);
+		
+		// spread the batch along the stream as if it was emitted over dt,
+		// particles created on top of each other have no contact normal
+		float t = dt * (i + ofRandom(1)) / count;
+		b2ParticleDef & def = emitDefs[i];
+		def.flags    = emitter.flags;
+		def.position = origin + (speed * t) * dir + b2Vec2(ofRandom(-jitter, jitter), ofRandom(-jitter, jitter));
+		def.velocity = speed * dir;
+		def.color    = color;
+		def.lifetime = emitter.lifetime;
+	}
+	return particleSystem->CreateParticles(&emitDefs[0], count);
+}
+
 #pragma mark - clean up
 //--------------------------------------------------------------
 void ParticleSystem::clearParticles() {
-	for (int i=0; i<particleSystem->GetParticleCount(); i++) {
-		particleSystem->DestroyParticle(i);
-		mesh.setVertex(i, ofVec3f(-1000, -1000, 0));
-	}
+	particleSystem->DestroyAllParticles();
+	vboCount = 0;
 }
 
 //--------------------------------------------------------------
 int ParticleSystem::removeOutsideBounds(const ofRectangle &bounds) {
-	int count = 0;
 	int n = particleSystem->GetParticleCount();
 	b2Vec2 * positions = particleSystem->GetPositionBuffer();
+	removeIndices.clear();
 	for(int i=0; i<n; i++) {
 		ofVec2f pos = toOf(positions[i]);
 		if(!bounds.inside(pos)) {
-			mesh.setVertex(i, ofVec3f(-1000, -1000, 0));
-			particleSystem->DestroyParticle(i);
-			count ++;
+			removeIndices.push_back(i);
 		}
 	}
-	return count;
+	removeParticles(removeIndices);
+	return removeIndices.size();
 }
 
 //--------------------------------------------------------------
@@ -148,11 +209,45 @@ void ParticleSystem::removeParticle(int index) {
 	particleSystem->DestroyParticle(index);
 }
 
+//--------------------------------------------------------------
+void ParticleSystem::removeParticles(const vector <int> & indices) {
+	if (indices.empty()) return;
+	particleSystem->DestroyParticles(&indices[0], indices.size());
+}
+
 #pragma mark - setters
 //--------------------------------------------------------------
 void ParticleSystem::setRadius(float radius) {
 	particleSystem->SetRadius(ofxBox2d::toB2d(radius));
-	#pragma warning maybe recaluelate the particle inter ?
+	// the fixed particle iterations are not updated,
+	// use setAdaptiveIterations to follow the radius
+}
+
+//--------------------------------------------------------------
+void ParticleSystem::setReorderInterval(int steps) {
+	particleSystem->SetReorderInterval(MAX(steps, 0));
+}
+
+//--------------------------------------------------------------
+void ParticleSystem::setContactSkin(float skin) {
+	particleSystem->SetContactSkin(ofxBox2d::toB2d(MAX(skin, 0)));
+}
+
+//--------------------------------------------------------------
+void ParticleSystem::setAdaptiveIterations(int maxIterations, float courant) {
+	particleSystem->SetAdaptiveIterations(MAX(maxIterations, 0));
+	if (courant > 0) particleSystem->SetCourantNumber(courant);
+}
+
+//--------------------------------------------------------------
+void ParticleSystem::setSleep(float speed, float seconds) {
+	particleSystem->SetSleepVelocity(ofxBox2d::toB2d(MAX(speed, 0)));
+	if (seconds > 0) particleSystem->SetSleepTime(seconds);
+}
+
+//--------------------------------------------------------------
+void ParticleSystem::wakeParticles() {
+	particleSystem->WakeParticles();
 }
 
 //--------------------------------------------------------------
@@ -166,14 +261,39 @@ void ParticleSystem::setMaxParticles(int count) {
 	// set the max particles
 	particleSystem->SetMaxParticleCount(count);
 	
-	mesh.clear();
-	
-	for(int i=0; i<count; i++) {
-		mesh.addVertex(ofVec3f(-1000, -1000, 0));
+	// allocate the vbo once, updateMesh only overwrites the live range
+	allocateVbo(MAX(count, 0));
+}
+
+//--------------------------------------------------------------
+void ParticleSystem::allocateVbo(int capacity) {
+	vboCapacity = capacity;
+	vboCount = 0;
+	indexCapacity = 0;
+	indexCount = 0;
+	vbo.clear();
+	if (capacity == 0) return;
+	
+	// b2Vec2 is two packed floats so the position and velocity
+	// buffers are uploaded as is
+	vbo.setVertexData((const float*)NULL, 2, capacity, GL_STREAM_DRAW, sizeof(b2Vec2));
+	if (streamFlags & STREAM_VELOCITY) {
+		vbo.setAttributeData(VELOCITY_ATTRIBUTE, (const float*)NULL, 2, capacity, GL_STREAM_DRAW, sizeof(b2Vec2));
 	}
-	
-	// set the mesh to draw points
-	mesh.setMode(OF_PRIMITIVE_POINTS);
+	if (streamFlags & STREAM_WEIGHT) {
+		vbo.setAttributeData(WEIGHT_ATTRIBUTE, (const float*)NULL, 1, capacity, GL_STREAM_DRAW, sizeof(float32));
+	}
+	if (streamFlags & STREAM_COLOR) {
+		vbo.setColorData((const ofFloatColor*)NULL, capacity, GL_STREAM_DRAW);
+	}
+}
+
+//--------------------------------------------------------------
+void ParticleSystem::setStreamFlags(int flags) {
+	if (flags == streamFlags) return;
+	streamFlags = flags;
+	allocateVbo(vboCapacity);
+	if (particleSystem) updateMesh();
 }
 
 //--------------------------------------------------------------
@@ -243,11 +363,26 @@ b2World * ParticleSystem::getWorld() {
 	return world;
 }
 
+//--------------------------------------------------------------
+ofVbo & ParticleSystem::getVbo() {
+	return vbo;
+}
+
 //--------------------------------------------------------------
 b2ParticleSystem * ParticleSystem::getParticleSystem() {
 	return particleSystem;
 }
 
+//--------------------------------------------------------------
+int ParticleSystem::getIterationCount() {
+	return particleSystem->GetIterationCount();
+}
+
+//--------------------------------------------------------------
+int ParticleSystem::getSleepingCount() {
+	return particleSystem->GetSleepingParticleCount();
+}
+
 //--------------------------------------------------------------
 int ParticleSystem::getTotalParticles() {
 	return particleSystem->GetParticleCount();
@@ -265,6 +400,49 @@ vector <ofVec2f> ParticleSystem::getPositions() {
 	return positions;
 }
 
+//--------------------------------------------------------------
+int ParticleSystem::getPositions(ofVec2f * positions, int capacity) {
+	float scale = ofxBox2d::getScale();
+	int particleCount = MIN(particleSystem->GetParticleCount(), capacity);
+	const b2Vec2 * pos = particleSystem->GetPositionBuffer();
+	for(int i=0; i<particleCount; i++) {
+		positions[i].set(pos[i].x * scale, pos[i].y * scale);
+	}
+	return particleCount;
+}
+
+//--------------------------------------------------------------
+int ParticleSystem::getParticlesInside(const ofRectangle & rect, vector <int> & indices) {
+	b2AABB aabb;
+	aabb.lowerBound = ofxBox2d::toB2d(rect.getMinX(), rect.getMinY());
+	aabb.upperBound = ofxBox2d::toB2d(rect.getMaxX(), rect.getMaxY());
+	
+	// the first pass tells how many there are if the vector was too small
+	indices.resize(indices.capacity());
+	int count = particleSystem->QueryAABB(aabb, indices.data(), indices.size());
+	if (count > (int)indices.size()) {
+		indices.resize(count);
+		particleSystem->QueryAABB(aabb, indices.data(), count);
+	}
+	indices.resize(count);
+	return count;
+}
+
+//--------------------------------------------------------------
+int ParticleSystem::getParticlesAlong(const ofVec2f & a, const ofVec2f & b, vector <int> & indices) {
+	b2Vec2 p1 = toB2d(a);
+	b2Vec2 p2 = toB2d(b);
+	
+	indices.resize(indices.capacity());
+	int count = particleSystem->RayCast(p1, p2, indices.data(), NULL, indices.size());
+	if (count > (int)indices.size()) {
+		indices.resize(count);
+		particleSystem->RayCast(p1, p2, indices.data(), NULL, count);
+	}
+	indices.resize(count);
+	return count;
+}
+
 //--------------------------------------------------------------
 float ParticleSystem::getRadius() {
 	float scale = ofxBox2d::getScale();
@@ -280,16 +458,55 @@ float ParticleSystem::getRenderRadius() {
 //--------------------------------------------------------------
 void ParticleSystem::updateMesh() {
 	
-	// update the particle system mesh
 	int particleCount = particleSystem->GetParticleCount();
-	const b2Vec2 * pos = particleSystem->GetPositionBuffer();
 	
-	// this is great! (how hard are the contacting eachother 0 - 1
-	// const float32 * weights = particleSystem->GetWeightBuffer();
-	mesh.clear();
-	for (int i=0; i<particleCount; i++) {
-		mesh.addVertex(ofVec3f(pos[i].x, pos[i].y, 0));
-		// mesh.setColor(i, ofFloatColor(1, weights[i], 1));
+	// only without a max particle count can the system outgrow the vbo
+	if (particleCount > vboCapacity) {
+		int capacity = MAX(vboCapacity * 2, 256);
+		while (capacity < particleCount) capacity *= 2;
+		allocateVbo(capacity);
+	}
+	
+	// one upload covering the live particles, removed particles are
+	// already compacted away by the particle system
+	vboCount = particleCount;
+	if (vboCount > 0) {
+		vbo.updateVertexData((const float*)particleSystem->GetPositionBuffer(), vboCount);
+		
+		if (streamFlags & STREAM_VELOCITY) {
+			vbo.updateAttributeData(VELOCITY_ATTRIBUTE, (const float*)particleSystem->GetVelocityBuffer(), vboCount);
+		}
+		if (streamFlags & STREAM_WEIGHT) {
+			vbo.updateAttributeData(WEIGHT_ATTRIBUTE, particleSystem->GetWeightBuffer(), vboCount);
+		}
+		if (streamFlags & STREAM_COLOR) {
+			// b2ParticleColor is 4 bytes, the vbo wants floats
+			const b2ParticleColor * colors = particleSystem->GetColorBuffer();
+			streamColors.resize(vboCount);
+			for (int i=0; i<vboCount; i++) {
+				streamColors[i].set(colors[i].r / 255.0f, colors[i].g / 255.0f, colors[i].b / 255.0f, colors[i].a / 255.0f);
+			}
+			vbo.updateColorData(&streamColors[0], vboCount);
+		}
+	}
+	
+	indexCount = 0;
+	if (streamFlags & STREAM_CONTACTS) {
+		const b2ParticleContact * contacts = particleSystem->GetContacts();
+		int contactCount = particleSystem->GetContactCount();
+		indexCount = contactCount * 2;
+		contactIndices.resize(indexCount);
+		for (int i=0; i<contactCount; i++) {
+			contactIndices[i * 2]     = contacts[i].GetIndexA();
+			contactIndices[i * 2 + 1] = contacts[i].GetIndexB();
+		}
+		if (indexCount > indexCapacity) {
+			indexCapacity = MAX(indexCapacity * 2, indexCount);
+			vbo.setIndexData((const ofIndexType*)NULL, indexCapacity, GL_STREAM_DRAW);
+		}
+		if (indexCount > 0) {
+			vbo.updateIndexData(&contactIndices[0], indexCount);
+		}
 	}
 }
 
@@ -348,10 +565,11 @@ void ParticleSystem::drawShape(b2Fixture* fixture, const b2Transform& xf, const
 			b2Assert(vertexCount <= b2_maxPolygonVertices);
 			b2Vec2 vertices[b2_maxPolygonVertices];
 			
+			b2TransformPoints(vertices, xf, poly->m_vertices, vertexCount);
+			
 			ofBeginShape();
 			for (int32 i = 0; i < vertexCount; ++i)
 			{
-				vertices[i] = b2Mul(xf, poly->m_vertices[i]);
 				ofVertex(vertices[i].x, vertices[i].y);
 			}
 			ofEndShape(true);
@@ -374,8 +592,8 @@ void ParticleSystem::drawShapes(float scaleFactor) {
 	ofScale(scale, scale);
 	
 	// render anything in the box2d world
-	b2Body * bodyList = world->GetBodyList();
-	for (b2Body* b = bodyList; b; b = b->GetNext()) {
+	for (int i=0; i<world->GetBodyCount(); i++) {
+		b2Body* b = world->GetBody(i);
 		const b2Transform& xf = b->GetTransform();
 		for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext()) {
 			drawShape(f, xf, b2Color(0.5f, 0.9f, 0.5f), scaleFactor);
@@ -398,7 +616,7 @@ void ParticleSystem::draw() {
 	float particlePointSize = getRenderRadius();
 
 	glPointSize(particlePointSize);
-	mesh.draw();
+	if (vboCount > 0) vbo.draw(GL_POINTS, 0, vboCount);
 	glPointSize(1);
 	
 	ofPopMatrix();
@@ -409,6 +627,23 @@ void ParticleSystem::draw() {
 //--------------------------------------------------------------
 void ParticleSystem::drawConnections(ofColor color, bool withWeights) {
 	
+	// the weights are per contact, the uploaded indices can only draw
+	// every connection the same color
+	if ((streamFlags & STREAM_CONTACTS) && !withWeights) {
+		if (indexCount == 0) return;
+		float scale = ofxBox2d::getScale();
+		ofPushStyle();
+		ofPushMatrix();
+		ofScale(scale, scale);
+		ofSetColor(color);
+		if (streamFlags & STREAM_COLOR) vbo.disableColors();
+		vbo.drawElements(GL_LINES, indexCount);
+		if (streamFlags & STREAM_COLOR) vbo.enableColors();
+		ofPopMatrix();
+		ofPopStyle();
+		return;
+	}
+	
 	const b2Vec2 * positions = particleSystem->GetPositionBuffer();
 	
 	/*
@@ -13,9 +13,46 @@
 
 namespace ofxBox2dParticleSystem {
 	
+	// a continuous particle source, pass it to ParticleSystem::emit every frame.
+	// positions and speeds are in pixels, angles in degrees
+	class Emitter {
+		
+		friend class ParticleSystem;
+		
+		// fraction of a particle carried over to the next frame
+		float pending;
+		
+	public:
+		
+		Emitter();
+		
+		ofVec2f position;
+		float   rate;       // particles per second
+		float   direction;  // 0 points right, 90 points down
+		float   spread;     // width of the velocity cone
+		float   speed;      // pixels per second
+		float   lifetime;   // seconds, 0 lives until pushed out by newer particles
+		uint32  flags;
+		ofColor color;
+		bool    enabled;
+	};
+	
 	class ParticleSystem {
 		
-		ofVboMesh mesh;
+		// particle positions on the gpu, allocated for the max particle count
+		// and refreshed with a single upload of the live particles per frame
+		ofVbo vbo;
+		int   vboCapacity;
+		int   vboCount;
+		
+		// what updateMesh uploads next to the positions, see setStreamFlags
+		int   streamFlags;
+		vector <ofFloatColor> streamColors;
+		
+		// contact pairs as line indices into the vbo
+		vector <ofIndexType> contactIndices;
+		int   indexCapacity;
+		int   indexCount;
 		b2World * world;
 		b2ParticleSystem * particleSystem;
 		
@@ -26,8 +63,31 @@ namespace ofxBox2dParticleSystem {
 		// I want a better system to combine flags
 		uint32 particleFlag;
 		
+		// scratch list for removeOutsideBounds
+		vector <int> removeIndices;
+		
+		// particle definitions reused by emit
+		vector <b2ParticleDef> emitDefs;
+		vector <float32>       emitAngles;
+		vector <b2Rot>         emitDirs;
+		
+		// (re)allocate the vbo for capacity particles
+		void allocateVbo(int capacity);
+		
 	public:
 		
+		// extra per particle data for custom shaders (metaballs etc.)
+		// velocity and weight are generic attributes at the locations below,
+		// velocities are in box2d units per second like the positions
+		enum {
+			STREAM_VELOCITY = 1 << 0,
+			STREAM_WEIGHT   = 1 << 1,
+			STREAM_COLOR    = 1 << 2,
+			STREAM_CONTACTS = 1 << 3
+		};
+		static const int VELOCITY_ATTRIBUTE = 4;
+		static const int WEIGHT_ATTRIBUTE   = 5;
+		
 		ParticleSystem();
 		
 		// helpers
@@ -56,16 +116,17 @@ namespace ofxBox2dParticleSystem {
 		// tick
 		void tick();
 		
-		// update the mesh with new data
+		// upload the particle positions to the gpu
 		void updateMesh();
 		
-		// render the mesh
+		// render the particles
 		void draw();
 		
 		// render all shapes
 		void drawShapes(float scaleFactor=1);
 		
-		// render out connection
+		// render out connection, with STREAM_CONTACTS and no weights
+		// this is a single draw call
 		void drawConnections(ofColor color = ofColor::white, bool withWeights=false);
 		
 		// render any shapes in the b2d world
@@ -77,6 +138,13 @@ namespace ofxBox2dParticleSystem {
 		// add a grouping of particles
 		void addParticleGroup(float x, float y, uint32 flags=b2_waterParticle, float rad=50);
 		
+		// create the particles an emitter produced over the last dt seconds in one
+		// batch. once the system reaches its max particles the oldest ones make
+		// room (unless destruction by age was turned off on the b2ParticleSystem),
+		// so buffers stop growing after the first few seconds
+		// returns the number of particles created
+		int emit(Emitter & emitter, float dt);
+		
 		// remove all particles
 		void clearParticles();
 		
@@ -85,23 +153,74 @@ namespace ofxBox2dParticleSystem {
 		int removeOutsideBounds(const ofRectangle &bounds);
 		
 		// remove the particle at index
-		// this will update the mesh
 		void removeParticle(int index);
 		
+		// remove many particles at once, they are gone after the next update
+		void removeParticles(const vector <int> & indices);
+		
 		// set the radius of the particle system
 		void setRadius(float radius);
 		
 		// set the particle type
 		uint32 setParticleType(int type);
 		
-		// set max particles
+		// set max particles, this also sizes the gpu buffer
 		void setMaxParticles(int count);
 		
+		// every n steps sort the particle buffers by position so neighbours
+		// sit next to each other in memory (faster for large systems).
+		// particle indices change when this happens, 0 turns it off
+		void setReorderInterval(int steps);
+		
+		// cache neighbours found within the particle size plus skin (pixels)
+		// and reuse them while particles move slowly, 0 turns it off
+		void setContactSkin(float skin);
+		
+		// pick the STREAM_ flags uploaded with the positions every frame
+		void setStreamFlags(int flags);
+		
+		// the particle vbo, bind your shader and draw it yourself
+		// with getVbo().draw(GL_POINTS, 0, getTotalParticles())
+		ofVbo & getVbo();
+		
+		// pick the particle iterations every step from the fastest particle
+		// (up to maxIterations) instead of the fixed ofxBox2d count.
+		// courant is how much of a particle diameter the fastest particle
+		// may move per iteration, 0 maxIterations turns it off
+		void setAdaptiveIterations(int maxIterations, float courant=0.5);
+		
+		// particle iterations used by the last step
+		int getIterationCount();
+		
+		// particles slower than speed (pixels per second) for the given
+		// seconds, with no moving neighbours, stop being simulated until
+		// something disturbs them. a settled pool then costs almost
+		// nothing, 0 turns it off
+		void setSleep(float speed, float seconds=0.5);
+		
+		// wake every sleeping particle
+		void wakeParticles();
+		
+		// number of particles asleep
+		int getSleepingCount();
+		
 		// set the offset of the glPointsize
 		void setPointSizeOffsetPercent(float pct);
 		
 		// get all postion (scaled) to world
 		vector <ofVec2f> getPositions();
+		
+		// write the positions (scaled) of up to capacity particles into
+		// positions without allocating, returns the number written
+		int getPositions(ofVec2f * positions, int capacity);
+		
+		// indices of the particles inside rect (pixels). indices keeps its
+		// capacity, reuse the same vector every frame to avoid allocations
+		// returns the number of particles found
+		int getParticlesInside(const ofRectangle & rect, vector <int> & indices);
+		
+		// indices of the particles touching the line from a to b (pixels)
+		int getParticlesAlong(const ofVec2f & a, const ofVec2f & b, vector <int> & indices);
 
 		// get radius (scaled)
 		float getRadius();
@@ -96,6 +96,8 @@ void ofxBox2dPolygon::create(b2World * b2dworld) {
     
 	b2BodyDef		bd;
 	bd.type			= density <= 0.0 ? b2_staticBody : b2_dynamicBody;
+	bd.cacheKey		= bodyDef.cacheKey;
+	bd.speculative	= bodyDef.speculative;
 	body			= b2dworld->CreateBody(&bd);
 
 	if(bIsTriangulated) {
@@ -258,9 +260,10 @@ vector <ofDefaultVertexType>& ofxBox2dPolygon::getPoints() {
 		
 			if(poly) {
 				ofPolyline::clear();
+				b2Vec2 pts[b2_maxPolygonVertices];
+				b2TransformPoints(pts, xf, poly->m_vertices, poly->GetVertexCount());
 				for(int i=0; i<poly->GetVertexCount(); i++) {
-					b2Vec2 pt = b2Mul(xf, poly->GetVertex(i));
-                    ofPolyline::addVertex(glm::vec3(pt.x, pt.y, 0));
+                    ofPolyline::addVertex(glm::vec3(pts[i].x, pts[i].y, 0));
 				}
 				if(isClosed()) ofPolyline::close();
 			}
@@ -40,7 +40,6 @@ void ofxBox2dRect::setup(b2World * b2dworld, float x, float y, float w, float h,
 	fixture.friction	= friction;
 	fixture.restitution = bounce;
 	
-	b2BodyDef bodyDef;
 	if(density == 0.f) bodyDef.type	= b2_staticBody;
 	else               bodyDef.type	= b2_dynamicBody;
 	bodyDef.position.Set(toB2d(x), toB2d(y));
@@ -84,9 +83,10 @@ ofPolyline& ofxBox2dRect::getRectangleShape() {
         for (b2Fixture* f = body->GetFixtureList(); f; f = f->GetNext()) {
             b2PolygonShape* poly = (b2PolygonShape*)f->GetShape();
             if(poly) {
+                b2Vec2 pts[b2_maxPolygonVertices];
+                b2TransformPoints(pts, xf, poly->m_vertices, poly->m_count);
                 for(int i=0; i<poly->m_count; i++) {
-                    b2Vec2 pt = b2Mul(xf, poly->m_vertices[i]);
-                    shape.addVertex(worldPtToscreenPt(pt));
+                    shape.addVertex(worldPtToscreenPt(pts[i]));
                 }
             }
         }
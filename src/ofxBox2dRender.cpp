@@ -8,78 +8,182 @@
 #include "ofxBox2dRender.h"
 #include "ofxBox2d.h"
 
+static const int   k_circleSegments   = 16;
+static const int   k_particleSegments = 8;
+static const float k_axisScale        = 0.4f;
+
+//----------------------------------------
+static void makeUnitCircle(vector <b2Vec2> & pts, int segments) {
+	pts.resize(segments);
+	vector <float32> angles(segments);
+	vector <b2Rot> rots(segments);
+	float32 increment = 2.0f * b2_pi / segments;
+	for (int i = 0; i < segments; i++) {
+		angles[i] = increment * i;
+	}
+	b2ComputeRotations(&rots[0], &angles[0], segments);
+	for (int i = 0; i < segments; i++) {
+		pts[i].Set(rots[i].c, rots[i].s);
+	}
+}
+
+//----------------------------------------
+static inline ofFloatColor toOf(const b2Color& color, float alpha = 1.0f) {
+	return ofFloatColor(color.r, color.g, color.b, alpha);
+}
+
+//----------------------------------------
+ofxBox2dRender::ofxBox2dRender() {
+	scaleFactor = 30.0f;
+	pointSize   = 1.0f;
+	triangles.setMode(OF_PRIMITIVE_TRIANGLES);
+	lines.setMode(OF_PRIMITIVE_LINES);
+	points.setMode(OF_PRIMITIVE_POINTS);
+	triangles.setUsage(GL_STREAM_DRAW);
+	lines.setUsage(GL_STREAM_DRAW);
+	points.setUsage(GL_STREAM_DRAW);
+	makeUnitCircle(circle, k_circleSegments);
+	makeUnitCircle(particleCircle, k_particleSegments);
+}
 
 void ofxBox2dRender::setScale(float f) {
 	scaleFactor = f;
 }
 
+//----------------------------------------
+void ofxBox2dRender::addLine(const b2Vec2& p1, const b2Vec2& p2, const ofFloatColor& color) {
+	lines.addVertex(ofVec3f(p1.x, p1.y));
+	lines.addVertex(ofVec3f(p2.x, p2.y));
+	lines.addColor(color);
+	lines.addColor(color);
+}
+
+void ofxBox2dRender::addTriangle(const b2Vec2& p1, const b2Vec2& p2, const b2Vec2& p3, const ofFloatColor& color) {
+	triangles.addVertex(ofVec3f(p1.x, p1.y));
+	triangles.addVertex(ofVec3f(p2.x, p2.y));
+	triangles.addVertex(ofVec3f(p3.x, p3.y));
+	triangles.addColor(color);
+	triangles.addColor(color);
+	triangles.addColor(color);
+}
+
+void ofxBox2dRender::addDisc(const b2Vec2& center, float32 radius, const vector <b2Vec2> & unitCircle, const ofFloatColor& color) {
+	int n = unitCircle.size();
+	for (int i = 0; i < n; i++) {
+		addTriangle(center, center + radius * unitCircle[i], center + radius * unitCircle[(i + 1) % n], color);
+	}
+}
+
+//----------------------------------------
 void ofxBox2dRender::DrawPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color) {
-	ofSetColor(color.r*255.0, color.g*255.0, color.b*255.0);
-	ofBeginShape();
+	ofFloatColor c = toOf(color);
 	for (int i = 0; i < vertexCount; ++i) {
-		ofVec2f p = ofxBox2d::toOf(vertices[i]);
-		ofVertex(p.x, p.y);
+		addLine(vertices[i], vertices[(i + 1) % vertexCount], c);
 	}
-	ofEndShape();
 }
+
 void ofxBox2dRender::DrawSolidPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color) {
-	
-	ofSetHexColor(0xffffff);
-	ofBeginShape();
-	for(int i=0; i<vertexCount; ++i) {
-		ofVec2f p = ofxBox2d::toOf(vertices[i]);
-		ofVertex(p.x, p.y);
+	ofFloatColor fill = toOf(color, 0.5f);
+	fill.r *= 0.5f; fill.g *= 0.5f; fill.b *= 0.5f;
+	for (int i = 1; i < vertexCount - 1; ++i) {
+		addTriangle(vertices[0], vertices[i], vertices[i + 1], fill);
 	}
-	ofEndShape();
-	
-	
+	DrawPolygon(vertices, vertexCount, color);
 }
+
 void ofxBox2dRender::DrawCircle(const b2Vec2& center, float32 radius, const b2Color& color) {
-	const float32 k_segments = 16.0f;
-	const float32 k_increment = 2.0f * b2_pi / k_segments;
-	float32 theta = 0.0f;
-	ofSetColor(color.r*255.0, color.g*255.0, color.b*255.0);
-	ofBeginShape();
-	for (int i = 0; i < k_segments; i++) {
-		b2Vec2 v = center + radius * b2Vec2(cosf(theta), sinf(theta));
-		ofVertex(v.x, v.y);
-		theta += k_increment;
+	ofFloatColor c = toOf(color);
+	for (int i = 0; i < k_circleSegments; i++) {
+		addLine(center + radius * circle[i], center + radius * circle[(i + 1) % k_circleSegments], c);
 	}
-	ofEndShape();
 }
+
 void ofxBox2dRender::DrawSolidCircle(const b2Vec2& center, float32 radius, const b2Vec2& axis, const b2Color& color) {
-	// 		const float32 k_segments    = 16.0f;
-	// 		const float32 k_increment   = 2.0f * b2_pi / k_segments;
-	// 		float32 theta			    = 0.0f;
-	float rad = (radius*scaleFactor);
-	glEnable(GL_BLEND);
-	glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	ofSetColor(255, 255, 255, 200);
-	ofFill();
-	ofDrawCircle(center.x*scaleFactor, center.y*scaleFactor, rad);
+	ofFloatColor fill = toOf(color, 0.5f);
+	fill.r *= 0.5f; fill.g *= 0.5f; fill.b *= 0.5f;
+	addDisc(center, radius, circle, fill);
+	DrawCircle(center, radius, color);
+	addLine(center, center + radius * axis, toOf(color));
 }
+
 void ofxBox2dRender::DrawSegment(const b2Vec2& p1, const b2Vec2& p2, const b2Color& color) {
-	ofSetColor(255, 255, 255, 200);
-	ofDrawLine(ofxBox2d::toOf(p1), ofxBox2d::toOf(p2));
+	addLine(p1, p2, toOf(color));
 }
+
 void ofxBox2dRender::DrawTransform(const b2Transform& xf) {
+	addLine(xf.p, xf.p + k_axisScale * xf.q.GetXAxis(), ofFloatColor(1, 0, 0));
+	addLine(xf.p, xf.p + k_axisScale * xf.q.GetYAxis(), ofFloatColor(0, 1, 0));
 }
 
+// all points of a batch share one size, the largest one requested
 void ofxBox2dRender::DrawPoint(const b2Vec2& p, float32 size, const b2Color& color) {
+	points.addVertex(ofVec3f(p.x, p.y));
+	points.addColor(toOf(color));
+	pointSize = MAX(pointSize, size);
 }
+
 void ofxBox2dRender::DrawString(int x, int y, const char* string, ...) {
+	char buffer[256];
+	va_list args;
+	va_start(args, string);
+	vsnprintf(buffer, sizeof(buffer), string, args);
+	va_end(args);
+	Label label;
+	label.x = x;
+	label.y = y;
+	label.text = buffer;
+	labels.push_back(label);
 }
+
 void ofxBox2dRender::DrawAABB(b2AABB* aabb, const b2Color& color) {
-	ofSetColor(color.r*255.0, color.g*255.0, color.b*255.0);
-	ofBeginShape();
-	ofVertex(aabb->lowerBound.x, aabb->lowerBound.y);
-	ofVertex(aabb->upperBound.x, aabb->lowerBound.y);
-	ofVertex(aabb->upperBound.x, aabb->upperBound.y);
-	ofVertex(aabb->lowerBound.x, aabb->upperBound.y);
-	ofEndShape();
+	b2Vec2 vs[4];
+	vs[0].Set(aabb->lowerBound.x, aabb->lowerBound.y);
+	vs[1].Set(aabb->upperBound.x, aabb->lowerBound.y);
+	vs[2].Set(aabb->upperBound.x, aabb->upperBound.y);
+	vs[3].Set(aabb->lowerBound.x, aabb->upperBound.y);
+	DrawPolygon(vs, 4, color);
 }
 
 void ofxBox2dRender::DrawParticles(const b2Vec2 *centers, float32 radius, const b2ParticleColor *colors, int32 count) {
-	
+	triangles.getVertices().reserve(triangles.getNumVertices() + count * k_particleSegments * 3);
+	ofFloatColor c(1, 1, 1, 0.5f);
+	for (int i = 0; i < count; i++) {
+		if (colors) {
+			c.set(colors[i].r / 255.0f, colors[i].g / 255.0f, colors[i].b / 255.0f, colors[i].a / 255.0f);
+		}
+		addDisc(centers[i], radius, particleCircle, c);
+	}
 }
 
+//----------------------------------------
+void ofxBox2dRender::clear() {
+	triangles.clear();
+	lines.clear();
+	points.clear();
+	labels.clear();
+	pointSize = 1.0f;
+}
+
+void ofxBox2dRender::flush() {
+	ofPushStyle();
+	ofEnableAlphaBlending();
+	ofSetColor(255);
+
+	ofPushMatrix();
+	ofScale(scaleFactor, scaleFactor);
+	if (triangles.getNumVertices()) triangles.draw();
+	if (lines.getNumVertices())     lines.draw();
+	if (points.getNumVertices()) {
+		glPointSize(pointSize);
+		points.draw();
+		glPointSize(1);
+	}
+	ofPopMatrix();
+
+	for (size_t i = 0; i < labels.size(); i++) {
+		ofDrawBitmapString(labels[i].text, labels[i].x, labels[i].y);
+	}
+	ofPopStyle();
+
+	clear();
+}
@@ -2,12 +2,18 @@
 #include "ofMain.h"
 #include "Box2D.h"
 
+// b2Draw implementation that batches everything b2World::DrawDebugData
+// emits into a few vertex arrays (triangles, lines, points) kept in box2d
+// units. call flush() after DrawDebugData to draw them with one draw call
+// per primitive type.
 class ofxBox2dRender : public b2Draw {
 
 public:
 
 	float scaleFactor;
 
+	ofxBox2dRender();
+
 	void setScale(float f);
 	void DrawPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color);
 	void DrawSolidPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color);
@@ -19,4 +25,29 @@ public:
 	void DrawString(int x, int y, const char* string, ...);
 	void DrawAABB(b2AABB* aabb, const b2Color& color);
 	void DrawParticles(const b2Vec2 *centers, float32 radius, const b2ParticleColor *colors, int32 count);
+
+	// draw and clear everything batched since the last flush
+	void flush();
+	void clear();
+
+private:
+
+	void addLine(const b2Vec2& p1, const b2Vec2& p2, const ofFloatColor& color);
+	void addTriangle(const b2Vec2& p1, const b2Vec2& p2, const b2Vec2& p3, const ofFloatColor& color);
+	void addDisc(const b2Vec2& center, float32 radius, const vector <b2Vec2> & unitCircle, const ofFloatColor& color);
+
+	struct Label {
+		int x, y;
+		string text;
+	};
+
+	ofVboMesh triangles;
+	ofVboMesh lines;
+	ofVboMesh points;
+	float     pointSize;
+	vector <Label> labels;
+
+	// unit circles for shapes and (cheaper) for particles
+	vector <b2Vec2> circle;
+	vector <b2Vec2> particleCircle;
 };
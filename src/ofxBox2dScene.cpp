@@ -0,0 +1,665 @@
+//
+//  ofxBox2dScene.cpp
+//
+
+#include "ofxBox2dScene.h"
+
+#ifdef TARGET_WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//----------------------------------------
+ofxBox2dScene::ofxBox2dScene() {
+	header     = NULL;
+	mappedSize = 0;
+#ifdef TARGET_WIN32
+	fileHandle    = NULL;
+	mappingHandle = NULL;
+#endif
+}
+
+//----------------------------------------
+ofxBox2dScene::~ofxBox2dScene() {
+	close();
+}
+
+#pragma mark - baking
+//----------------------------------------
+static void bakeFixture(const b2Fixture * f, ofxBox2dScene::Fixture & rec, vector <b2Vec2> & vertices) {
+	const b2Shape * shape = f->GetShape();
+	const b2Filter & filter = f->GetFilterData();
+
+	rec = ofxBox2dScene::Fixture();
+	rec.shapeType    = shape->GetType();
+	rec.radius       = shape->m_radius;
+	rec.density      = f->GetDensity();
+	rec.friction     = f->GetFriction();
+	rec.restitution  = f->GetRestitution();
+	rec.categoryBits = filter.categoryBits;
+	rec.maskBits     = filter.maskBits;
+	rec.groupIndex   = filter.groupIndex;
+	rec.isSensor     = f->IsSensor() ? 1 : 0;
+	rec.firstVertex  = (int32)vertices.size();
+
+	switch (shape->GetType()) {
+		case b2Shape::e_circle: {
+			const b2CircleShape * circle = (const b2CircleShape*)shape;
+			rec.center = circle->m_p;
+			break;
+		}
+		case b2Shape::e_edge: {
+			const b2EdgeShape * edge = (const b2EdgeShape*)shape;
+			vertices.push_back(edge->m_vertex1);
+			vertices.push_back(edge->m_vertex2);
+			rec.vertexCount   = 2;
+			rec.prevVertex    = edge->m_vertex0;
+			rec.nextVertex    = edge->m_vertex3;
+			rec.hasPrevVertex = edge->m_hasVertex0;
+			rec.hasNextVertex = edge->m_hasVertex3;
+			break;
+		}
+		case b2Shape::e_polygon: {
+			const b2PolygonShape * poly = (const b2PolygonShape*)shape;
+			vertices.insert(vertices.end(), poly->m_vertices, poly->m_vertices + poly->m_count);
+			vertices.insert(vertices.end(), poly->m_normals, poly->m_normals + poly->m_count);
+			rec.center      = poly->m_centroid;
+			rec.vertexCount = poly->m_count;
+			break;
+		}
+		case b2Shape::e_chain: {
+			const b2ChainShape * chain = (const b2ChainShape*)shape;
+			vertices.insert(vertices.end(), chain->m_vertices, chain->m_vertices + chain->m_count);
+			rec.vertexCount   = chain->m_count;
+			rec.prevVertex    = chain->m_prevVertex;
+			rec.nextVertex    = chain->m_nextVertex;
+			rec.hasPrevVertex = chain->m_hasPrevVertex;
+			rec.hasNextVertex = chain->m_hasNextVertex;
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+//----------------------------------------
+static bool bakeJoint(b2Joint * j, const map<const b2Body*, int32> & bodyIndex, ofxBox2dScene::Joint & rec) {
+	rec = ofxBox2dScene::Joint();
+	rec.type             = j->GetType();
+	rec.bodyA            = bodyIndex.find(j->GetBodyA())->second;
+	rec.bodyB            = bodyIndex.find(j->GetBodyB())->second;
+	rec.collideConnected = j->GetCollideConnected();
+
+	switch (j->GetType()) {
+		case e_distanceJoint: {
+			const b2DistanceJoint * d = (const b2DistanceJoint*)j;
+			rec.localAnchorA = d->GetLocalAnchorA();
+			rec.localAnchorB = d->GetLocalAnchorB();
+			rec.length       = d->GetLength();
+			rec.frequencyHz  = d->GetFrequency();
+			rec.dampingRatio = d->GetDampingRatio();
+			return true;
+		}
+		case e_revoluteJoint: {
+			const b2RevoluteJoint * r = (const b2RevoluteJoint*)j;
+			rec.localAnchorA   = r->GetLocalAnchorA();
+			rec.localAnchorB   = r->GetLocalAnchorB();
+			rec.referenceAngle = r->GetReferenceAngle();
+			rec.enableLimit    = r->IsLimitEnabled();
+			rec.lowerLimit     = r->GetLowerLimit();
+			rec.upperLimit     = r->GetUpperLimit();
+			rec.enableMotor    = r->IsMotorEnabled();
+			rec.motorSpeed     = r->GetMotorSpeed();
+			rec.maxMotor       = r->GetMaxMotorTorque();
+			return true;
+		}
+		case e_prismaticJoint: {
+			const b2PrismaticJoint * p = (const b2PrismaticJoint*)j;
+			rec.localAnchorA   = p->GetLocalAnchorA();
+			rec.localAnchorB   = p->GetLocalAnchorB();
+			rec.localAxisA     = p->GetLocalAxisA();
+			rec.referenceAngle = p->GetReferenceAngle();
+			rec.enableLimit    = p->IsLimitEnabled();
+			rec.lowerLimit     = p->GetLowerLimit();
+			rec.upperLimit     = p->GetUpperLimit();
+			rec.enableMotor    = p->IsMotorEnabled();
+			rec.motorSpeed     = p->GetMotorSpeed();
+			rec.maxMotor       = p->GetMaxMotorForce();
+			return true;
+		}
+		case e_weldJoint: {
+			const b2WeldJoint * w = (const b2WeldJoint*)j;
+			rec.localAnchorA   = w->GetLocalAnchorA();
+			rec.localAnchorB   = w->GetLocalAnchorB();
+			rec.referenceAngle = w->GetReferenceAngle();
+			rec.frequencyHz    = w->GetFrequency();
+			rec.dampingRatio   = w->GetDampingRatio();
+			return true;
+		}
+		case e_ropeJoint: {
+			const b2RopeJoint * r = (const b2RopeJoint*)j;
+			rec.localAnchorA = r->GetLocalAnchorA();
+			rec.localAnchorB = r->GetLocalAnchorB();
+			rec.length       = r->GetMaxLength();
+			return true;
+		}
+		case e_wheelJoint: {
+			const b2WheelJoint * w = (const b2WheelJoint*)j;
+			rec.localAnchorA = w->GetLocalAnchorA();
+			rec.localAnchorB = w->GetLocalAnchorB();
+			rec.localAxisA   = w->GetLocalAxisA();
+			rec.enableMotor  = w->IsMotorEnabled();
+			rec.motorSpeed   = w->GetMotorSpeed();
+			rec.maxMotor     = w->GetMaxMotorTorque();
+			rec.frequencyHz  = w->GetSpringFrequencyHz();
+			rec.dampingRatio = w->GetSpringDampingRatio();
+			return true;
+		}
+		default:
+			return false;
+	}
+}
+
+//----------------------------------------
+bool ofxBox2dScene::bake(b2World * world, string path) {
+	if (world == NULL) {
+		ofLogError("ofxBox2dScene") << "bake(): world is NULL";
+		return false;
+	}
+	if (world->IsLocked()) {
+		ofLogError("ofxBox2dScene") << "bake(): can't bake in the middle of a time step";
+		return false;
+	}
+
+	vector <Body>    bodies;
+	vector <Fixture> fixtures;
+	vector <b2Vec2>  vertices;
+	vector <Joint>   joints;
+	map<const b2Body*, int32> bodyIndex;
+
+	// the world and bodies prepend new items to their lists, walk
+	// them back to front so create() rebuilds the same list order.
+	vector <const b2Body*> bodyList;
+	for (const b2Body * b = world->GetBodyList(); b; b = b->GetNext()) {
+		bodyList.push_back(b);
+	}
+	for (int i=(int)bodyList.size()-1; i>=0; i--) {
+		const b2Body * b = bodyList[i];
+		bodyIndex[b] = (int32)bodies.size();
+
+		Body rec = Body();
+		rec.type            = b->GetType();
+		rec.position        = b->GetPosition();
+		rec.angle           = b->GetAngle();
+		rec.linearVelocity  = b->GetLinearVelocity();
+		rec.angularVelocity = b->GetAngularVelocity();
+		rec.linearDamping   = b->GetLinearDamping();
+		rec.angularDamping  = b->GetAngularDamping();
+		rec.gravityScale    = b->GetGravityScale();
+		rec.flags           = (b->IsAwake()           ? BODY_AWAKE          : 0) |
+		                      (b->IsSleepingAllowed() ? BODY_ALLOW_SLEEP    : 0) |
+		                      (b->IsFixedRotation()   ? BODY_FIXED_ROTATION : 0) |
+		                      (b->IsBullet()          ? BODY_BULLET         : 0) |
+		                      (b->IsActive()          ? BODY_ACTIVE         : 0) |
+		                      (b->IsSpeculative()     ? BODY_SPECULATIVE    : 0);
+		rec.firstFixture    = (int32)fixtures.size();
+
+		vector <const b2Fixture*> fixtureList;
+		for (const b2Fixture * f = b->GetFixtureList(); f; f = f->GetNext()) {
+			fixtureList.push_back(f);
+		}
+		for (int k=(int)fixtureList.size()-1; k>=0; k--) {
+			Fixture frec;
+			bakeFixture(fixtureList[k], frec, vertices);
+			fixtures.push_back(frec);
+		}
+		rec.fixtureCount = (int32)fixtures.size() - rec.firstFixture;
+		bodies.push_back(rec);
+	}
+
+	vector <b2Joint*> jointList;
+	for (b2Joint * j = world->GetJointList(); j; j = j->GetNext()) {
+		jointList.push_back(j);
+	}
+	for (int i=(int)jointList.size()-1; i>=0; i--) {
+		Joint rec;
+		if (bakeJoint(jointList[i], bodyIndex, rec)) {
+			joints.push_back(rec);
+		}
+		else {
+			ofLogWarning("ofxBox2dScene") << "bake(): skipping unsupported joint type " << jointList[i]->GetType();
+		}
+	}
+
+	Header h;
+	memset(&h, 0, sizeof(h));
+	h.magic         = MAGIC;
+	h.version       = VERSION;
+	h.byteOrder     = ENDIAN_MARK;
+	h.bodyCount     = (int32)bodies.size();
+	h.fixtureCount  = (int32)fixtures.size();
+	h.vertexCount   = (int32)vertices.size();
+	h.jointCount    = (int32)joints.size();
+	h.bodyOffset    = sizeof(Header);
+	h.fixtureOffset = h.bodyOffset    + sizeof(Body)    * h.bodyCount;
+	h.vertexOffset  = h.fixtureOffset + sizeof(Fixture) * h.fixtureCount;
+	h.jointOffset   = h.vertexOffset  + sizeof(b2Vec2)  * h.vertexCount;
+	h.fileSize      = h.jointOffset   + sizeof(Joint)   * h.jointCount;
+
+	ofstream out(ofToDataPath(path).c_str(), ios::out | ios::binary | ios::trunc);
+	if (!out.is_open()) {
+		ofLogError("ofxBox2dScene") << "bake(): can't open " << path << " for writing";
+		return false;
+	}
+	out.write((const char*)&h, sizeof(h));
+	if (!bodies.empty())   out.write((const char*)&bodies[0],   sizeof(Body)    * bodies.size());
+	if (!fixtures.empty()) out.write((const char*)&fixtures[0], sizeof(Fixture) * fixtures.size());
+	if (!vertices.empty()) out.write((const char*)&vertices[0], sizeof(b2Vec2)  * vertices.size());
+	if (!joints.empty())   out.write((const char*)&joints[0],   sizeof(Joint)   * joints.size());
+	if (!out.good()) {
+		ofLogError("ofxBox2dScene") << "bake(): failed writing " << path;
+		return false;
+	}
+
+	ofLogVerbose("ofxBox2dScene") << "baked " << h.bodyCount << " bodies, " << h.fixtureCount << " fixtures, "
+	                              << h.jointCount << " joints to " << path;
+	return true;
+}
+
+#pragma mark - loading
+//----------------------------------------
+// true if count records of recordSize starting at offset lie in the file
+static bool sectionInFile(uint32 offset, int32 count, size_t recordSize, size_t fileSize) {
+	if (count < 0 || offset % 4 != 0) return false;
+	return (uint64)offset + (uint64)count * recordSize <= (uint64)fileSize;
+}
+
+//----------------------------------------
+// true if [first, first + count) lies in [0, total)
+static bool rangeInSection(int32 first, int64 count, int32 total) {
+	return first >= 0 && count >= 0 && first + count <= total;
+}
+
+//----------------------------------------
+// create() indexes the records as is, so check every section and every
+// index they hold. returns the first bad part or NULL.
+static const char * checkScene(const ofxBox2dScene & scene, size_t fileSize) {
+	const ofxBox2dScene::Header * h = scene.getHeader();
+	if (!sectionInFile(h->bodyOffset,    h->bodyCount,    sizeof(ofxBox2dScene::Body),    fileSize)) return "body section";
+	if (!sectionInFile(h->fixtureOffset, h->fixtureCount, sizeof(ofxBox2dScene::Fixture), fileSize)) return "fixture section";
+	if (!sectionInFile(h->vertexOffset,  h->vertexCount,  sizeof(b2Vec2),                 fileSize)) return "vertex section";
+	if (!sectionInFile(h->jointOffset,   h->jointCount,   sizeof(ofxBox2dScene::Joint),   fileSize)) return "joint section";
+
+	const ofxBox2dScene::Body * bodies = scene.getBodies();
+	for (int i=0; i<h->bodyCount; i++) {
+		const ofxBox2dScene::Body & rec = bodies[i];
+		if (rec.type < b2_staticBody || rec.type > b2_dynamicBody) return "body type";
+		if (!rangeInSection(rec.firstFixture, rec.fixtureCount, h->fixtureCount)) return "body fixture range";
+	}
+
+	const ofxBox2dScene::Fixture * fixtures = scene.getFixtures();
+	for (int i=0; i<h->fixtureCount; i++) {
+		const ofxBox2dScene::Fixture & rec = fixtures[i];
+		int64 used = 0;
+		switch (rec.shapeType) {
+			case b2Shape::e_circle:
+				break;
+			case b2Shape::e_edge:
+				if (rec.vertexCount != 2) return "edge vertex count";
+				used = 2;
+				break;
+			case b2Shape::e_polygon:
+				if (rec.vertexCount < 3 || rec.vertexCount > b2_maxPolygonVertices) return "polygon vertex count";
+				// vertices followed by normals
+				used = 2 * (int64)rec.vertexCount;
+				break;
+			case b2Shape::e_chain:
+				if (rec.vertexCount < 2) return "chain vertex count";
+				used = rec.vertexCount;
+				break;
+			default:
+				// skipped by create()
+				break;
+		}
+		if (used > 0 && !rangeInSection(rec.firstVertex, used, h->vertexCount)) return "fixture vertex range";
+	}
+
+	const ofxBox2dScene::Joint * joints = scene.getJoints();
+	for (int i=0; i<h->jointCount; i++) {
+		const ofxBox2dScene::Joint & rec = joints[i];
+		if (!rangeInSection(rec.bodyA, 1, h->bodyCount) || !rangeInSection(rec.bodyB, 1, h->bodyCount)) return "joint body index";
+	}
+	return NULL;
+}
+
+//----------------------------------------
+bool ofxBox2dScene::load(string path) {
+	close();
+
+	string fullPath = ofToDataPath(path);
+	const void * data = NULL;
+	size_t size = 0;
+
+#ifdef TARGET_WIN32
+	HANDLE file = CreateFileA(fullPath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		ofLogError("ofxBox2dScene") << "load(): can't open " << path;
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	size = (size_t)fileSize.QuadPart;
+	HANDLE mapping = size ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+	data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+	if (data == NULL) {
+		if (mapping) CloseHandle(mapping);
+		CloseHandle(file);
+		ofLogError("ofxBox2dScene") << "load(): can't map " << path;
+		return false;
+	}
+	fileHandle    = file;
+	mappingHandle = mapping;
+#else
+	int fd = open(fullPath.c_str(), O_RDONLY);
+	if (fd < 0) {
+		ofLogError("ofxBox2dScene") << "load(): can't open " << path;
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) == 0) {
+		size = (size_t)st.st_size;
+	}
+	void * mapped = size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	// the mapping stays valid after the descriptor is closed
+	::close(fd);
+	if (mapped == MAP_FAILED) {
+		ofLogError("ofxBox2dScene") << "load(): can't map " << path;
+		return false;
+	}
+	data = mapped;
+#endif
+
+	header     = (const Header*)data;
+	mappedSize = size;
+
+	if (size < sizeof(Header) || header->magic != MAGIC || header->byteOrder != ENDIAN_MARK) {
+		ofLogError("ofxBox2dScene") << "load(): " << path << " is not a scene file for this platform";
+		close();
+		return false;
+	}
+	if (header->version != VERSION || header->fileSize != size) {
+		ofLogError("ofxBox2dScene") << "load(): " << path << " has version " << header->version
+		                            << " / size " << size << ", expected version " << VERSION
+		                            << " / size " << header->fileSize;
+		close();
+		return false;
+	}
+
+	// a truncated or corrupted file must not send create() out of the mapping
+	const char * bad = checkScene(*this, size);
+	if (bad != NULL) {
+		ofLogError("ofxBox2dScene") << "load(): " << path << " has a bad " << bad;
+		close();
+		return false;
+	}
+	return true;
+}
+
+//----------------------------------------
+void ofxBox2dScene::close() {
+	if (header == NULL) return;
+#ifdef TARGET_WIN32
+	UnmapViewOfFile(header);
+	CloseHandle((HANDLE)mappingHandle);
+	CloseHandle((HANDLE)fileHandle);
+	fileHandle    = NULL;
+	mappingHandle = NULL;
+#else
+	munmap((void*)header, mappedSize);
+#endif
+	header     = NULL;
+	mappedSize = 0;
+}
+
+//----------------------------------------
+const ofxBox2dScene::Body * ofxBox2dScene::getBodies() const {
+	return header ? (const Body*)((const char*)header + header->bodyOffset) : NULL;
+}
+
+//----------------------------------------
+const ofxBox2dScene::Fixture * ofxBox2dScene::getFixtures() const {
+	return header ? (const Fixture*)((const char*)header + header->fixtureOffset) : NULL;
+}
+
+//----------------------------------------
+const b2Vec2 * ofxBox2dScene::getVertices() const {
+	return header ? (const b2Vec2*)((const char*)header + header->vertexOffset) : NULL;
+}
+
+//----------------------------------------
+const ofxBox2dScene::Joint * ofxBox2dScene::getJoints() const {
+	return header ? (const Joint*)((const char*)header + header->jointOffset) : NULL;
+}
+
+#pragma mark - create
+//----------------------------------------
+static void createFixture(b2Body * body, const ofxBox2dScene::Fixture & rec, const b2Vec2 * vertices) {
+	b2FixtureDef fd;
+	fd.density             = rec.density;
+	fd.friction            = rec.friction;
+	fd.restitution         = rec.restitution;
+	fd.isSensor            = rec.isSensor != 0;
+	fd.filter.categoryBits = rec.categoryBits;
+	fd.filter.maskBits     = rec.maskBits;
+	fd.filter.groupIndex   = rec.groupIndex;
+
+	const b2Vec2 * v = vertices + rec.firstVertex;
+
+	switch (rec.shapeType) {
+		case b2Shape::e_circle: {
+			b2CircleShape circle;
+			circle.m_radius = rec.radius;
+			circle.m_p      = rec.center;
+			fd.shape = &circle;
+			body->CreateFixture(&fd);
+			break;
+		}
+		case b2Shape::e_edge: {
+			b2EdgeShape edge;
+			edge.m_radius     = rec.radius;
+			edge.m_vertex1    = v[0];
+			edge.m_vertex2    = v[1];
+			edge.m_vertex0    = rec.prevVertex;
+			edge.m_vertex3    = rec.nextVertex;
+			edge.m_hasVertex0 = rec.hasPrevVertex != 0;
+			edge.m_hasVertex3 = rec.hasNextVertex != 0;
+			fd.shape = &edge;
+			body->CreateFixture(&fd);
+			break;
+		}
+		case b2Shape::e_polygon: {
+			// hull, normals and centroid were computed when baking,
+			// skip b2PolygonShape::Set() and copy them straight in.
+			b2PolygonShape poly;
+			poly.m_radius   = rec.radius;
+			poly.m_count    = rec.vertexCount;
+			poly.m_centroid = rec.center;
+			memcpy(poly.m_vertices, v, sizeof(b2Vec2) * rec.vertexCount);
+			memcpy(poly.m_normals, v + rec.vertexCount, sizeof(b2Vec2) * rec.vertexCount);
+			fd.shape = &poly;
+			body->CreateFixture(&fd);
+			break;
+		}
+		case b2Shape::e_chain: {
+			// the chain copies its vertices from the mapping directly
+			b2ChainShape chain;
+			chain.CreateChain(v, rec.vertexCount);
+			chain.m_radius = rec.radius;
+			if (rec.hasPrevVertex) chain.SetPrevVertex(rec.prevVertex);
+			if (rec.hasNextVertex) chain.SetNextVertex(rec.nextVertex);
+			fd.shape = &chain;
+			body->CreateFixture(&fd);
+			break;
+		}
+		default:
+			ofLogWarning("ofxBox2dScene") << "create(): unknown shape type " << rec.shapeType;
+			break;
+	}
+}
+
+//----------------------------------------
+static void createJoint(b2World * world, const ofxBox2dScene::Joint & rec, const vector <b2Body*> & bodies) {
+	b2Body * bodyA = bodies[rec.bodyA];
+	b2Body * bodyB = bodies[rec.bodyB];
+	bool collideConnected = rec.collideConnected != 0;
+
+	switch (rec.type) {
+		case e_distanceJoint: {
+			b2DistanceJointDef jd;
+			jd.bodyA            = bodyA;
+			jd.bodyB            = bodyB;
+			jd.collideConnected = collideConnected;
+			jd.localAnchorA     = rec.localAnchorA;
+			jd.localAnchorB     = rec.localAnchorB;
+			jd.length           = rec.length;
+			jd.frequencyHz      = rec.frequencyHz;
+			jd.dampingRatio     = rec.dampingRatio;
+			world->CreateJoint(&jd);
+			break;
+		}
+		case e_revoluteJoint: {
+			b2RevoluteJointDef jd;
+			jd.bodyA            = bodyA;
+			jd.bodyB            = bodyB;
+			jd.collideConnected = collideConnected;
+			jd.localAnchorA     = rec.localAnchorA;
+			jd.localAnchorB     = rec.localAnchorB;
+			jd.referenceAngle   = rec.referenceAngle;
+			jd.enableLimit      = rec.enableLimit != 0;
+			jd.lowerAngle       = rec.lowerLimit;
+			jd.upperAngle       = rec.upperLimit;
+			jd.enableMotor      = rec.enableMotor != 0;
+			jd.motorSpeed       = rec.motorSpeed;
+			jd.maxMotorTorque   = rec.maxMotor;
+			world->CreateJoint(&jd);
+			break;
+		}
+		case e_prismaticJoint: {
+			b2PrismaticJointDef jd;
+			jd.bodyA            = bodyA;
+			jd.bodyB            = bodyB;
+			jd.collideConnected = collideConnected;
+			jd.localAnchorA     = rec.localAnchorA;
+			jd.localAnchorB     = rec.localAnchorB;
+			jd.localAxisA       = rec.localAxisA;
+			jd.referenceAngle   = rec.referenceAngle;
+			jd.enableLimit      = rec.enableLimit != 0;
+			jd.lowerTranslation = rec.lowerLimit;
+			jd.upperTranslation = rec.upperLimit;
+			jd.enableMotor      = rec.enableMotor != 0;
+			jd.motorSpeed       = rec.motorSpeed;
+			jd.maxMotorForce    = rec.maxMotor;
+			world->CreateJoint(&jd);
+			break;
+		}
+		case e_weldJoint: {
+			b2WeldJointDef jd;
+			jd.bodyA            = bodyA;
+			jd.bodyB            = bodyB;
+			jd.collideConnected = collideConnected;
+			jd.localAnchorA     = rec.localAnchorA;
+			jd.localAnchorB     = rec.localAnchorB;
+			jd.referenceAngle   = rec.referenceAngle;
+			jd.frequencyHz      = rec.frequencyHz;
+			jd.dampingRatio     = rec.dampingRatio;
+			world->CreateJoint(&jd);
+			break;
+		}
+		case e_ropeJoint: {
+			b2RopeJointDef jd;
+			jd.bodyA            = bodyA;
+			jd.bodyB            = bodyB;
+			jd.collideConnected = collideConnected;
+			jd.localAnchorA     = rec.localAnchorA;
+			jd.localAnchorB     = rec.localAnchorB;
+			jd.maxLength        = rec.length;
+			world->CreateJoint(&jd);
+			break;
+		}
+		case e_wheelJoint: {
+			b2WheelJointDef jd;
+			jd.bodyA            = bodyA;
+			jd.bodyB            = bodyB;
+			jd.collideConnected = collideConnected;
+			jd.localAnchorA     = rec.localAnchorA;
+			jd.localAnchorB     = rec.localAnchorB;
+			jd.localAxisA       = rec.localAxisA;
+			jd.enableMotor      = rec.enableMotor != 0;
+			jd.motorSpeed       = rec.motorSpeed;
+			jd.maxMotorTorque   = rec.maxMotor;
+			jd.frequencyHz      = rec.frequencyHz;
+			jd.dampingRatio     = rec.dampingRatio;
+			world->CreateJoint(&jd);
+			break;
+		}
+		default:
+			ofLogWarning("ofxBox2dScene") << "create(): unknown joint type " << rec.type;
+			break;
+	}
+}
+
+//----------------------------------------
+vector <b2Body*> ofxBox2dScene::create(b2World * world) const {
+	vector <b2Body*> bodies;
+	if (!isLoaded()) {
+		ofLogWarning("ofxBox2dScene") << "create(): no scene loaded";
+		return bodies;
+	}
+	if (world == NULL || world->IsLocked()) {
+		ofLogError("ofxBox2dScene") << "create(): world is NULL or locked";
+		return bodies;
+	}
+
+	const Body    * bodyRecs    = getBodies();
+	const Fixture * fixtureRecs = getFixtures();
+	const b2Vec2  * vertices    = getVertices();
+	const Joint   * jointRecs   = getJoints();
+
+	bodies.reserve(header->bodyCount);
+	for (int i=0; i<header->bodyCount; i++) {
+		const Body & rec = bodyRecs[i];
+		b2BodyDef bd;
+		bd.type            = (b2BodyType)rec.type;
+		bd.position        = rec.position;
+		bd.angle           = rec.angle;
+		bd.linearDamping   = rec.linearDamping;
+		bd.angularDamping  = rec.angularDamping;
+		bd.gravityScale    = rec.gravityScale;
+		bd.awake           = (rec.flags & BODY_AWAKE) != 0;
+		bd.allowSleep      = (rec.flags & BODY_ALLOW_SLEEP) != 0;
+		bd.fixedRotation   = (rec.flags & BODY_FIXED_ROTATION) != 0;
+		bd.bullet          = (rec.flags & BODY_BULLET) != 0;
+		bd.active          = (rec.flags & BODY_ACTIVE) != 0;
+		bd.speculative     = (rec.flags & BODY_SPECULATIVE) != 0;
+
+		b2Body * body = world->CreateBody(&bd);
+		for (int k=0; k<rec.fixtureCount; k++) {
+			createFixture(body, fixtureRecs[rec.firstFixture + k], vertices);
+		}
+		// velocities are set once the mass is final, adding fixtures
+		// moves the center of mass and with it the linear velocity.
+		body->SetLinearVelocity(rec.linearVelocity);
+		body->SetAngularVelocity(rec.angularVelocity);
+		bodies.push_back(body);
+	}
+
+	for (int i=0; i<header->jointCount; i++) {
+		createJoint(world, jointRecs[i], bodies);
+	}
+
+	return bodies;
+}
@@ -0,0 +1,147 @@
+//
+//  ofxBox2dScene.h
+//
+//  Compact binary scene format. A scene holds the baked bodies, fixtures,
+//  joints and static chains of a b2World in flat, fixed-size records so a
+//  level can be memory mapped and instantiated without re-triangulating or
+//  re-running ofxBox2dPolygon::create().
+//
+//  File layout (native byte order, every record 4 byte aligned):
+//
+//      Header
+//      Body[bodyCount]
+//      Fixture[fixtureCount]
+//      b2Vec2[vertexCount]     shared vertex pool used by the fixtures
+//      Joint[jointCount]
+//
+
+#pragma once
+#include "ofMain.h"
+#include "Box2D.h"
+
+class ofxBox2dScene {
+
+public:
+
+	static const uint32 MAGIC       = 0x43533242; // "B2SC"
+	static const uint32 VERSION     = 1;
+	static const uint32 ENDIAN_MARK = 0x01020304;
+
+	enum BodyFlags {
+		BODY_AWAKE          = 0x0001,
+		BODY_ALLOW_SLEEP    = 0x0002,
+		BODY_FIXED_ROTATION = 0x0004,
+		BODY_BULLET         = 0x0008,
+		BODY_ACTIVE         = 0x0010,
+		BODY_SPECULATIVE    = 0x0020
+	};
+
+	struct Header {
+		uint32 magic;
+		uint32 version;
+		uint32 byteOrder;
+		uint32 fileSize;
+		int32  bodyCount;
+		int32  fixtureCount;
+		int32  vertexCount;
+		int32  jointCount;
+		uint32 bodyOffset;
+		uint32 fixtureOffset;
+		uint32 vertexOffset;
+		uint32 jointOffset;
+	};
+
+	struct Body {
+		int32   type;
+		b2Vec2  position;
+		float32 angle;
+		b2Vec2  linearVelocity;
+		float32 angularVelocity;
+		float32 linearDamping;
+		float32 angularDamping;
+		float32 gravityScale;
+		uint32  flags;
+		int32   firstFixture;
+		int32   fixtureCount;
+	};
+
+	// polygons store their vertices followed by their normals in the
+	// vertex pool so they can be copied straight into b2PolygonShape.
+	// edges store vertex1/vertex2, chains store all of their vertices.
+	struct Fixture {
+		int32   shapeType;
+		float32 radius;
+		float32 density;
+		float32 friction;
+		float32 restitution;
+		uint16  categoryBits;
+		uint16  maskBits;
+		int16   groupIndex;
+		uint16  isSensor;
+		b2Vec2  center;         // circle position / polygon centroid
+		int32   firstVertex;
+		int32   vertexCount;
+		b2Vec2  prevVertex;     // edge vertex0 / chain prev vertex
+		b2Vec2  nextVertex;     // edge vertex3 / chain next vertex
+		int32   hasPrevVertex;
+		int32   hasNextVertex;
+	};
+
+	// distance, revolute, prismatic, weld, rope and wheel joints are
+	// supported, other joint types are skipped when baking.
+	struct Joint {
+		int32   type;
+		int32   bodyA;
+		int32   bodyB;
+		int32   collideConnected;
+		b2Vec2  localAnchorA;
+		b2Vec2  localAnchorB;
+		b2Vec2  localAxisA;
+		float32 referenceAngle;
+		int32   enableLimit;
+		int32   enableMotor;
+		float32 lowerLimit;
+		float32 upperLimit;
+		float32 motorSpeed;
+		float32 maxMotor;       // torque or force depending on type
+		float32 frequencyHz;
+		float32 dampingRatio;
+		float32 length;         // distance length / rope max length
+	};
+
+	ofxBox2dScene();
+	~ofxBox2dScene();
+
+	// tool entry point: write every body, fixture and supported
+	// joint of a running world to a scene file
+	static bool bake(b2World * world, string path);
+
+	// map a scene file into memory, nothing is parsed or copied
+	bool load(string path);
+	void close();
+	bool isLoaded() const { return header != NULL; }
+
+	// create the mapped bodies/joints in the world. fixture vertex data
+	// is read in place from the mapping. the scene can be closed once
+	// this returns. returns the bodies in file order.
+	vector <b2Body*> create(b2World * world) const;
+
+	const Header  * getHeader()   const { return header; }
+	const Body    * getBodies()   const;
+	const Fixture * getFixtures() const;
+	const b2Vec2  * getVertices() const;
+	const Joint   * getJoints()   const;
+
+private:
+
+	// no copies, the object owns the mapping
+	ofxBox2dScene(const ofxBox2dScene &);
+	ofxBox2dScene & operator=(const ofxBox2dScene &);
+
+	const Header * header;
+	size_t         mappedSize;
+#ifdef TARGET_WIN32
+	void *         fileHandle;
+	void *         mappingHandle;
+#endif
+};
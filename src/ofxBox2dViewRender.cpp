@@ -0,0 +1,201 @@
+//
+//  ofxBox2dViewRender.cpp
+//
+
+#include "ofxBox2dViewRender.h"
+#include "ofxBox2d.h"
+
+//----------------------------------------
+static bool fixtureByBody(const b2Fixture * a, const b2Fixture * b) {
+	const b2Body * ba = a->GetBody();
+	const b2Body * bb = b->GetBody();
+	if (ba != bb) return ba < bb;
+	return a < b;
+}
+
+//----------------------------------------
+static inline uint64 hashBytes(uint64 hash, const void * data, size_t size) {
+	const unsigned char * bytes = (const unsigned char*)data;
+	for (size_t i=0; i<size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+//----------------------------------------
+static bool fixtureOverlaps(const b2Fixture * fixture, const b2AABB & aabb) {
+	for (int i=0; i<fixture->GetShape()->GetChildCount(); i++) {
+		if (b2TestOverlap(fixture->GetAABB(i), aabb)) return true;
+	}
+	return false;
+}
+
+//----------------------------------------
+static b2AABB toB2dAABB(const ofRectangle & rect) {
+	b2AABB aabb;
+	aabb.lowerBound = ofxBox2d::toB2d(rect.getMinX(), rect.getMinY());
+	aabb.upperBound = ofxBox2d::toB2d(rect.getMaxX(), rect.getMaxY());
+	return aabb;
+}
+
+//----------------------------------------
+ofxBox2dViewRender::ofxBox2dViewRender() {
+	circleResolution = 16;
+	cacheMargin      = 0.5;
+	staticSignature  = 0;
+	visibleBodyCount = 0;
+	staticBodyCount  = 0;
+	bRebuiltStatic   = false;
+
+	staticFill.setUsage(GL_STATIC_DRAW);
+	staticLines.setUsage(GL_STATIC_DRAW);
+	dynamicFill.setUsage(GL_DYNAMIC_DRAW);
+	dynamicLines.setUsage(GL_DYNAMIC_DRAW);
+
+	staticFill.setMode(OF_PRIMITIVE_TRIANGLES);
+	dynamicFill.setMode(OF_PRIMITIVE_TRIANGLES);
+	staticLines.setMode(OF_PRIMITIVE_LINES);
+	dynamicLines.setMode(OF_PRIMITIVE_LINES);
+}
+
+//----------------------------------------
+bool ofxBox2dViewRender::ReportFixture(b2Fixture * fixture) {
+	// chains report once per child edge, duplicates are removed in draw()
+	regionFixtures.push_back(fixture);
+	return true;
+}
+
+//----------------------------------------
+void ofxBox2dViewRender::addFixture(const b2Fixture * fixture, ofMesh & fill, ofMesh & lines) {
+	const b2Transform & xf = fixture->GetBody()->GetTransform();
+	const b2Shape * shape  = fixture->GetShape();
+
+	switch (shape->GetType()) {
+		case b2Shape::e_circle: {
+			const b2CircleShape * circle = (const b2CircleShape*)shape;
+			ofVec2f center = ofxBox2d::toOf(b2Mul(xf, circle->m_p));
+			float radius   = ofxBox2d::toOf(circle->m_radius);
+			float step     = TWO_PI / circleResolution;
+			for (int i=0; i<circleResolution; i++) {
+				fill.addVertex(ofVec3f(center.x, center.y));
+				fill.addVertex(ofVec3f(center.x + radius * cos(step * i),     center.y + radius * sin(step * i)));
+				fill.addVertex(ofVec3f(center.x + radius * cos(step * (i+1)), center.y + radius * sin(step * (i+1))));
+			}
+			break;
+		}
+		case b2Shape::e_polygon: {
+			const b2PolygonShape * poly = (const b2PolygonShape*)shape;
+			ofVec2f first = ofxBox2d::toOf(b2Mul(xf, poly->m_vertices[0]));
+			for (int i=1; i<poly->m_count-1; i++) {
+				ofVec2f b = ofxBox2d::toOf(b2Mul(xf, poly->m_vertices[i]));
+				ofVec2f c = ofxBox2d::toOf(b2Mul(xf, poly->m_vertices[i+1]));
+				fill.addVertex(ofVec3f(first.x, first.y));
+				fill.addVertex(ofVec3f(b.x, b.y));
+				fill.addVertex(ofVec3f(c.x, c.y));
+			}
+			break;
+		}
+		case b2Shape::e_edge: {
+			const b2EdgeShape * edge = (const b2EdgeShape*)shape;
+			ofVec2f a = ofxBox2d::toOf(b2Mul(xf, edge->m_vertex1));
+			ofVec2f b = ofxBox2d::toOf(b2Mul(xf, edge->m_vertex2));
+			lines.addVertex(ofVec3f(a.x, a.y));
+			lines.addVertex(ofVec3f(b.x, b.y));
+			break;
+		}
+		case b2Shape::e_chain: {
+			const b2ChainShape * chain = (const b2ChainShape*)shape;
+			for (int i=1; i<chain->m_count; i++) {
+				ofVec2f a = ofxBox2d::toOf(b2Mul(xf, chain->m_vertices[i-1]));
+				ofVec2f b = ofxBox2d::toOf(b2Mul(xf, chain->m_vertices[i]));
+				lines.addVertex(ofVec3f(a.x, a.y));
+				lines.addVertex(ofVec3f(b.x, b.y));
+			}
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+//----------------------------------------
+void ofxBox2dViewRender::draw(b2World * world, const ofRectangle & viewport) {
+	if (world == NULL) return;
+
+	// the resting mesh covers the viewport plus a margin, re-centre the
+	// region once the viewport leaves it
+	if (staticSignature == 0 || !cachedRegion.inside(viewport)) {
+		float mx = viewport.getWidth()  * cacheMargin;
+		float my = viewport.getHeight() * cacheMargin;
+		cachedRegion.set(viewport.getMinX() - mx, viewport.getMinY() - my,
+		                 viewport.getWidth() + 2 * mx, viewport.getHeight() + 2 * my);
+		staticSignature = 0;
+	}
+
+	// collect the fixtures whose proxies overlap the region
+	regionFixtures.clear();
+	world->QueryAABB(this, toB2dAABB(cachedRegion));
+
+	std::sort(regionFixtures.begin(), regionFixtures.end(), fixtureByBody);
+	regionFixtures.erase(std::unique(regionFixtures.begin(), regionFixtures.end()), regionFixtures.end());
+
+	// split into bodies at rest (static or sleeping) anywhere in the region
+	// and moving bodies inside the viewport. the signature only covers the
+	// resting set, so scrolling does not change it.
+	b2AABB view = toB2dAABB(viewport);
+	restingFixtures.clear();
+	movingFixtures.clear();
+	visibleBodyCount = 0;
+	staticBodyCount  = 0;
+	uint64 signature = 14695981039346656037ULL;
+	const b2Body * lastBody = NULL;
+	const b2Body * lastVisible = NULL;
+	for (size_t i=0; i<regionFixtures.size(); i++) {
+		b2Fixture * f = regionFixtures[i];
+		const b2Body * body = f->GetBody();
+		bool resting = body->GetType() == b2_staticBody || !body->IsAwake();
+		bool inView  = fixtureOverlaps(f, view);
+		if (inView && body != lastVisible) {
+			visibleBodyCount++;
+			lastVisible = body;
+		}
+		if (body != lastBody) {
+			if (resting) {
+				staticBodyCount++;
+				signature = hashBytes(signature, &body, sizeof(body));
+				signature = hashBytes(signature, &body->GetTransform(), sizeof(b2Transform));
+			}
+			lastBody = body;
+		}
+		if (resting) {
+			signature = hashBytes(signature, &f, sizeof(f));
+			restingFixtures.push_back(f);
+		}
+		else if (inView) {
+			movingFixtures.push_back(f);
+		}
+	}
+
+	// the resting mesh is only rebuilt when its contents changed
+	bRebuiltStatic = signature != staticSignature;
+	if (bRebuiltStatic) {
+		staticFill.clear();
+		staticLines.clear();
+		for (size_t i=0; i<restingFixtures.size(); i++) {
+			addFixture(restingFixtures[i], staticFill, staticLines);
+		}
+		staticSignature = signature;
+	}
+
+	dynamicFill.clear();
+	dynamicLines.clear();
+	for (size_t i=0; i<movingFixtures.size(); i++) {
+		addFixture(movingFixtures[i], dynamicFill, dynamicLines);
+	}
+
+	staticFill.draw();
+	staticLines.draw();
+	dynamicFill.draw();
+	dynamicLines.draw();
+}
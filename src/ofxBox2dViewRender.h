@@ -0,0 +1,60 @@
+//
+//  ofxBox2dViewRender.h
+//
+//  World level render pass that only draws what is inside the viewport.
+//  Fixtures are found by querying the broad-phase b2DynamicTree with the
+//  viewport grown by a margin. Awake bodies inside the viewport are
+//  re-tessellated every frame, static and sleeping bodies in the whole
+//  region go into a GL_STATIC_DRAW mesh. That mesh is only rebuilt when
+//  the resting set changes (a body wakes, falls asleep or moves) or the
+//  viewport scrolls out of the region, GL clips the rest.
+//
+
+#pragma once
+#include "ofMain.h"
+#include "Box2D.h"
+
+class ofxBox2dViewRender : public b2QueryCallback {
+
+public:
+
+	ofxBox2dViewRender();
+
+	// number of segments used for circles
+	int circleResolution;
+
+	// extra area cached around the viewport, as a fraction of its size
+	// on each side. scrolling inside it keeps the static mesh.
+	float cacheMargin;
+
+	// viewport is in openFrameworks (pixel) coordinates
+	void draw(b2World * world, const ofRectangle & viewport);
+
+	// force the static mesh to be rebuilt on the next draw
+	void invalidate() { staticSignature = 0; }
+
+	// stats of the last draw, static bodies are counted in the whole
+	// cached region
+	int getVisibleBodyCount() const { return visibleBodyCount; }
+	int getStaticBodyCount()  const { return staticBodyCount; }
+	bool didRebuildStatic()   const { return bRebuiltStatic; }
+
+	bool ReportFixture(b2Fixture * fixture);
+
+private:
+
+	void addFixture(const b2Fixture * fixture, ofMesh & fill, ofMesh & lines);
+
+	vector <b2Fixture*> regionFixtures;
+	vector <b2Fixture*> restingFixtures;
+	vector <b2Fixture*> movingFixtures;
+
+	ofVboMesh staticFill, staticLines;
+	ofVboMesh dynamicFill, dynamicLines;
+
+	ofRectangle cachedRegion;
+	uint64 staticSignature;
+	int    visibleBodyCount;
+	int    staticBodyCount;
+	bool   bRebuiltStatic;
+};